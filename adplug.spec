@@ -77,7 +77,9 @@ rm -rf $RPM_BUILD_ROOT
 %defattr(-,root,root)
 %doc README AUTHORS NEWS TODO
 %_bindir/adplugdb
+%_bindir/adplugrender
 %_mandir/man1/adplugdb.1*
+%_mandir/man1/adplugrender.1*
 %_libdir/*.so.*
 
 %files devel
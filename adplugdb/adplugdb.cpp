@@ -28,15 +28,21 @@
 #include <string.h>
 #include <binfile.h>
 #include <string>
+#include <vector>
+#include <set>
 #include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_DIRENT_H
+#  include <dirent.h>
+#endif
 
-#if defined(HAVE_SYS_TYPES_H) && defined(HAVE_SYS_STAT_H)
-#  if HAVE_SYS_TYPES_H
-#    include <sys/types.h>
-#  endif
-#  if HAVE_SYS_STAT_H
-#    include <sys/stat.h>
-#  endif
+#ifndef S_ISDIR
+#  define S_ISDIR(m)	(((m) & S_IFMT) == S_IFDIR)
 #endif
 
 #ifndef HAVE_MKDIR
@@ -86,6 +92,43 @@
 #define MSG_NOTE	3
 #define MSG_DEBUG	4
 
+/***** Types *****/
+
+struct Job {
+  std::string			filename;
+  unsigned long			size;
+  CAdPlugDatabase::CKey		key;
+  CAdPlugDatabase::CRecord	*record;	// made by scan, found by verify
+  bool				ok;		// file could be read
+};
+
+class CScanProvider: public CProvider_Memory
+  /*
+   * Provides the scanned file from memory, so it isn't read again, and
+   * its companion files, like instrument banks, from disk.
+   */
+{
+public:
+  binistream *open(std::string filename) const
+    {
+      binistream *f = CProvider_Memory::open(filename);
+
+      if(f || !(f = disk.open(filename))) return f;
+      fromdisk.insert(f);
+      return f;
+    }
+
+  void close(binistream *f) const
+    {
+      if(fromdisk.erase(f)) disk.close(f);
+      else CProvider_Memory::close(f);
+    }
+
+private:
+  CProvider_Filesystem			disk;
+  mutable std::set<binistream *>	fromdisk;
+};
+
 /***** Global variables *****/
 
 static const struct {
@@ -104,16 +147,21 @@ static struct {
   int					message_level;
   bool					usedefaultdb, usercomment, cmdkeys;
   const char				*homedir;
+  unsigned int				threads;
 } cfg = {
   ADPLUGDB_PATH,
   CAdPlugDatabase::CRecord::Plain,
   MSG_NOTE,
   false, false, false,
-  NULL
+  NULL,
+  0
 };
 
-static CAdPlugDatabase	mydb;
-static const char	*program_name;
+static CAdPlugDatabase		mydb;
+static std::vector<Job>		jobs;
+static std::atomic<unsigned long> next_job;
+static std::mutex		output_lock;	// serializes console output
+static const char		*program_name;
 
 /***** Functions *****/
 
@@ -123,6 +171,7 @@ static void message(int level, const char *fmt, ...)
 
   if(cfg.message_level < level) return;
 
+  std::lock_guard<std::mutex> l(output_lock);
   fprintf(stderr, "%s: ", program_name);
   va_start(argptr, fmt);
   vfprintf(stderr, fmt, argptr);
@@ -157,6 +206,10 @@ static void usage()
 	 "  list [files]     List files (or everything) from database\n"
 	 "  remove <files>   Remove files from database\n"
 	 "  merge <files>    Merge other databases with the current one\n"
+	 "  export <file>    Write database as an index for mapping\n"
+	 "  import <file>    Convert an index back into the database\n"
+	 "  scan <files>     Add files and directories, using all processors\n"
+	 "  verify <files>   Report records that match none of the files\n"
 	 "\n"
 	 "Database options:\n"
 	 "  -d <file>        Use different database file\n"
@@ -167,6 +220,10 @@ static void usage()
 	 "  -c               Prompt for record comment\n"
 	 "  -k               Specify keys instead of files on commandline\n"
 	 "\n"
+	 "Scan and verify options:\n"
+	 "  -l <file>        Read more files from list file (- is stdin)\n"
+	 "  -j <threads>     Number of threads (default: one per processor)\n"
+	 "\n"
 	 "Generic options:\n"
 	 "  -q               Be more quiet\n"
 	 "  -v               Be more verbose\n"
@@ -177,17 +234,15 @@ static void usage()
 
 static const std::string file2type(const char *filename)
 {
-  CPlayers::const_iterator	i;
-  CSilentopl			opl;
-  CPlayer			*p;
-
-  for(i = CAdPlug::players.begin(); i != CAdPlug::players.end(); i++)
-    if((p = (*i)->factory(&opl)))
-      if(p->load(filename)) {
-	delete p;
-	return (*i)->filetype;
-      } else
-	delete p;
+  CSilentopl		opl;
+  const CPlayerDesc	*desc;
+  CPlayer		*p = CAdPlug::factory(filename, &opl, CAdPlug::players,
+					      CProvider_Filesystem(), NULL, &desc);
+
+  if(p) {
+    delete p;
+    return desc->filetype;
+  }
 
   message(MSG_WARN, "unknown filetype -- %s", filename);
   return UNKNOWN_FILETYPE;
@@ -238,9 +293,11 @@ static void db_add(const char *filename)
 static bool db_resolve(const char *filename)
 /* Resolves and lists one entry from the database */
 {
-  if(mydb.lookup(file2key(filename))) {
+  CAdPlugDatabase::CRecord *record = mydb.search(file2key(filename));
+
+  if(record) {
     message(MSG_NOTE, "viewing entry -- %s", filename);
-    mydb.get_record()->user_write(std::cout);
+    record->user_write(std::cout);
     return true;
   } else {
     message(MSG_WARN, "no entry in database -- %s", filename);
@@ -258,6 +315,228 @@ static void db_remove(const char *filename)
     message(MSG_WARN, "no entry in database, could not delete -- %s", filename);
 }
 
+static void add_path(const std::string &path)
+/* Adds a file or, recursively, all files of a directory to the job list */
+{
+  struct stat	st;
+
+  if(stat(path.c_str(), &st)) {
+    message(MSG_WARN, "can't open specified file -- %s", path.c_str());
+    return;
+  }
+
+  if(S_ISDIR(st.st_mode)) {
+#ifdef HAVE_DIRENT_H
+    DIR			*dir = opendir(path.c_str());
+    struct dirent	*entry;
+
+    if(!dir) {
+      message(MSG_WARN, "can't open directory -- %s", path.c_str());
+      return;
+    }
+
+    while((entry = readdir(dir)))
+      if(strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
+	add_path(path + "/" + entry->d_name);
+
+    closedir(dir);
+#else
+    message(MSG_WARN, "directories not supported on this system -- %s",
+	    path.c_str());
+#endif
+    return;
+  }
+
+  Job job;
+  job.filename = path;
+  job.size = st.st_size;
+  job.record = NULL;
+  job.ok = false;
+  jobs.push_back(job);
+}
+
+static void add_list(const char *listfile)
+/* Adds every line of a list file */
+{
+  FILE	*f = strcmp(listfile, "-") ? fopen(listfile, "r") : stdin;
+  char	line[4096];
+
+  if(!f) {
+    message(MSG_ERROR, "can't open list file -- %s", listfile);
+    exit(EXIT_FAILURE);
+  }
+
+  while(fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if(*line) add_path(line);
+  }
+
+  if(f != stdin) fclose(f);
+}
+
+static bool read_key(Job &job, std::vector<unsigned char> &data)
+/* Reads a whole file into 'data' and makes its key from there */
+{
+  FILE	*f = fopen(job.filename.c_str(), "rb");
+
+  data.resize(job.size + 1);
+
+  // A file that has grown since it was listed reads past the expected size
+  if(!f || fread(&data[0], 1, data.size(), f) != job.size) {
+    message(MSG_WARN, "can't read file -- %s", job.filename.c_str());
+    if(f) fclose(f);
+    return false;
+  }
+
+  fclose(f);
+  job.key = CAdPlugDatabase::CKey(&data[0], job.size);
+  job.ok = true;
+  return true;
+}
+
+static void scan_file(Job &job)
+/* Makes the key and, if AdPlug can play the file, the record of one file */
+{
+  CSilentopl			opl;
+  const CPlayerDesc		*desc;
+  CPlayer			*p;
+  std::vector<unsigned char>	data;
+  CScanProvider			fp;
+
+  if(!read_key(job, data)) return;
+  fp.add(job.filename, &data[0], job.size);
+  p = CAdPlug::factory(job.filename, &opl, CAdPlug::players, fp, NULL, &desc);
+  if(!p) {
+    message(MSG_WARN, "unknown filetype -- %s", job.filename.c_str());
+    return;
+  }
+
+  job.record = CAdPlugDatabase::CRecord::factory(cfg.rtype);
+  job.record->key = job.key;
+  job.record->filetype = desc->filetype;
+  job.record->comment = job.filename;
+  if(job.record->type == CAdPlugDatabase::CRecord::SongInfo) {
+    ((CInfoRecord *)job.record)->title = p->gettitle();
+    ((CInfoRecord *)job.record)->author = p->getauthor();
+  }
+
+  delete p;
+}
+
+static void verify_file(Job &job)
+/* Makes the key of one file and searches its record */
+{
+  std::vector<unsigned char> data;
+
+  if(read_key(job, data))
+    job.record = mydb.search(job.key);
+}
+
+static void worker(void (*process)(Job &))
+/* Processes jobs until there are none left */
+{
+  unsigned long i;
+
+  while((i = next_job++) < jobs.size())
+    process(jobs[i]);
+}
+
+static void run_jobs(const char *command, void (*process)(Job &))
+  /*
+   * Processes all jobs on all processors. Files are small and take about
+   * the same time each, so the threads simply take the next one in turn.
+   */
+{
+  std::vector<std::thread *>	threads;
+  unsigned int			i;
+
+  if(jobs.empty()) {
+    message(MSG_ERROR, "%s -- missing file argument", command);
+    exit(EXIT_FAILURE);
+  }
+
+  if(!cfg.threads) cfg.threads = std::thread::hardware_concurrency();
+  if(!cfg.threads) cfg.threads = 1;
+  if(cfg.threads > jobs.size()) cfg.threads = jobs.size();
+  message(MSG_DEBUG, "reading %u files on %u threads",
+	  (unsigned int)jobs.size(), cfg.threads);
+
+  next_job = 0;
+  for(i = 0; i < cfg.threads; i++)
+    threads.push_back(new std::thread(worker, process));
+  for(i = 0; i < cfg.threads; i++) {
+    threads[i]->join();
+    delete threads[i];
+  }
+}
+
+static void db_scan(void)
+/* Adds the records of all scanned files at once, like add does one by one */
+{
+  unsigned long added = 0, replaced = 0;
+
+  run_jobs("scan", scan_file);
+
+  for(unsigned long i = 0; i < jobs.size(); i++) {
+    CAdPlugDatabase::CRecord *record = jobs[i].record;
+
+    if(!record) continue;
+    if(mydb.lookup(record->key)) {
+      message(MSG_DEBUG, "replacing previous record -- %s",
+	      jobs[i].filename.c_str());
+      mydb.wipe();
+      replaced++;
+    }
+
+    if(mydb.insert(record)) {
+      message(MSG_DEBUG, "added record, file type \"%s\" -- %s",
+	      record->filetype.c_str(), jobs[i].filename.c_str());
+      added++;
+    } else {
+      delete record;
+      message(MSG_ERROR, "error adding record to database -- %s",
+	      jobs[i].filename.c_str());
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  message(MSG_NOTE, "added %lu records (%lu replaced) from %lu files",
+	  added, replaced, (unsigned long)jobs.size());
+}
+
+static bool db_verify(void)
+  /*
+   * Reports every record that matches none of the files on stdout, by key
+   * and comment. Returns false if there are any.
+   */
+{
+  std::set<const CAdPlugDatabase::CRecord *>	found;
+  unsigned long					stale = 0, i;
+
+  run_jobs("verify", verify_file);
+
+  for(i = 0; i < jobs.size(); i++)
+    if(jobs[i].record)
+      found.insert(jobs[i].record);
+    else if(jobs[i].ok)
+      message(MSG_DEBUG, "no entry in database -- %s", jobs[i].filename.c_str());
+
+  for(CAdPlugDatabase::CIterator it(mydb); it.get_record();) {
+    const CAdPlugDatabase::CRecord *record = it.get_record();
+
+    if(!found.count(record)) {
+      printf("%x:%lx %s\n", record->key.crc16, record->key.crc32,
+	     record->comment.c_str());
+      stale++;
+    }
+    if(!it.go_forward()) break;
+  }
+
+  message(MSG_NOTE, "%lu stale records, %lu of %lu files in database", stale,
+	  (unsigned long)found.size(), (unsigned long)jobs.size());
+  return !stale;
+}
+
 static void copyright()
 /* Print copyright notice and version information */
 {
@@ -314,7 +593,7 @@ int main(int argc, char *argv[])
   atexit(shutdown);
 
   // Parse options
-  while((opt = getopt(argc, argv, "d:t:qvhVsck")) != -1)
+  while((opt = getopt(argc, argv, "d:t:l:j:qvhVsck")) != -1)
     switch(opt) {
     case 'd': cfg.db_file = optarg; break;		// Set database file
     case 't': // Different record type
@@ -342,6 +621,8 @@ int main(int argc, char *argv[])
       break;
     case 'c': cfg.usercomment = true; break;		// Prompt for comments
     case 'k': cfg.cmdkeys = true; break;		// Keys on commandline
+    case 'l': add_list(optarg); break;			// List file
+    case 'j': cfg.threads = atoi(optarg); break;	// Number of threads
     case '?': exit(EXIT_FAILURE);
     }
 
@@ -385,11 +666,11 @@ int main(int argc, char *argv[])
 	printf("\n");
       }
     } else {
-      mydb.goto_begin();
-      do {
-	mydb.get_record()->user_write(std::cout);
+      for(CAdPlugDatabase::CIterator it(mydb); it.get_record();) {
+	it.get_record()->user_write(std::cout);
 	printf("\n");
-      } while(mydb.go_forward());
+	if(!it.go_forward()) break;
+      }
     }
   } else
   if(!strcmp(argv[optind], "remove")) {	// Remove files from database
@@ -416,6 +697,52 @@ int main(int argc, char *argv[])
       message(MSG_ERROR, "merge -- missing file argument");
       exit(EXIT_FAILURE);
     }
+  } else
+  if(!strcmp(argv[optind], "export")) {	// Write database as an index
+    db_error(dbokay);
+    if(++optind < argc) {
+      if(mydb.save_index(argv[optind]))
+	message(MSG_NOTE, "exported database -- %s", argv[optind]);
+      else {
+	message(MSG_ERROR, "could not write index -- %s", argv[optind]);
+	exit(EXIT_FAILURE);
+      }
+    } else {
+      message(MSG_ERROR, "export -- missing file argument");
+      exit(EXIT_FAILURE);
+    }
+  } else
+  if(!strcmp(argv[optind], "import")) {	// Convert an index to a database
+    if(++optind < argc) {
+      if(mydb.load(argv[optind]))
+	message(MSG_NOTE, "imported database -- %s", argv[optind]);
+      else {
+	message(MSG_ERROR, "could not open index -- %s", argv[optind]);
+	exit(EXIT_FAILURE);
+      }
+      db_save();
+    } else {
+      message(MSG_ERROR, "import -- missing file argument");
+      exit(EXIT_FAILURE);
+    }
+  } else
+  if(!strcmp(argv[optind], "scan")) {	// Add many files at once
+    if(cfg.cmdkeys || cfg.usercomment ||
+       cfg.rtype == CAdPlugDatabase::CRecord::ClockSpeed) {
+      message(MSG_ERROR, "scan -- can't prompt for keys, comments or clock "
+	      "speeds");
+      exit(EXIT_FAILURE);
+    }
+    for(optind++; optind < argc; optind++)
+      add_path(argv[optind]);
+    db_scan();
+    db_save();
+  } else
+  if(!strcmp(argv[optind], "verify")) {	// Check records against files
+    db_error(dbokay);
+    for(optind++; optind < argc; optind++)
+      add_path(argv[optind]);
+    if(!db_verify()) exit(EXIT_FAILURE);
   } else {
     message(MSG_ERROR, "unknown command -- %s", argv[optind]);
     exit(EXIT_FAILURE);
@@ -0,0 +1,614 @@
+/*
+ * AdPlug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (c) 1999 - 2008 Simon Peter <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * adplugrender.cpp - Renders many songs to wave audio files on all cores
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <set>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_DIRENT_H
+#  include <dirent.h>
+#endif
+
+#ifndef S_ISDIR
+#  define S_ISDIR(m)	(((m) & S_IFMT) == S_IFDIR)
+#endif
+
+#include "../src/adplug.h"
+#include "../src/emuopl.h"
+#include "../src/kemuopl.h"
+#include "../src/wemuopl.h"
+#include "../src/renderer.h"
+#include "../src/queueopl.h"
+#include "../src/resampleopl.h"
+
+/*
+ * Apple (OS X) and Sun systems declare getopt in unistd.h, other systems
+ * (Linux) use getopt.h.
+ */
+#if defined (__APPLE__) || (defined(__SVR4) && defined(__sun))
+#	include <unistd.h>
+#else
+#	ifdef HAVE_GETOPT_H
+#		include <getopt.h>
+#	else
+#		include "mygetopt.h"
+#	endif
+#endif
+
+/***** Defines *****/
+
+#define DEFAULT_RATE	44100	// Default output sample rate
+#define DEFAULT_MAXLEN	600	// Default maximum song length in seconds
+#define BUFSIZE		16384	// Sample frames rendered at once
+
+// Message urgency levels
+#define MSG_PANIC	0	// Unmaskable
+#define MSG_ERROR	1
+#define MSG_WARN	2
+#define MSG_NOTE	3
+#define MSG_DEBUG	4
+
+/***** Types *****/
+
+enum Emulator { EMU_SATOH, EMU_KEN, EMU_WOODY };
+enum Format { FMT_WAV, FMT_RAW, FMT_NONE };
+
+struct Job {
+  std::string	filename;	// song to render
+  std::string	outname;	// output file name, relative to output dir
+  unsigned long	size;		// file size, to schedule long songs first
+  unsigned long	frames;		// rendered sample frames
+  bool		ok;
+  bool		unknown;	// not a supported song file
+};
+
+class JobQueue
+  /*
+   * Jobs of one worker thread. The owner takes jobs from the front, idle
+   * workers steal from the back.
+   */
+{
+public:
+  void push(Job *job)
+    {
+      std::lock_guard<std::mutex> l(lock);
+      jobs.push_back(job);
+    }
+
+  Job *pop()
+    {
+      std::lock_guard<std::mutex> l(lock);
+      if(jobs.empty()) return NULL;
+      Job *job = jobs.front(); jobs.pop_front();
+      return job;
+    }
+
+  Job *steal()
+    {
+      std::lock_guard<std::mutex> l(lock);
+      if(jobs.empty()) return NULL;
+      Job *job = jobs.back(); jobs.pop_back();
+      return job;
+    }
+
+private:
+  std::mutex		lock;
+  std::deque<Job *>	jobs;
+};
+
+/***** Global variables *****/
+
+static const struct {
+  const char	*name;
+  Emulator	emu;
+} emulators[] = {
+  { "satoh", EMU_SATOH },
+  { "ken", EMU_KEN },
+  { "woody", EMU_WOODY },
+  {0}
+};
+
+static const struct {
+  const char	*name;
+  Format	format;
+} formats[] = {
+  { "wav", FMT_WAV },
+  { "raw", FMT_RAW },
+  { "none", FMT_NONE },
+  {0}
+};
+
+static const struct {
+  const char		*name;
+  CResampleopl::Quality	quality;
+} qualities[] = {
+  { "fast", CResampleopl::QUALITY_FAST },
+  { "medium", CResampleopl::QUALITY_MEDIUM },
+  { "high", CResampleopl::QUALITY_HIGH },
+  { "best", CResampleopl::QUALITY_BEST },
+  {0}
+};
+
+static struct {
+  const char	*outdir;
+  Emulator	emu;
+  Format	format;
+  int		rate;
+  bool		bit16, stereo;
+  bool		resample;	// emulate at the native rate and resample
+  CResampleopl::Quality	quality;
+  unsigned int	threads;
+  unsigned long	maxlen;
+  int		message_level;
+} cfg = {
+  ".",
+  EMU_SATOH,
+  FMT_WAV,
+  DEFAULT_RATE,
+  true, false,
+  false, CResampleopl::QUALITY_HIGH,
+  0,
+  DEFAULT_MAXLEN,
+  MSG_NOTE
+};
+
+static std::vector<Job>		jobs;
+static std::vector<JobQueue *>	queues;
+static std::mutex		output_lock;	// serializes console output
+static const char		*program_name;
+
+/***** Functions *****/
+
+static void message(int level, const char *fmt, ...)
+{
+  va_list argptr;
+
+  if(cfg.message_level < level) return;
+
+  std::lock_guard<std::mutex> l(output_lock);
+  fprintf(stderr, "%s: ", program_name);
+  va_start(argptr, fmt);
+  vfprintf(stderr, fmt, argptr);
+  va_end(argptr);
+  fprintf(stderr, "\n");
+}
+
+static void usage()
+{
+  printf("Usage: %s [options] <files or directories>\n\n"
+	 "Renders all given songs to wave audio files, using all processors.\n"
+	 "\n"
+	 "Output options:\n"
+	 "  -o <dir>         Write output files to this directory\n"
+	 "  -f <format>      Output format (wav, raw, none)\n"
+	 "  -e <emulator>    OPL emulator to use (satoh, ken, woody)\n"
+	 "  -r <rate>        Sample rate (default: %d)\n"
+	 "  -R <quality>     Emulate at the native rate and resample (fast, medium,\n"
+	 "                   high, best)\n"
+	 "  -8               Render 8-bit samples\n"
+	 "  -s               Render stereo samples\n"
+	 "  -t <seconds>     Stop songs after this time (default: %d)\n"
+	 "\n"
+	 "Generic options:\n"
+	 "  -l <file>        Read more files to render from list file (- is stdin)\n"
+	 "  -j <threads>     Number of threads (default: one per processor)\n"
+	 "  -q               Be more quiet\n"
+	 "  -v               Be more verbose\n"
+	 "  -h               Display this help\n"
+	 "  -V               Display version information\n",
+	 program_name, DEFAULT_RATE, DEFAULT_MAXLEN);
+}
+
+static void copyright()
+/* Print copyright notice and version information */
+{
+  printf("AdPlug batch renderer %s\n", CAdPlug::get_version().c_str());
+  printf("Copyright (c) 1999 - 2008 Simon Peter <dn.tlp@gmx.net>, et al.\n");
+}
+
+static void add_path(const std::string &path, const std::string &outname)
+/*
+ * Adds a file or, recursively, all files of a directory to the job list.
+ * Files inside directories are named after their relative path, others
+ * after their last path component.
+ */
+{
+  struct stat	st;
+
+  if(stat(path.c_str(), &st)) {
+    message(MSG_WARN, "can't open specified file -- %s", path.c_str());
+    return;
+  }
+
+  if(S_ISDIR(st.st_mode)) {
+#ifdef HAVE_DIRENT_H
+    DIR			*dir = opendir(path.c_str());
+    struct dirent	*entry;
+
+    if(!dir) {
+      message(MSG_WARN, "can't open directory -- %s", path.c_str());
+      return;
+    }
+
+    while((entry = readdir(dir)))
+      if(strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
+	add_path(path + "/" + entry->d_name,
+		 outname.empty() ? entry->d_name : outname + "_" + entry->d_name);
+
+    closedir(dir);
+#else
+    message(MSG_WARN, "directories not supported on this system -- %s",
+	    path.c_str());
+#endif
+    return;
+  }
+
+  Job job;
+  job.filename = path;
+  job.outname = outname;
+  job.size = st.st_size;
+  job.frames = 0;
+  job.ok = false;
+  job.unknown = false;
+
+  if(job.outname.empty()) {
+    size_t end = path.find_last_of("/\\");
+    job.outname = end == std::string::npos ? path : path.substr(end + 1);
+  }
+
+  jobs.push_back(job);
+}
+
+static void add_list(const char *listfile)
+/* Adds every line of a list file */
+{
+  FILE	*f = strcmp(listfile, "-") ? fopen(listfile, "r") : stdin;
+  char	line[4096];
+
+  if(!f) {
+    message(MSG_ERROR, "can't open list file -- %s", listfile);
+    exit(EXIT_FAILURE);
+  }
+
+  while(fgets(line, sizeof(line), f)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if(*line) add_path(line, "");
+  }
+
+  if(f != stdin) fclose(f);
+}
+
+static void unique_names()
+  /*
+   * Numbers output names that are taken already, in the order the songs
+   * were given. Otherwise two workers would write the same output file.
+   */
+{
+  std::set<std::string>	names;
+  char			suffix[16];
+
+  for(unsigned long i = 0; i < jobs.size(); i++) {
+    std::string name = jobs[i].outname;
+
+    for(unsigned int n = 2; names.count(name); n++) {
+      sprintf(suffix, "_%u", n);
+      name = jobs[i].outname + suffix;
+    }
+
+    if(name != jobs[i].outname) {
+      message(MSG_NOTE, "output name taken, using %s -- %s", name.c_str(),
+	      jobs[i].filename.c_str());
+      jobs[i].outname = name;
+    }
+    names.insert(name);
+  }
+}
+
+static bool sort_by_size(const Job &a, const Job &b)
+{
+  return a.size > b.size;
+}
+
+static Copl *create_emu(int rate)
+{
+  switch(cfg.emu) {
+  case EMU_KEN: return new CKemuopl(rate, cfg.bit16, cfg.stereo);
+  case EMU_WOODY: return new CWemuopl(rate, cfg.bit16, cfg.stereo);
+  default: return new CEmuopl(rate, cfg.bit16, cfg.stereo);
+  }
+}
+
+static void write_le(FILE *f, unsigned long val, int bytes)
+/* Writes 'val' in little endian byte order */
+{
+  for(int i = 0; i < bytes; i++)
+    fputc((val >> (i * 8)) & 0xff, f);
+}
+
+static void write_wavheader(FILE *f, unsigned long datasize)
+{
+  unsigned int channels = cfg.stereo ? 2 : 1, bits = cfg.bit16 ? 16 : 8;
+
+  fwrite("RIFF", 4, 1, f); write_le(f, datasize + 36, 4);
+  fwrite("WAVEfmt ", 8, 1, f); write_le(f, 16, 4);
+  write_le(f, 1, 2);					// PCM
+  write_le(f, channels, 2);
+  write_le(f, cfg.rate, 4);
+  write_le(f, cfg.rate * channels * bits / 8, 4);	// bytes per second
+  write_le(f, channels * bits / 8, 2);			// block align
+  write_le(f, bits, 2);
+  fwrite("data", 4, 1, f); write_le(f, datasize, 4);
+}
+
+static bool big_endian()
+{
+  const unsigned short test = 1;
+
+  return !*(const unsigned char *)&test;
+}
+
+static void render(Job &job, unsigned char *buf)
+  /*
+   * Renders one song, a whole buffer per emulator call. Every song gets
+   * new emulator and resampler instances, since not all of them can be
+   * reset completely, and the output must not depend on the song that a
+   * worker rendered before.
+   */
+{
+  Copl		*emu = create_emu(cfg.resample ? CResampleopl::NATIVE_RATE : cfg.rate);
+  Copl		*opl = cfg.resample ?
+    new CResampleopl(emu, cfg.rate, cfg.bit16, cfg.stereo, cfg.quality) : emu;
+  CQueueopl	queue(opl, cfg.bit16, cfg.stereo);
+  CPlayer	*p = CAdPlug::factory(job.filename, &queue);
+  FILE		*f = NULL;
+  std::string	outfile;
+  unsigned long	n, maxframes = cfg.maxlen * cfg.rate;
+
+  if(!p) {
+    message(MSG_WARN, "unknown filetype -- %s", job.filename.c_str());
+    job.unknown = true;
+    if(opl != emu) delete opl;
+    delete emu;
+    return;
+  }
+
+  if(cfg.format != FMT_NONE) {
+    outfile = std::string(cfg.outdir) + "/" + job.outname +
+      (cfg.format == FMT_WAV ? ".wav" : ".raw");
+    if(!(f = fopen(outfile.c_str(), "wb"))) {
+      message(MSG_ERROR, "can't write output file -- %s", outfile.c_str());
+      delete p;
+      if(opl != emu) delete opl;
+      delete emu;
+      return;
+    }
+    if(cfg.format == FMT_WAV) write_wavheader(f, 0);
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  CRenderer r(p, &queue, cfg.rate, cfg.bit16, cfg.stereo);
+  unsigned int framesize = r.getframesize();
+
+  while(job.frames < maxframes &&
+	(n = r.render(buf, std::min<unsigned long>(BUFSIZE, maxframes - job.frames)))) {
+    job.frames += n;
+    if(!f) continue;
+
+    // Wave files are little endian, raw files use the machine's byte order
+    if(cfg.format == FMT_WAV && cfg.bit16 && big_endian())
+      for(unsigned long i = 0; i < n * framesize; i += 2)
+	std::swap(buf[i], buf[i + 1]);
+    fwrite(buf, framesize, n, f);
+  }
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double seconds = (double)job.frames / cfg.rate;
+
+  if(f) {
+    if(cfg.format == FMT_WAV) {
+      fseek(f, 0, SEEK_SET);
+      write_wavheader(f, job.frames * framesize);
+    }
+    bool error = ferror(f) != 0;
+    if(fclose(f) || error) {
+      message(MSG_ERROR, "error writing output file -- %s", outfile.c_str());
+      delete p;
+      if(opl != emu) delete opl;
+      delete emu;
+      return;
+    }
+  }
+
+  if(!r.songend())
+    message(MSG_NOTE, "song stopped after %lu seconds -- %s", cfg.maxlen,
+	    job.filename.c_str());
+
+  if(cfg.message_level >= MSG_NOTE) {
+    std::lock_guard<std::mutex> l(output_lock);
+    printf("%s: %s, %.1f s in %.3f s (%.1fx realtime, %.0f samples/s)\n",
+	   job.filename.c_str(), p->gettype().c_str(), seconds, elapsed,
+	   elapsed > 0 ? seconds / elapsed : 0.0,
+	   elapsed > 0 ? job.frames / elapsed : 0.0);
+  }
+
+  job.ok = true;
+  delete p;
+  if(opl != emu) delete opl;
+  delete emu;
+}
+
+static Job *next_job(unsigned int id)
+/* Takes the next job of worker 'id', or steals one from another worker */
+{
+  Job *job = queues[id]->pop();
+
+  for(unsigned int i = 1; !job && i < queues.size(); i++)
+    job = queues[(id + i) % queues.size()]->steal();
+
+  return job;
+}
+
+static void worker(unsigned int id)
+/* Renders jobs until all queues are empty */
+{
+  unsigned char	*buf = new unsigned char[BUFSIZE * 4];
+  Job		*job;
+
+  while((job = next_job(id)))
+    render(*job, buf);
+
+  delete [] buf;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  int		opt;
+  unsigned int	i, done = 0, failed = 0;
+  unsigned long	frames = 0;
+
+  // Init
+  program_name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 :
+	(strrchr(argv[0], '\\') ? strrchr(argv[0], '\\') + 1 : argv[0]);
+
+  // Parse options
+  while((opt = getopt(argc, argv, "o:f:e:r:R:8st:l:j:qvhV")) != -1)
+    switch(opt) {
+    case 'o': cfg.outdir = optarg; break;		// Output directory
+    case 'f':						// Output format
+      for(i = 0; formats[i].name; i++)
+	if(!strcmp(formats[i].name, optarg)) break;
+      if(!formats[i].name) {
+	message(MSG_ERROR, "unknown output format -- %s", optarg);
+	exit(EXIT_FAILURE);
+      }
+      cfg.format = formats[i].format;
+      break;
+    case 'e':						// Emulator
+      for(i = 0; emulators[i].name; i++)
+	if(!strcmp(emulators[i].name, optarg)) break;
+      if(!emulators[i].name) {
+	message(MSG_ERROR, "unknown emulator -- %s", optarg);
+	exit(EXIT_FAILURE);
+      }
+      cfg.emu = emulators[i].emu;
+      break;
+    case 'r': cfg.rate = atoi(optarg); break;		// Sample rate
+    case 'R':						// Resampling quality
+      for(i = 0; qualities[i].name; i++)
+	if(!strcmp(qualities[i].name, optarg)) break;
+      if(!qualities[i].name) {
+	message(MSG_ERROR, "unknown resampling quality -- %s", optarg);
+	exit(EXIT_FAILURE);
+      }
+      cfg.resample = true;
+      cfg.quality = qualities[i].quality;
+      break;
+    case '8': cfg.bit16 = false; break;		// 8-bit output
+    case 's': cfg.stereo = true; break;		// Stereo output
+    case 't': cfg.maxlen = strtoul(optarg, NULL, 10); break; // Maximum length
+    case 'l': add_list(optarg); break;			// List file
+    case 'j': cfg.threads = atoi(optarg); break;	// Number of threads
+    case 'q': if(cfg.message_level) cfg.message_level--; break;	// Be more quiet
+    case 'v': cfg.message_level++; break;	       	// Be more verbose
+    case 'h': usage(); exit(EXIT_SUCCESS); break;	// Display help
+    case 'V': copyright(); exit(EXIT_SUCCESS); break;	// Display version
+    case '?': exit(EXIT_FAILURE);
+    }
+
+  if(cfg.rate <= 0) {
+    message(MSG_ERROR, "invalid sample rate -- %d", cfg.rate);
+    exit(EXIT_FAILURE);
+  }
+
+  for(; optind < argc; optind++)
+    add_path(argv[optind], "");
+
+  if(jobs.empty()) {
+    fprintf(stderr, "%s: need files to render\n", program_name);
+    fprintf(stderr, "Try '%s -h' for more information.\n", program_name);
+    exit(EXIT_FAILURE);
+  }
+
+  unique_names();
+
+  if(!cfg.threads) cfg.threads = std::thread::hardware_concurrency();
+  if(!cfg.threads) cfg.threads = 1;
+  if(cfg.threads > jobs.size()) cfg.threads = jobs.size();
+
+  // Song lengths vary a lot. Big files tend to be long, so they are dealt
+  // out first and the short ones remain for balancing at the end.
+  std::stable_sort(jobs.begin(), jobs.end(), sort_by_size);
+  for(i = 0; i < cfg.threads; i++)
+    queues.push_back(new JobQueue);
+  for(i = 0; i < jobs.size(); i++)
+    queues[i % cfg.threads]->push(&jobs[i]);
+
+  message(MSG_DEBUG, "rendering %u files on %u threads",
+	  (unsigned int)jobs.size(), cfg.threads);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::thread *> threads;
+  for(i = 0; i < cfg.threads; i++)
+    threads.push_back(new std::thread(worker, i));
+  for(i = 0; i < cfg.threads; i++) {
+    threads[i]->join();
+    delete threads[i];
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // Other workers may steal from any queue until they have all finished
+  for(i = 0; i < cfg.threads; i++)
+    delete queues[i];
+
+  for(i = 0; i < jobs.size(); i++)
+    if(jobs[i].ok) {
+      frames += jobs[i].frames;
+      done++;
+    } else if(!jobs[i].unknown)
+      failed++;
+
+  if(cfg.message_level >= MSG_NOTE) {
+    double seconds = (double)frames / cfg.rate;
+
+    printf("Rendered %u songs (%u failed, %u unknown files), %.1f s in %.3f s "
+	   "on %u threads\n", done, failed,
+	   (unsigned int)jobs.size() - done - failed, seconds, elapsed,
+	   cfg.threads);
+    if(elapsed > 0)
+      printf("%.2f songs/s, %.0f samples/s, %.1fx realtime\n",
+	     done / elapsed, frames / elapsed, seconds / elapsed);
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
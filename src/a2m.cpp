@@ -59,8 +59,14 @@ CPlayer *Ca2mLoader::factory(Copl *newopl)
   return new Ca2mLoader(newopl);
 }
 
+int Ca2mLoader::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "_A2module_", 10) ? PROBE_YES : PROBE_NO;
+}
+
 bool Ca2mLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   char id[10];
   int i,j,k,t;
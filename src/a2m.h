@@ -28,6 +28,7 @@ class Ca2mLoader: public CmodPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   Ca2mLoader(Copl *newopl): CmodPlayer(newopl)
     { }
@@ -451,7 +451,7 @@ public:
 
   static const uint8 _regOffset[];
   static const uint16 _unkTable[];
-  static const uint8 *_unkTable2[];
+  static const uint8 *const _unkTable2[];
   static const uint8 _unkTable2_1[];
   static const uint8 _unkTable2_2[];
   static const uint8 _unkTable2_3[];
@@ -2062,7 +2062,7 @@ const uint16 AdlibDriver::_unkTable[] = {
 // These tables are currently only used by updateCallback46(), which only ever
 // uses the first element of one of the sub-tables.
 
-const uint8 *AdlibDriver::_unkTable2[] = {
+const uint8 *const AdlibDriver::_unkTable2[] = {
   AdlibDriver::_unkTable2_1,
   AdlibDriver::_unkTable2_2,
   AdlibDriver::_unkTable2_1,
@@ -2354,6 +2354,7 @@ void CadlPlayer::play(uint16_t track) {
 
 bool CadlPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream	*f = fp.open(filename);
 
   // file validation section
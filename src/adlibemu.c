@@ -48,7 +48,9 @@ I'm not sure about a few things in my code:
 */
 
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
+#include "adlibemu.h"
 
 #if !defined(max) && !defined(__cplusplus)
 #define max(a,b)  (((a) > (b)) ? (a) : (b))
@@ -58,10 +60,11 @@ I'm not sure about a few things in my code:
 #endif
 
 #define PI 3.141592653589793
-#define MAXCELLS 18
-#define WAVPREC 2048
+#define MAXCELLS ADLIBEMU_MAXCELLS
+#define WAVPREC ADLIBEMU_WAVPREC
+#define FIFOSIZ ADLIBEMU_FIFOSIZ
 
-static float AMPSCALE=(8192.0);
+#define DEFAULT_AMPSCALE (8192.0)
 #define FRQSCALE (49716/512.0)
 
 //Constants for Ken's Awe32, on a PII-266 (Ken says: Use these for KSM's!)
@@ -74,39 +77,10 @@ static float AMPSCALE=(8192.0);
 //#define MFBFACTOR 0.5    //How much feedback goes back into modulator
 //#define ADJUSTSPEED 0.85 //0<=x<=1  Simulate finite rate of change of state
 
-typedef struct
-{
-    float val, t, tinc, vol, sustain, amp, mfb;
-    float a0, a1, a2, a3, decaymul, releasemul;
-    short *waveform;
-    long wavemask;
-    void (*cellfunc)(void *, float);
-    unsigned char flags, dum0, dum1, dum2;
-} celltype;
-
-static long numspeakers, bytespersample;
-static float recipsamp;
-static celltype cell[MAXCELLS];
-static signed short wavtable[WAVPREC*3];
-static float kslmul[4] = {0.0,0.5,0.25,1.0};
-static float frqmul[16] = {.5,1,2,3,4,5,6,7,8,9,10,10,12,12,15,15}, nfrqmul[16];
-static unsigned char adlibreg[256], ksl[8][16];
-static unsigned char modulatorbase[9] = {0,1,2,8,9,10,16,17,18};
-static unsigned char odrumstat = 0;
-static unsigned char base2cell[22] = {0,1,2,0,1,2,0,0,3,4,5,3,4,5,0,0,6,7,8,6,7,8};
-
-float lvol[9] = {1,1,1,1,1,1,1,1,1};  //Volume multiplier on left speaker
-float rvol[9] = {1,1,1,1,1,1,1,1,1};  //Volume multiplier on right speaker
-long lplc[9] = {0,0,0,0,0,0,0,0,0};   //Samples to delay on left speaker
-long rplc[9] = {0,0,0,0,0,0,0,0,0};   //Samples to delay on right speaker
-
-long nlvol[9], nrvol[9];
-long nlplc[9], nrplc[9];
-long rend = 0;
-#define FIFOSIZ 256
-static float *rptr[9], *nrptr[9];
-static float rbuf[9][FIFOSIZ*2];
-static float snd[FIFOSIZ*2];
+static const float kslmul[4] = {0.0,0.5,0.25,1.0};
+static const float frqmul[16] = {.5,1,2,3,4,5,6,7,8,9,10,10,12,12,15,15};
+static const unsigned char modulatorbase[9] = {0,1,2,8,9,10,16,17,18};
+static const unsigned char base2cell[22] = {0,1,2,0,1,2,0,0,3,4,5,3,4,5,0,0,6,7,8,6,7,8};
 
 #ifndef USING_ASM
 #define _inline
@@ -129,8 +103,8 @@ static void ftol(float f, long *a) {
 #endif
 
 #define ctc ((celltype *)c)      //A rare attempt to make code easier to read!
-void docell4 (void *c, float modulator) { }
-void docell3 (void *c, float modulator)
+static void docell4 (void *c, float modulator) { }
+static void docell3 (void *c, float modulator)
 {
     long i;
 
@@ -138,7 +112,7 @@ void docell3 (void *c, float modulator)
     ctc->t += ctc->tinc;
     ctc->val += (ctc->amp*ctc->vol*((float)ctc->waveform[i&ctc->wavemask])-ctc->val)*ADJUSTSPEED;
 }
-void docell2 (void *c, float modulator)
+static void docell2 (void *c, float modulator)
 {
     long i;
 
@@ -154,7 +128,7 @@ void docell2 (void *c, float modulator)
     ctc->t += ctc->tinc;
     ctc->val += (ctc->amp*ctc->vol*((float)ctc->waveform[i&ctc->wavemask])-ctc->val)*ADJUSTSPEED;
 }
-void docell1 (void *c, float modulator)
+static void docell1 (void *c, float modulator)
 {
     long i;
 
@@ -176,7 +150,7 @@ void docell1 (void *c, float modulator)
     ctc->t += ctc->tinc;
     ctc->val += (ctc->amp*ctc->vol*((float)ctc->waveform[i&ctc->wavemask])-ctc->val)*ADJUSTSPEED;
 }
-void docell0 (void *c, float modulator)
+static void docell0 (void *c, float modulator)
 {
     long i;
 
@@ -194,35 +168,36 @@ void docell0 (void *c, float modulator)
 }
 
 
-static long waveform[8] = {WAVPREC,WAVPREC>>1,WAVPREC,(WAVPREC*3)>>2,0,0,(WAVPREC*5)>>2,WAVPREC<<1};
-static long wavemask[8] = {WAVPREC-1,WAVPREC-1,(WAVPREC>>1)-1,(WAVPREC>>1)-1,WAVPREC-1,((WAVPREC*3)>>2)-1,WAVPREC>>1,WAVPREC-1};
-static long wavestart[8] = {0,WAVPREC>>1,0,WAVPREC>>2,0,0,0,WAVPREC>>3};
-static float attackconst[4] = {1/2.82624,1/2.25280,1/1.88416,1/1.59744};
-static float decrelconst[4] = {1/39.28064,1/31.41608,1/26.17344,1/22.44608};
-void cellon (long i, long j, celltype *c, unsigned char iscarrier)
+static const long waveform[8] = {WAVPREC,WAVPREC>>1,WAVPREC,(WAVPREC*3)>>2,0,0,(WAVPREC*5)>>2,WAVPREC<<1};
+static const long wavemask[8] = {WAVPREC-1,WAVPREC-1,(WAVPREC>>1)-1,(WAVPREC>>1)-1,WAVPREC-1,((WAVPREC*3)>>2)-1,WAVPREC>>1,WAVPREC-1};
+static const long wavestart[8] = {0,WAVPREC>>1,0,WAVPREC>>2,0,0,0,WAVPREC>>3};
+static const float attackconst[4] = {1/2.82624,1/2.25280,1/1.88416,1/1.59744};
+static const float decrelconst[4] = {1/39.28064,1/31.41608,1/26.17344,1/22.44608};
+static void cellon (adlibemu_context *ctx, long i, long j, celltype *c, unsigned char iscarrier)
 {
     long frn, oct, toff;
     float f;
+    unsigned char *adlibreg = ctx->adlibreg;
 
     frn = ((((long)adlibreg[i+0xb0])&3)<<8) + (long)adlibreg[i+0xa0];
     oct = ((((long)adlibreg[i+0xb0])>>2)&7);
     toff = (oct<<1) + ((frn>>9)&((frn>>8)|(((adlibreg[8]>>6)&1)^1)));
     if (!(adlibreg[j+0x20]&16)) toff >>= 2;
 
-    f = pow(2.0,(adlibreg[j+0x60]>>4)+(toff>>2)-1)*attackconst[toff&3]*recipsamp;
+    f = pow(2.0,(adlibreg[j+0x60]>>4)+(toff>>2)-1)*attackconst[toff&3]*ctx->recipsamp;
     c->a0 = .0377*f; c->a1 = 10.73*f+1; c->a2 = -17.57*f; c->a3 = 7.42*f;
-    f = -7.4493*decrelconst[toff&3]*recipsamp;
+    f = -7.4493*decrelconst[toff&3]*ctx->recipsamp;
     c->decaymul = pow(2.0,f*pow(2.0,(adlibreg[j+0x60]&15)+(toff>>2)));
     c->releasemul = pow(2.0,f*pow(2.0,(adlibreg[j+0x80]&15)+(toff>>2)));
     c->wavemask = wavemask[adlibreg[j+0xe0]&7];
-    c->waveform = &wavtable[waveform[adlibreg[j+0xe0]&7]];
-    if (!(adlibreg[1]&0x20)) c->waveform = &wavtable[WAVPREC];
+    c->waveform = &ctx->wavtable[waveform[adlibreg[j+0xe0]&7]];
+    if (!(adlibreg[1]&0x20)) c->waveform = &ctx->wavtable[WAVPREC];
     c->t = wavestart[adlibreg[j+0xe0]&7];
     c->flags = adlibreg[j+0x20];
     c->cellfunc = docell0;
-    c->tinc = (float)(frn<<oct)*nfrqmul[adlibreg[j+0x20]&15];
+    c->tinc = (float)(frn<<oct)*ctx->nfrqmul[adlibreg[j+0x20]&15];
     c->vol = pow(2.0,((float)(adlibreg[j+0x40]&63) +
-		      (float)kslmul[adlibreg[j+0x40]>>6]*ksl[oct][frn>>6]) * -.125 - 14);
+		      (float)kslmul[adlibreg[j+0x40]>>6]*ctx->ksl[oct][frn>>6]) * -.125 - 14);
     c->sustain = pow(2.0,(float)(adlibreg[j+0x80]>>4) * -.5);
     if (!iscarrier) c->amp = 0;
     c->mfb = pow(2.0,((adlibreg[i+0xc0]>>1)&7)+5)*(WAVPREC/2048.0)*MFBFACTOR;
@@ -231,85 +206,101 @@ void cellon (long i, long j, celltype *c, unsigned char iscarrier)
 }
 
 //This function (and bug fix) written by Chris Moeller
-void cellfreq (signed long i, signed long j, celltype *c)
+static void cellfreq (adlibemu_context *ctx, signed long i, signed long j, celltype *c)
 {
     long frn, oct;
+    unsigned char *adlibreg = ctx->adlibreg;
 
     frn = ((((long)adlibreg[i+0xb0])&3)<<8) + (long)adlibreg[i+0xa0];
     oct = ((((long)adlibreg[i+0xb0])>>2)&7);
 
-    c->tinc = (float)(frn<<oct)*nfrqmul[adlibreg[j+0x20]&15];
+    c->tinc = (float)(frn<<oct)*ctx->nfrqmul[adlibreg[j+0x20]&15];
     c->vol = pow(2.0,((float)(adlibreg[j+0x40]&63) +
-		      (float)kslmul[adlibreg[j+0x40]>>6]*ksl[oct][frn>>6]) * -.125 - 14);
+		      (float)kslmul[adlibreg[j+0x40]>>6]*ctx->ksl[oct][frn>>6]) * -.125 - 14);
 }
 
-static long initfirstime = 0;
-void adlibinit (long dasamplerate, long danumspeakers, long dabytespersample)
+adlibemu_context *adlibcreate (long dasamplerate, long danumspeakers, long dabytespersample)
 {
-    long i, j, frn, oct;
+    adlibemu_context *ctx;
+    long i;
 
-    memset((void *)adlibreg,0,sizeof(adlibreg));
-    memset((void *)cell,0,sizeof(celltype)*MAXCELLS);
-    memset((void *)rbuf,0,sizeof(rbuf));
-    rend = 0; odrumstat = 0;
+    ctx = (adlibemu_context *)malloc(sizeof(adlibemu_context));
+    if (!ctx) return 0;
 
-    for(i=0;i<MAXCELLS;i++)
+    ctx->ampscale = DEFAULT_AMPSCALE;
+    for(i=0;i<9;i++)
     {
-	cell[i].cellfunc = docell4;
-	cell[i].amp = 0;
-	cell[i].vol = 0;
-	cell[i].t = 0;
-	cell[i].tinc = 0;
-	cell[i].wavemask = 0;
-	cell[i].waveform = &wavtable[WAVPREC];
+	ctx->lvol[i] = ctx->rvol[i] = 1;
+	ctx->lplc[i] = ctx->rplc[i] = 0;
     }
 
-    numspeakers = danumspeakers;
-    bytespersample = dabytespersample;
+    adlibinit(ctx,dasamplerate,danumspeakers,dabytespersample);
+    return ctx;
+}
+
+void adlibdestroy (adlibemu_context *ctx)
+{
+    free(ctx);
+}
+
+void adlibinit (adlibemu_context *ctx, long dasamplerate, long danumspeakers, long dabytespersample)
+{
+    long i, j, oct;
+    signed short *wavtable = ctx->wavtable;
 
-    recipsamp = 1.0 / (float)dasamplerate;
-    for(i=15;i>=0;i--) nfrqmul[i] = frqmul[i]*recipsamp*FRQSCALE*(WAVPREC/2048.0);
+    memset((void *)ctx->adlibreg,0,sizeof(ctx->adlibreg));
+    memset((void *)ctx->cell,0,sizeof(celltype)*MAXCELLS);
+    memset((void *)ctx->rbuf,0,sizeof(ctx->rbuf));
+    ctx->rend = 0; ctx->odrumstat = 0;
 
-    if (!initfirstime)
+    for(i=0;i<MAXCELLS;i++)
     {
-	initfirstime = 1;
+	ctx->cell[i].cellfunc = docell4;
+	ctx->cell[i].amp = 0;
+	ctx->cell[i].vol = 0;
+	ctx->cell[i].t = 0;
+	ctx->cell[i].tinc = 0;
+	ctx->cell[i].wavemask = 0;
+	ctx->cell[i].waveform = &wavtable[WAVPREC];
+    }
 
-	for(i=0;i<(WAVPREC>>1);i++)
-	{
-	    wavtable[i] =
-		wavtable[(i<<1)  +WAVPREC] = (signed short)(16384*sin((float)((i<<1)  )*PI*2/WAVPREC));
-	    wavtable[(i<<1)+1+WAVPREC] = (signed short)(16384*sin((float)((i<<1)+1)*PI*2/WAVPREC));
-	}
-	for(i=0;i<(WAVPREC>>3);i++)
-	{
-	    wavtable[i+(WAVPREC<<1)] = wavtable[i+(WAVPREC>>3)]-16384;
-	    wavtable[i+((WAVPREC*17)>>3)] = wavtable[i+(WAVPREC>>2)]+16384;
-	}
+    ctx->numspeakers = danumspeakers;
+    ctx->bytespersample = dabytespersample;
 
-	//[table in book]*8/3
-	ksl[7][0] = 0; ksl[7][1] = 24; ksl[7][2] = 32; ksl[7][3] = 37;
-	ksl[7][4] = 40; ksl[7][5] = 43; ksl[7][6] = 45; ksl[7][7] = 47;
-	ksl[7][8] = 48; for(i=9;i<16;i++) ksl[7][i] = i+41;
-	for(j=6;j>=0;j--)
-	    for(i=0;i<16;i++)
-	    {
-		oct = (long)ksl[j+1][i]-8; if (oct < 0) oct = 0;
-		ksl[j][i] = (unsigned char)oct;
-	    }
+    ctx->recipsamp = 1.0 / (float)dasamplerate;
+    for(i=15;i>=0;i--) ctx->nfrqmul[i] = frqmul[i]*ctx->recipsamp*FRQSCALE*(WAVPREC/2048.0);
+
+    // The tables are cheap to build, so every instance gets its own copy
+    memset((void *)wavtable,0,sizeof(ctx->wavtable));
+    for(i=0;i<(WAVPREC>>1);i++)
+    {
+	wavtable[i] =
+	    wavtable[(i<<1)  +WAVPREC] = (signed short)(16384*sin((float)((i<<1)  )*PI*2/WAVPREC));
+	wavtable[(i<<1)+1+WAVPREC] = (signed short)(16384*sin((float)((i<<1)+1)*PI*2/WAVPREC));
     }
-    else
+    for(i=0;i<(WAVPREC>>3);i++)
     {
-	for(i=0;i<9;i++)
+	wavtable[i+(WAVPREC<<1)] = wavtable[i+(WAVPREC>>3)]-16384;
+	wavtable[i+((WAVPREC*17)>>3)] = wavtable[i+(WAVPREC>>2)]+16384;
+    }
+
+    //[table in book]*8/3
+    ctx->ksl[7][0] = 0; ctx->ksl[7][1] = 24; ctx->ksl[7][2] = 32; ctx->ksl[7][3] = 37;
+    ctx->ksl[7][4] = 40; ctx->ksl[7][5] = 43; ctx->ksl[7][6] = 45; ctx->ksl[7][7] = 47;
+    ctx->ksl[7][8] = 48; for(i=9;i<16;i++) ctx->ksl[7][i] = i+41;
+    for(j=6;j>=0;j--)
+	for(i=0;i<16;i++)
 	{
-	    frn = ((((long)adlibreg[i+0xb0])&3)<<8) + (long)adlibreg[i+0xa0];
-	    oct = ((((long)adlibreg[i+0xb0])>>2)&7);
-	    cell[i].tinc = (float)(frn<<oct)*nfrqmul[adlibreg[modulatorbase[i]+0x20]&15];
+	    oct = (long)ctx->ksl[j+1][i]-8; if (oct < 0) oct = 0;
+	    ctx->ksl[j][i] = (unsigned char)oct;
 	}
-    }
 }
 
-void adlib0 (long i, long v)
+void adlib0 (adlibemu_context *ctx, long i, long v)
 {
+    unsigned char *adlibreg = ctx->adlibreg;
+    celltype *cell = ctx->cell;
+    unsigned char odrumstat = ctx->odrumstat;
     unsigned char tmp = adlibreg[i];
     adlibreg[i] = v;
 
@@ -317,28 +308,28 @@ void adlib0 (long i, long v)
     {
 	if ((v&16) > (odrumstat&16)) //BassDrum
 	{
-	    cellon(6,16,&cell[6],0);
-	    cellon(6,19,&cell[15],1);
+	    cellon(ctx,6,16,&cell[6],0);
+	    cellon(ctx,6,19,&cell[15],1);
 	    cell[15].vol *= 2;
 	}
 	if ((v&8) > (odrumstat&8)) //Snare
 	{
-	    cellon(16,20,&cell[16],0);
-	    cell[16].tinc *= 2*(nfrqmul[adlibreg[17+0x20]&15] / nfrqmul[adlibreg[20+0x20]&15]);
+	    cellon(ctx,16,20,&cell[16],0);
+	    cell[16].tinc *= 2*(ctx->nfrqmul[adlibreg[17+0x20]&15] / ctx->nfrqmul[adlibreg[20+0x20]&15]);
 	    if (((adlibreg[20+0xe0]&7) >= 3) && ((adlibreg[20+0xe0]&7) <= 5)) cell[16].vol = 0;
 	    cell[16].vol *= 2;
 	}
 	if ((v&4) > (odrumstat&4)) //TomTom
 	{
-	    cellon(8,18,&cell[8],0);
+	    cellon(ctx,8,18,&cell[8],0);
 	    cell[8].vol *= 2;
 	}
 	if ((v&2) > (odrumstat&2)) //Cymbal
 	{
-	    cellon(17,21,&cell[17],0);
+	    cellon(ctx,17,21,&cell[17],0);
 
 	    cell[17].wavemask = wavemask[5];
-	    cell[17].waveform = &wavtable[waveform[5]];
+	    cell[17].waveform = &ctx->wavtable[waveform[5]];
 	    cell[17].tinc *= 16; cell[17].vol *= 2;
 
 	    //cell[17].waveform = &wavtable[WAVPREC]; cell[17].wavemask = 0;
@@ -349,37 +340,37 @@ void adlib0 (long i, long v)
 	}
 	if ((v&1) > (odrumstat&1)) //Hihat
 	{
-	    cellon(7,17,&cell[7],0);
+	    cellon(ctx,7,17,&cell[7],0);
 	    if (((adlibreg[17+0xe0]&7) == 1) || ((adlibreg[17+0xe0]&7) == 4) ||
 		((adlibreg[17+0xe0]&7) == 5) || ((adlibreg[17+0xe0]&7) == 7)) cell[7].vol = 0;
-	    if ((adlibreg[17+0xe0]&7) == 6) { cell[7].wavemask = 0; cell[7].waveform = &wavtable[(WAVPREC*7)>>2]; }
+	    if ((adlibreg[17+0xe0]&7) == 6) { cell[7].wavemask = 0; cell[7].waveform = &ctx->wavtable[(WAVPREC*7)>>2]; }
 	}
 
-	odrumstat = v;
+	ctx->odrumstat = v;
     }
     else if (((unsigned)(i-0x40) < (unsigned)22) && ((i&7) < 6))
     {
 	if ((i&7) < 3) // Modulator
-	    cellfreq(base2cell[i-0x40],i-0x40,&cell[base2cell[i-0x40]]);
+	    cellfreq(ctx,base2cell[i-0x40],i-0x40,&cell[base2cell[i-0x40]]);
 	else          // Carrier
-	    cellfreq(base2cell[i-0x40],i-0x40,&cell[base2cell[i-0x40]+9]);
+	    cellfreq(ctx,base2cell[i-0x40],i-0x40,&cell[base2cell[i-0x40]+9]);
     }
     else if ((unsigned)(i-0xa0) < (unsigned)9)
     {
-	cellfreq(i-0xa0,modulatorbase[i-0xa0],&cell[i-0xa0]);
-	cellfreq(i-0xa0,modulatorbase[i-0xa0]+3,&cell[i-0xa0+9]);
+	cellfreq(ctx,i-0xa0,modulatorbase[i-0xa0],&cell[i-0xa0]);
+	cellfreq(ctx,i-0xa0,modulatorbase[i-0xa0]+3,&cell[i-0xa0+9]);
     }
     else if ((unsigned)(i-0xb0) < (unsigned)9)
     {
 	if ((v&32) > (tmp&32))
 	{
-	    cellon(i-0xb0,modulatorbase[i-0xb0],&cell[i-0xb0],0);
-	    cellon(i-0xb0,modulatorbase[i-0xb0]+3,&cell[i-0xb0+9],1);
+	    cellon(ctx,i-0xb0,modulatorbase[i-0xb0],&cell[i-0xb0],0);
+	    cellon(ctx,i-0xb0,modulatorbase[i-0xb0]+3,&cell[i-0xb0+9],1);
 	}
 	else if ((v&32) < (tmp&32))
 	    cell[i-0xb0].cellfunc = cell[i-0xb0+9].cellfunc = docell2;
-	cellfreq(i-0xb0,modulatorbase[i-0xb0],&cell[i-0xb0]);
-	cellfreq(i-0xb0,modulatorbase[i-0xb0]+3,&cell[i-0xb0+9]);
+	cellfreq(ctx,i-0xb0,modulatorbase[i-0xb0],&cell[i-0xb0]);
+	cellfreq(ctx,i-0xb0,modulatorbase[i-0xb0]+3,&cell[i-0xb0+9]);
     }
 
     //outdata(i,v);
@@ -436,20 +427,38 @@ static void clipit16(float f,short *a) {
 }
 #endif
 
-void adlibsetvolume(int i) {
-    AMPSCALE=i;
+void adlibsetvolume(adlibemu_context *ctx, int i) {
+    ctx->ampscale=i;
 }
 
-void adlibgetsample (unsigned char *sndptr, long numbytes)
+/* Output formats of getsample() */
+#define OUT_U8    1
+#define OUT_S16   2
+#define OUT_S32   3     /* 16 bit scale, not clipped */
+#define OUT_FLOAT 4     /* 1.0 for 32768, not clipped */
+
+static void getsample (adlibemu_context *ctx, void *sndbuf, long numsamples, int format)
 {
-    long i, j, k=0, ns, endsamples, rptrs, numsamples;
+    long i, j, k=0, ns, endsamples, rptrs, l;
     celltype *cptr;
     float f;
-    short *sndptr2=(short *)sndptr;
-
-    numsamples = (numbytes>>(numspeakers+bytespersample-2));
-
-    if (bytespersample == 1) f = AMPSCALE/256.0; else f = AMPSCALE;
+    unsigned char *sndptr=(unsigned char *)sndbuf;
+    short *sndptr2=(short *)sndbuf;
+    int32_t *sndptr4=(int32_t *)sndbuf;
+    float *sndptrf=(float *)sndbuf;
+    long numspeakers = ctx->numspeakers;
+    unsigned char *adlibreg = ctx->adlibreg;
+    celltype *cell = ctx->cell;
+    float *lvol = ctx->lvol, *rvol = ctx->rvol;
+    long *lplc = ctx->lplc, *rplc = ctx->rplc;
+    long *nlvol = ctx->nlvol, *nrvol = ctx->nrvol;
+    long *nlplc = ctx->nlplc, *nrplc = ctx->nrplc;
+    float **rptr = ctx->rptr, **nrptr = ctx->nrptr;
+    float (*rbuf)[FIFOSIZ*2] = ctx->rbuf;
+    float *snd = ctx->snd;
+    long rend = ctx->rend;
+
+    if (format == OUT_U8) f = ctx->ampscale/256.0; else f = ctx->ampscale;
     if (numspeakers == 1)
     {
 	nlvol[0] = lvol[0]*f;
@@ -556,15 +565,24 @@ void adlibgetsample (unsigned char *sndptr, long numbytes)
 
 	if (numspeakers == 1)
 	{
-	    if (bytespersample == 1)
+	    switch (format)
 	    {
+	    case OUT_U8:
 		for(i=endsamples-1;i>=0;i--)
 		    clipit8(nrptr[0][i]*nlvol[0],sndptr+1);
-	    }
-	    else
-	    {
+		break;
+	    case OUT_S16:
 		for(i=endsamples-1;i>=0;i--)
 		    clipit16(nrptr[0][i]*nlvol[0],sndptr2+i);
+		break;
+	    case OUT_S32:
+		for(i=0;i<endsamples;i++)
+		    { ftol(nrptr[0][i]*nlvol[0],&l); sndptr4[i] = l; }
+		break;
+	    case OUT_FLOAT:
+		for(i=0;i<endsamples;i++)
+		    sndptrf[i] = nrptr[0][i]*nlvol[0]*(1.0f/32768.0f);
+		break;
 	    }
 	}
 	else
@@ -581,20 +599,51 @@ void adlibgetsample (unsigned char *sndptr, long numbytes)
 		nrplc[j] += endsamples;
 	    }
 
-	    if (bytespersample == 1)
+	    switch (format)
 	    {
+	    case OUT_U8:
 		for(i=(endsamples<<1)-1;i>=0;i--)
 		    clipit8(snd[i],sndptr+i);
-	    }
-	    else
-	    {
+		break;
+	    case OUT_S16:
 		for(i=(endsamples<<1)-1;i>=0;i--)
 		    clipit16(snd[i],sndptr2+i);
+		break;
+	    case OUT_S32:
+		for(i=0;i<(endsamples<<1);i++)
+		    { ftol(snd[i],&l); sndptr4[i] = l; }
+		break;
+	    case OUT_FLOAT:
+		for(i=0;i<(endsamples<<1);i++)
+		    sndptrf[i] = snd[i]*(1.0f/32768.0f);
+		break;
 	    }
 	}
 
 	sndptr = sndptr+(numspeakers*endsamples);
 	sndptr2 = sndptr2+(numspeakers*endsamples);
+	sndptr4 = sndptr4+(numspeakers*endsamples);
+	sndptrf = sndptrf+(numspeakers*endsamples);
 	rend = ((rend+endsamples)&(FIFOSIZ*2-1));
     }
+
+    ctx->rend = rend;
+}
+
+void adlibgetsample (adlibemu_context *ctx, void *sndbuf, long numbytes)
+{
+    long numspeakers = ctx->numspeakers, bytespersample = ctx->bytespersample;
+
+    getsample(ctx, sndbuf, numbytes>>(numspeakers+bytespersample-2),
+	      bytespersample == 1 ? OUT_U8 : OUT_S16);
+}
+
+void adlibgetsample32 (adlibemu_context *ctx, int32_t *sndbuf, long numsamples)
+{
+    getsample(ctx, sndbuf, numsamples, OUT_S32);
+}
+
+void adlibgetsamplef (adlibemu_context *ctx, float *sndbuf, long numsamples)
+{
+    getsample(ctx, sndbuf, numsamples, OUT_FLOAT);
 }
@@ -18,9 +18,59 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
-void adlibinit(long dasamplerate,long danumspeakers,long dabytespersample);
-void adlib0(long i,long v);
-void adlibgetsample(void *sndptr,long numbytes);
-void adlibsetvolume(int i);
-void randoinsts();
-extern float lvol[9],rvol[9],lplc[9],rplc[9];
+#ifndef H_ADPLUG_ADLIBEMU
+#define H_ADPLUG_ADLIBEMU
+
+#include <stdint.h>
+
+#define ADLIBEMU_MAXCELLS 18
+#define ADLIBEMU_WAVPREC 2048
+#define ADLIBEMU_FIFOSIZ 256
+
+/* !!!!! private section, do not access these members directly, except for */
+/* the speaker volume/delay settings lvol, rvol, lplc and rplc !!!!! */
+
+typedef struct
+{
+    float val, t, tinc, vol, sustain, amp, mfb;
+    float a0, a1, a2, a3, decaymul, releasemul;
+    short *waveform;
+    long wavemask;
+    void (*cellfunc)(void *, float);
+    unsigned char flags, dum0, dum1, dum2;
+} celltype;
+
+/* One emulated chip. Everything lives in here, so several instances can
+   exist (and render in different threads) at the same time. */
+typedef struct
+{
+    long numspeakers, bytespersample;
+    float recipsamp, ampscale;
+    celltype cell[ADLIBEMU_MAXCELLS];
+    signed short wavtable[ADLIBEMU_WAVPREC*3];
+    float nfrqmul[16];
+    unsigned char adlibreg[256], ksl[8][16];
+    unsigned char odrumstat;
+
+    float lvol[9], rvol[9];     /* Volume multiplier on left/right speaker */
+    long lplc[9], rplc[9];      /* Samples to delay on left/right speaker */
+
+    long nlvol[9], nrvol[9];
+    long nlplc[9], nrplc[9];
+    long rend;
+    float *rptr[9], *nrptr[9];
+    float rbuf[9][ADLIBEMU_FIFOSIZ*2];
+    float snd[ADLIBEMU_FIFOSIZ*2];
+} adlibemu_context;
+
+adlibemu_context *adlibcreate(long dasamplerate,long danumspeakers,long dabytespersample);
+void adlibdestroy(adlibemu_context *ctx);
+void adlibinit(adlibemu_context *ctx,long dasamplerate,long danumspeakers,long dabytespersample);
+void adlib0(adlibemu_context *ctx,long i,long v);
+void adlibgetsample(adlibemu_context *ctx,void *sndptr,long numbytes);
+/* 'numsamples' frames of the 16 bit scale resp. 1.0 for 32768 , not clipped */
+void adlibgetsample32(adlibemu_context *ctx,int32_t *sndptr,long numsamples);
+void adlibgetsamplef(adlibemu_context *ctx,float *sndptr,long numsamples);
+void adlibsetvolume(adlibemu_context *ctx,int i);
+
+#endif
@@ -75,45 +75,65 @@
 // List of all players that come with the standard AdPlug distribution
 const CPlayerDesc CAdPlug::allplayers[] = {
   CPlayerDesc(ChscPlayer::factory, "HSC-Tracker", ".hsc\0"),
-  CPlayerDesc(CsngPlayer::factory, "SNGPlay", ".sng\0"),
+  CPlayerDesc(CsngPlayer::factory, "SNGPlay", ".sng\0", CsngPlayer::probe),
   CPlayerDesc(CimfPlayer::factory, "Apogee IMF", ".imf\0.wlf\0.adlib\0"),
-  CPlayerDesc(Ca2mLoader::factory, "Adlib Tracker 2", ".a2m\0"),
+  CPlayerDesc(Ca2mLoader::factory, "Adlib Tracker 2", ".a2m\0",
+	      Ca2mLoader::probe),
   CPlayerDesc(CadtrackLoader::factory, "Adlib Tracker", ".sng\0"),
   CPlayerDesc(CamdLoader::factory, "AMUSIC", ".amd\0"),
-  CPlayerDesc(CbamPlayer::factory, "Bob's Adlib Music", ".bam\0"),
-  CPlayerDesc(CcmfPlayer::factory, "Creative Music File", ".cmf\0"),
+  CPlayerDesc(CbamPlayer::factory, "Bob's Adlib Music", ".bam\0",
+	      CbamPlayer::probe),
+  CPlayerDesc(CcmfPlayer::factory, "Creative Music File", ".cmf\0",
+	      CcmfPlayer::probe),
   CPlayerDesc(Cd00Player::factory, "Packed EdLib", ".d00\0"),
-  CPlayerDesc(CdfmLoader::factory, "Digital-FM", ".dfm\0"),
+  CPlayerDesc(CdfmLoader::factory, "Digital-FM", ".dfm\0", CdfmLoader::probe),
   CPlayerDesc(ChspLoader::factory, "HSC Packed", ".hsp\0"),
   CPlayerDesc(CksmPlayer::factory, "Ken Silverman Music", ".ksm\0"),
-  CPlayerDesc(CmadLoader::factory, "Mlat Adlib Tracker", ".mad\0"),
+  CPlayerDesc(CmadLoader::factory, "Mlat Adlib Tracker", ".mad\0",
+	      CmadLoader::probe),
   CPlayerDesc(CmidPlayer::factory, "MIDI", ".mid\0.sci\0.laa\0"),
-  CPlayerDesc(CmkjPlayer::factory, "MKJamz", ".mkj\0"),
-  CPlayerDesc(CcffLoader::factory, "Boomtracker", ".cff\0"),
+  CPlayerDesc(CmkjPlayer::factory, "MKJamz", ".mkj\0", CmkjPlayer::probe),
+  CPlayerDesc(CcffLoader::factory, "Boomtracker", ".cff\0", CcffLoader::probe),
   CPlayerDesc(CdmoLoader::factory, "TwinTeam", ".dmo\0"),
-  CPlayerDesc(Cs3mPlayer::factory, "Scream Tracker 3", ".s3m\0"),
-  CPlayerDesc(CdtmLoader::factory, "DeFy Adlib Tracker", ".dtm\0"),
-  CPlayerDesc(CfmcLoader::factory, "Faust Music Creator", ".sng\0"),
-  CPlayerDesc(CmtkLoader::factory, "MPU-401 Trakker", ".mtk\0"),
-  CPlayerDesc(CradLoader::factory, "Reality Adlib Tracker", ".rad\0"),
-  CPlayerDesc(CrawPlayer::factory, "RdosPlay RAW", ".raw\0"),
-  CPlayerDesc(Csa2Loader::factory, "Surprise! Adlib Tracker", ".sat\0.sa2\0"),
-  CPlayerDesc(CxadbmfPlayer::factory, "BMF Adlib Tracker", ".xad\0"),
-  CPlayerDesc(CxadflashPlayer::factory, "Flash", ".xad\0"),
-  CPlayerDesc(CxadhybridPlayer::factory, "Hybrid", ".xad\0"),
-  CPlayerDesc(CxadhypPlayer::factory, "Hypnosis", ".xad\0"),
-  CPlayerDesc(CxadpsiPlayer::factory, "PSI", ".xad\0"),
-  CPlayerDesc(CxadratPlayer::factory, "rat", ".xad\0"),
+  CPlayerDesc(Cs3mPlayer::factory, "Scream Tracker 3", ".s3m\0",
+	      Cs3mPlayer::probe),
+  CPlayerDesc(CdtmLoader::factory, "DeFy Adlib Tracker", ".dtm\0",
+	      CdtmLoader::probe),
+  CPlayerDesc(CfmcLoader::factory, "Faust Music Creator", ".sng\0",
+	      CfmcLoader::probe),
+  CPlayerDesc(CmtkLoader::factory, "MPU-401 Trakker", ".mtk\0",
+	      CmtkLoader::probe),
+  CPlayerDesc(CradLoader::factory, "Reality Adlib Tracker", ".rad\0",
+	      CradLoader::probe),
+  CPlayerDesc(CrawPlayer::factory, "RdosPlay RAW", ".raw\0",
+	      CrawPlayer::probe),
+  CPlayerDesc(Csa2Loader::factory, "Surprise! Adlib Tracker", ".sat\0.sa2\0",
+	      Csa2Loader::probe),
+  CPlayerDesc(CxadbmfPlayer::factory, "BMF Adlib Tracker", ".xad\0",
+	      CxadbmfPlayer::probe),
+  CPlayerDesc(CxadflashPlayer::factory, "Flash", ".xad\0",
+	      CxadflashPlayer::probe),
+  CPlayerDesc(CxadhybridPlayer::factory, "Hybrid", ".xad\0",
+	      CxadhybridPlayer::probe),
+  CPlayerDesc(CxadhypPlayer::factory, "Hypnosis", ".xad\0",
+	      CxadhypPlayer::probe),
+  CPlayerDesc(CxadpsiPlayer::factory, "PSI", ".xad\0", CxadpsiPlayer::probe),
+  CPlayerDesc(CxadratPlayer::factory, "rat", ".xad\0", CxadratPlayer::probe),
   CPlayerDesc(CldsPlayer::factory, "LOUDNESS Sound System", ".lds\0"),
   CPlayerDesc(Cu6mPlayer::factory, "Ultima 6 Music", ".m\0"),
   CPlayerDesc(CrolPlayer::factory, "Adlib Visual Composer", ".rol\0"),
-  CPlayerDesc(CxsmPlayer::factory, "eXtra Simple Music", ".xsm\0"),
-  CPlayerDesc(CdroPlayer::factory, "DOSBox Raw OPL v0.1", ".dro\0"),
-  CPlayerDesc(Cdro2Player::factory, "DOSBox Raw OPL v2.0", ".dro\0"),
-  CPlayerDesc(CmscPlayer::factory, "Adlib MSC Player", ".msc\0"),
+  CPlayerDesc(CxsmPlayer::factory, "eXtra Simple Music", ".xsm\0",
+	      CxsmPlayer::probe),
+  CPlayerDesc(CdroPlayer::factory, "DOSBox Raw OPL v0.1", ".dro\0",
+	      CdroPlayer::probe),
+  CPlayerDesc(Cdro2Player::factory, "DOSBox Raw OPL v2.0", ".dro\0",
+	      Cdro2Player::probe),
+  CPlayerDesc(CmscPlayer::factory, "Adlib MSC Player", ".msc\0",
+	      CmscPlayer::probe),
   CPlayerDesc(CrixPlayer::factory, "Softstar RIX OPL Music", ".rix\0"),
   CPlayerDesc(CadlPlayer::factory, "Westwood ADL", ".adl\0"),
-  CPlayerDesc(CjbmPlayer::factory, "JBM Adlib Music", ".jbm\0"),
+  CPlayerDesc(CjbmPlayer::factory, "JBM Adlib Music", ".jbm\0",
+	      CjbmPlayer::probe),
   CPlayerDesc()
 };
 
@@ -131,42 +151,82 @@ const CPlayers &CAdPlug::init_players(const CPlayerDesc pd[])
 const CPlayers CAdPlug::players = CAdPlug::init_players(CAdPlug::allplayers);
 CAdPlugDatabase *CAdPlug::database = 0;
 
+static bool match_extension(const CPlayerDesc *pd, const std::string &fn,
+			    const CFileProvider &fp)
+{
+  for(unsigned int j = 0; pd->get_extension(j); j++)
+    if(fp.extension(fn, pd->get_extension(j)))
+      return true;
+
+  return false;
+}
+
+static CPlayer *try_player(const CPlayerDesc *pd, const std::string &fn,
+			   Copl *opl, const CFileProvider &fp,
+			   CAdPlugDatabase *db)
+{
+  CPlayer *p = pd->factory(opl);
+
+  if(!p) return 0;
+  p->setdatabase(db);
+  if(!p->load(fn, fp)) {
+    delete p;
+    return 0;
+  }
+
+  return p;
+}
+
 CPlayer *CAdPlug::factory(const std::string &fn, Copl *opl, const CPlayers &pl,
-			  const CFileProvider &fp)
+			  const CFileProvider &fp, CAdPlugDatabase *db,
+			  const CPlayerDesc **desc)
 {
   CPlayer			*p;
   CPlayers::const_iterator	i;
-  unsigned int			j;
+  unsigned char			header[CPlayer::PROBE_SIZE];
+  unsigned long			size;
+  int				rank;
 
   AdPlug_LogWrite("*** CAdPlug::factory(\"%s\",opl,fp) ***\n", fn.c_str());
 
+  // Read the header once, for all players to probe
+  binistream *f = fp.open(fn);
+  if(!f) {
+    AdPlug_LogWrite("Can't open file!\n");
+    AdPlug_LogWrite("--- CAdPlug::factory ---\n");
+    return 0;
+  }
+  size = fp.filesize(f);
+  if(size > sizeof(header)) size = sizeof(header);
+  f->readString((char *)header, size);
+  fp.close(f);
+
   // Try a direct hit by file extension
   for(i = pl.begin(); i != pl.end(); i++)
-    for(j = 0; (*i)->get_extension(j); j++)
-      if(fp.extension(fn, (*i)->get_extension(j))) {
-	AdPlug_LogWrite("Trying direct hit: %s\n", (*i)->filetype.c_str());
-	if((p = (*i)->factory(opl))) {
-	  if(p->load(fn, fp)) {
-	    AdPlug_LogWrite("got it!\n");
-	    AdPlug_LogWrite("--- CAdPlug::factory ---\n");
-	    return p;
-	  } else
-	    delete p;
-	}
+    if(match_extension(*i, fn, fp) &&
+       (*i)->rank(header, size) != CPlayer::PROBE_NO) {
+      AdPlug_LogWrite("Trying direct hit: %s\n", (*i)->filetype.c_str());
+      if((p = try_player(*i, fn, opl, fp, db))) {
+	AdPlug_LogWrite("got it!\n");
+	AdPlug_LogWrite("--- CAdPlug::factory ---\n");
+	if(desc) *desc = *i;
+	return p;
       }
+    }
 
-  // Try all players, one by one
-  for(i = pl.begin(); i != pl.end(); i++) {
-    AdPlug_LogWrite("Trying: %s\n", (*i)->filetype.c_str());
-    if((p = (*i)->factory(opl))) {
-      if(p->load(fn, fp)) {
+  // Try the remaining players, those that recognize the file first
+  for(rank = CPlayer::PROBE_YES; rank > CPlayer::PROBE_NO; rank--)
+    for(i = pl.begin(); i != pl.end(); i++) {
+      if((*i)->rank(header, size) != rank || match_extension(*i, fn, fp))
+	continue;
+      AdPlug_LogWrite("Trying: %s\n", (*i)->filetype.c_str());
+      if((p = try_player(*i, fn, opl, fp, db))) {
         AdPlug_LogWrite("got it!\n");
         AdPlug_LogWrite("--- CAdPlug::factory ---\n");
+	if(desc) *desc = *i;
 	return p;
-      } else
-	delete p;
+      }
     }
-  }
 
   // Unknown file
   AdPlug_LogWrite("End of list!\n");
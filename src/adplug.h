@@ -39,7 +39,9 @@ public:
 
   static CPlayer *factory(const std::string &fn, Copl *opl,
 			  const CPlayers &pl = players,
-			  const CFileProvider &fp = CProvider_Filesystem());
+			  const CFileProvider &fp = CProvider_Filesystem(),
+			  CAdPlugDatabase *db = database,
+			  const CPlayerDesc **desc = 0);
 
   static void set_database(CAdPlugDatabase *db);
   static std::string get_version();
@@ -44,6 +44,7 @@ CPlayer *CadtrackLoader::factory(Copl *newopl)
 
 bool CadtrackLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   binistream *instf;
   char note[2];
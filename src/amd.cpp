@@ -31,6 +31,7 @@ CPlayer *CamdLoader::factory(Copl *newopl)
 
 bool CamdLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   struct {
     char id[9];
@@ -65,8 +65,14 @@ CPlayer *CbamPlayer::factory(Copl *newopl)
   return new CbamPlayer(newopl);
 }
 
+int CbamPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "CBMF", 4) ? PROBE_YES : PROBE_NO;
+}
+
 bool CbamPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+        clear_caches();
         binistream *f = fp.open(filename); if(!f) return false;
 	char id[4];
 	unsigned int i;
@@ -25,6 +25,7 @@ class CbamPlayer: public CPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
 	CbamPlayer(Copl *newopl)
 		: CPlayer(newopl), song(0)
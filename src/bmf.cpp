@@ -78,6 +78,11 @@ CPlayer *CxadbmfPlayer::factory(Copl *newopl)
   return new CxadbmfPlayer(newopl);
 }
 
+int CxadbmfPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_fmt(header, size, BMF);
+}
+
 bool CxadbmfPlayer::xadplayer_load()
 {
   unsigned short ptr = 0;
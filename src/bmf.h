@@ -25,6 +25,7 @@ class CxadbmfPlayer: public CxadPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CxadbmfPlayer(Copl *newopl): CxadPlayer(newopl)
     { };
@@ -37,8 +37,15 @@ CPlayer *CcffLoader::factory(Copl *newopl)
   return new CcffLoader(newopl);
 }
 
+int CcffLoader::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "<CUD-FM-File>""\x1A\xDE\xE0", 16) ?
+    PROBE_YES : PROBE_NO;
+}
+
 bool CcffLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   const unsigned char conv_inst[11] = { 2,1,10,9,4,3,6,5,0,8,7 };
   const unsigned short conv_note[12] = { 0x16B, 0x181, 0x198, 0x1B0, 0x1CA, 0x1E5, 0x202, 0x220, 0x241, 0x263, 0x287, 0x2AE };
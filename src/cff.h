@@ -25,6 +25,7 @@ class CcffLoader: public CmodPlayer
 {
  public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CcffLoader(Copl *newopl) : CmodPlayer(newopl) { };
 
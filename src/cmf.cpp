@@ -64,7 +64,7 @@
 // so any that aren't overridden are still available for use with these default
 // patches.  The Word Rescue CMFs are good examples of songs that rely on these
 // default patches.
-uint8_t cDefaultPatches[] =
+static const uint8_t cDefaultPatches[] =
 "\x01\x11\x4F\x00\xF1\xD2\x53\x74\x00\x00\x06"
 "\x07\x12\x4F\x00\xF2\xF2\x60\x72\x00\x00\x08"
 "\x31\xA1\x1C\x80\x51\x54\x03\x67\x00\x00\x0E"
@@ -88,6 +88,11 @@ CPlayer *CcmfPlayer::factory(Copl *newopl)
   return new CcmfPlayer(newopl);
 }
 
+int CcmfPlayer::probe(const unsigned char *header, unsigned long size)
+{
+	return probe_id(header, size, 0, "CTMF", 4) ? PROBE_YES : PROBE_NO;
+}
+
 CcmfPlayer::CcmfPlayer(Copl *newopl) :
 	CPlayer(newopl),
 	data(NULL),
@@ -109,6 +114,7 @@ CcmfPlayer::~CcmfPlayer()
 
 bool CcmfPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
 
 	char cSig[4];
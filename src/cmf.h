@@ -84,6 +84,7 @@ class CcmfPlayer: public CPlayer
 
 	public:
 		static CPlayer *factory(Copl *newopl);
+		static int probe(const unsigned char *header, unsigned long size);
 
 		CcmfPlayer(Copl *newopl);
 		~CcmfPlayer();
@@ -55,6 +55,7 @@ CPlayer *Cd00Player::factory(Copl *newopl)
 
 bool Cd00Player::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream	*f = fp.open(filename); if(!f) return false;
   d00header	*checkhead;
   d00header1	*ch;
@@ -479,6 +480,7 @@ void Cd00Player::setvolume(unsigned char chan)
   unsigned char	op = op_table[chan];
   unsigned short	insnr = channel[chan].inst;
 
+  if(timingonly) return;
   opl->write(0x43 + op,(int)(63-((63-(inst[insnr].data[2] & 63))/63.0)*(63-channel[chan].vol)) +
 	     (inst[insnr].data[2] & 192));
   if(inst[insnr].data[10] & 1)
@@ -492,6 +494,7 @@ void Cd00Player::setfreq(unsigned char chan)
 {
   unsigned short freq = channel[chan].freq;
 
+  if(timingonly) return;
   if(version == 4)	// v4: apply instrument finetune
     freq += inst[channel[chan].inst].tunelev;
 
@@ -508,6 +511,7 @@ void Cd00Player::setinst(unsigned char chan)
   unsigned char	op = op_table[chan];
   unsigned short	insnr = channel[chan].inst;
 
+  if(timingonly) return;
   // set instrument data
   opl->write(0x63 + op, inst[insnr].data[0]);
   opl->write(0x83 + op, inst[insnr].data[1]);
@@ -23,34 +23,91 @@
 
 #include <binio.h>
 #include <binfile.h>
+#include <binstr.h>
 #include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+
+#if defined(HAVE_SYS_MMAN_H)
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#elif defined(_WIN32)
+#  include <windows.h>
+#endif
 
 #include "database.h"
 
 #define DB_FILEID_V10	"AdPlug Module Information Database 1.0\x10"
 
-/***** CAdPlugDatabase *****/
+/*
+ * The index format starts with DB_FILEID_IDX10, the number of records and
+ * the size of the record pool. The index follows, sorted by CRC32, then
+ * CRC16, with entries of CRC32, CRC16, two reserved bytes and the offset
+ * of the record in the pool. The pool holds the records in index order,
+ * written as in the 1.0 format. All integers are little endian.
+ */
+#define DB_FILEID_IDX10	"AdPlug Module Information Index 1.0\x10"
+#define DB_IDX_HEADER	(sizeof(DB_FILEID_IDX10) - 1 + 8)
+#define DB_IDX_ENTRY	12
 
-const unsigned short CAdPlugDatabase::hash_radix = 0xfff1;	// should be prime
+struct CAdPlugDatabase::MappedRecord {
+  std::atomic<CRecord *>	record;		// made by search(), or 0
+  bool				taken;		// added by lookup() or wiped
+};
+
+/***** Local functions *****/
+
+static unsigned long get_le(const unsigned char *p, int n)
+/* Reads an 'n' byte little endian integer */
+{
+  unsigned long v = 0;
+
+  while(n--) v = (v << 8) | p[n];
+  return v;
+}
+
+static bool key_less(const CAdPlugDatabase::CRecord *a,
+		     const CAdPlugDatabase::CRecord *b)
+{
+  return a->key.crc32 < b->key.crc32 ||
+    (a->key.crc32 == b->key.crc32 && a->key.crc16 < b->key.crc16);
+}
+
+static void release(const unsigned char *data, unsigned long size)
+/* Releases a file mapped or read by CAdPlugDatabase::map() */
+{
+#if defined(HAVE_SYS_MMAN_H)
+  munmap((void *)data, size);
+#elif defined(_WIN32)
+  UnmapViewOfFile(data);
+#else
+  delete [] data;
+#endif
+}
+
+/***** CAdPlugDatabase *****/
 
 CAdPlugDatabase::CAdPlugDatabase()
-  : linear_index(0), linear_logic_length(0), linear_length(0)
+  : slots(0), slot_count(0), slot_used(0), linear_index(0),
+    linear_logic_length(0), mapped(0), mapped_records(0), mapped_size(0),
+    mapped_count(0)
 {
-  db_linear = new DB_Bucket * [hash_radix];
-  db_hashed = new DB_Bucket * [hash_radix];
-  memset(db_linear, 0, sizeof(DB_Bucket *) * hash_radix);
-  memset(db_hashed, 0, sizeof(DB_Bucket *) * hash_radix);
 }
 
 CAdPlugDatabase::~CAdPlugDatabase()
 {
   unsigned long i;
 
-  for(i = 0; i < linear_length; i++)
-    delete db_linear[i];
+  for(i = 0; i < records.size(); i++)
+    delete records[i];
 
-  delete [] db_linear;
-  delete [] db_hashed;
+  delete [] slots;
+  unmap();
 }
 
 bool CAdPlugDatabase::load(std::string db_name)
@@ -62,7 +119,7 @@ bool CAdPlugDatabase::load(std::string db_name)
 
 bool CAdPlugDatabase::load(binistream &f)
 {
-  unsigned int idlen = strlen(DB_FILEID_V10);
+  unsigned int idlen = strlen(DB_FILEID_V10), idxlen = strlen(DB_FILEID_IDX10);
   char *id = new char [idlen];
   unsigned long length;
 
@@ -70,12 +127,17 @@ bool CAdPlugDatabase::load(binistream &f)
   f.setFlag(binio::BigEndian, false); f.setFlag(binio::FloatIEEE);
 
   f.readString(id,idlen);
-  if(memcmp(id,DB_FILEID_V10,idlen)) {
+  if(!memcmp(id,DB_FILEID_IDX10,idxlen)) {
+    // Index format: the records follow the index
+    f.seek((long)idxlen - (long)idlen, binio::Add);
+    length = f.readInt(4);
+    f.seek(4 + length * DB_IDX_ENTRY, binio::Add);
+  } else if(memcmp(id,DB_FILEID_V10,idlen)) {
     delete [] id;
     return false;
-  }
+  } else
+    length = f.readInt(4);
   delete [] id;
-  length = f.readInt(4);
 
   // read records
   for(unsigned long i = 0; i < length; i++)
@@ -102,76 +164,289 @@ bool CAdPlugDatabase::save(binostream &f)
   f.writeInt(linear_logic_length, 4);
 
   // write records
-  for(i = 0; i < linear_length; i++)
-    if(!db_linear[i]->deleted)
-      db_linear[i]->record->write(f);
+  for(i = 0; i < records.size(); i++)
+    if(records[i])
+      records[i]->write(f);
 
   return true;
 }
 
-CAdPlugDatabase::CRecord *CAdPlugDatabase::search(CKey const &key)
+bool CAdPlugDatabase::map(std::string db_name)
 {
-  if(lookup(key)) return get_record(); else return 0;
+  unsigned int		idxlen = strlen(DB_FILEID_IDX10);
+  const unsigned char	*data = 0;
+  unsigned long		size = 0, count;
+
+#if defined(HAVE_SYS_MMAN_H)
+  struct stat	st;
+  int		fd = open(db_name.c_str(), O_RDONLY);
+
+  if(fd < 0) return false;
+  if(!fstat(fd, &st) && st.st_size > 0) {
+    void *p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(p != MAP_FAILED) { data = (const unsigned char *)p; size = st.st_size; }
+  }
+  close(fd);
+#elif defined(_WIN32)
+  HANDLE	file = CreateFileA(db_name.c_str(), GENERIC_READ, FILE_SHARE_READ,
+				   0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+  DWORD		high, low;
+
+  if(file == INVALID_HANDLE_VALUE) return false;
+  low = GetFileSize(file, &high);
+  if(low && low != INVALID_FILE_SIZE && !high) {
+    HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+    if(mapping) {
+      data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      if(data) size = low;
+      CloseHandle(mapping);
+    }
+  }
+  CloseHandle(file);
+#else
+  // No mapping on this system, so the file is read in one piece
+  FILE	*f = fopen(db_name.c_str(), "rb");
+  long	n;
+
+  if(!f) return false;
+  if(!fseek(f, 0, SEEK_END) && (n = ftell(f)) > 0 && !fseek(f, 0, SEEK_SET)) {
+    unsigned char *buf = new unsigned char[n];
+    if(fread(buf, 1, n, f) == (size_t)n) { data = buf; size = n; }
+    else delete [] buf;
+  }
+  fclose(f);
+#endif
+
+  if(!data) return false;
+
+  // Databases in the 1.0 format are loaded instead
+  if(size < DB_IDX_HEADER || memcmp(data, DB_FILEID_IDX10, idxlen)) {
+    release(data, size);
+    return load(db_name);
+  }
+
+  count = get_le(data + idxlen, 4);
+  if(count > (size - DB_IDX_HEADER) / DB_IDX_ENTRY ||
+     get_le(data + idxlen + 4, 4) > size - DB_IDX_HEADER - count * DB_IDX_ENTRY) {
+    release(data, size);
+    return false;
+  }
+
+  unmap();
+  mapped = data; mapped_size = size; mapped_count = count;
+
+  // Zeroed pages of a large index's record cache aren't touched until used
+  mapped_records = (MappedRecord *)calloc(count ? count : 1,
+					  sizeof(MappedRecord));
+  return true;
 }
 
-bool CAdPlugDatabase::lookup(CKey const &key)
+bool CAdPlugDatabase::save_index(std::string db_name)
+{
+  binofstream f(db_name);
+  if(f.error()) return false;
+  return save_index(f);
+}
+
+bool CAdPlugDatabase::save_index(binostream &f)
 {
-  unsigned long index = make_hash(key);
-  if(!db_hashed[index]) return false;
+  std::vector<CRecord *>	sorted;
+  std::vector<unsigned long>	offsets;
+  unsigned long			i;
+  long				start, pool, end;
 
-  // immediate hit ?
-  DB_Bucket *bucket = db_hashed[index];
+  for(i = 0; i < records.size(); i++)
+    if(records[i])
+      sorted.push_back(records[i]);
+  std::sort(sorted.begin(), sorted.end(), key_less);
+
+  // Save index as little endian with IEEE floats
+  f.setFlag(binio::BigEndian, false); f.setFlag(binio::FloatIEEE);
 
-  if(!bucket->deleted && bucket->record->key == key) {
-    linear_index = bucket->index;
+  // The index is written after the pool, when the offsets are known
+  start = f.pos();
+  f.writeString(DB_FILEID_IDX10);
+  f.writeInt(sorted.size(), 4);
+  f.writeInt(0, 4);
+  for(i = 0; i < sorted.size() * DB_IDX_ENTRY; i++)
+    f.writeInt(0, 1);
+
+  pool = f.pos();
+  for(i = 0; i < sorted.size(); i++) {
+    offsets.push_back(f.pos() - pool);
+    sorted[i]->write(f);
+  }
+  end = f.pos();
+
+  f.seek(start + strlen(DB_FILEID_IDX10) + 4);
+  f.writeInt(end - pool, 4);
+  for(i = 0; i < sorted.size(); i++) {
+    f.writeInt(sorted[i]->key.crc32, 4); f.writeInt(sorted[i]->key.crc16, 2);
+    f.writeInt(0, 2); f.writeInt(offsets[i], 4);
+  }
+  f.seek(end);
+
+  return !f.error();
+}
+
+CAdPlugDatabase::CRecord *CAdPlugDatabase::search(CKey const &key) const
+{
+  unsigned long	i = find(key);
+  CRecord	*record, *expected = 0;
+
+  if(i < records.size()) return records[i];
+  if(!mapped || (i = find_mapped(key)) == mapped_count ||
+     mapped_records[i].taken)
+    return 0;
+
+  // Records of the index are made once, by the first thread to finish one
+  if((record = mapped_records[i].record.load())) return record;
+  if(!(record = read_mapped(i))) return 0;
+  if(!mapped_records[i].record.compare_exchange_strong(expected, record)) {
+    delete record;
+    record = expected;
+  }
+
+  return record;
+}
+
+bool CAdPlugDatabase::lookup(CKey const &key)
+{
+  unsigned long i = find(key);
+  CRecord *record;
+
+  if(i < records.size()) {
+    linear_index = i;
     return true;
   }
 
-  // in-chain hit ?
-  bucket = db_hashed[index]->chain;
+  // Records found in the index move to the database, including the one
+  // search() made already. The index entry is skipped from then on, so a
+  // record wiped later stays wiped.
+  if(!mapped || (i = find_mapped(key)) == mapped_count ||
+     mapped_records[i].taken)
+    return false;
+  if(!(record = mapped_records[i].record.load()) && !(record = read_mapped(i)))
+    return false;
+  if(!add(record)) {
+    if(record != mapped_records[i].record.load()) delete record;
+    return false;
+  }
+
+  mapped_records[i].record = 0;
+  mapped_records[i].taken = true;
+  linear_index = records.size() - 1;
+  return true;
+}
 
-  while(bucket) {
-    if(!bucket->deleted && bucket->record->key == key) {
-      linear_index = bucket->index;
-      return true;
-    }
+unsigned long CAdPlugDatabase::find(CKey const &key) const
+/* Returns the index of the record with 'key', or records.size() if none */
+{
+  unsigned long s;
+
+  if(!slots) return records.size();
+
+  // Wiped records keep their slots, so they don't end the probing
+  for(s = make_hash(key) & (slot_count - 1); slots[s].index;
+      s = (s + 1) & (slot_count - 1)) {
+    CRecord *record = records[slots[s].index - 1];
 
-    bucket = bucket->chain;
+    if(slots[s].crc32 == (uint32_t)key.crc32 && record && record->key == key)
+      return slots[s].index - 1;
   }
 
-  return false;
+  return records.size();
 }
 
-bool CAdPlugDatabase::insert(CRecord *record)
+unsigned long CAdPlugDatabase::find_mapped(CKey const &key) const
+/* Returns the index entry of 'key' in the mapped index, or mapped_count */
 {
-  long index;
+  const unsigned char	*entry;
+  unsigned long		lo = 0, hi = mapped_count, mid, crc32, crc16;
 
+  while(lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    entry = mapped + DB_IDX_HEADER + mid * DB_IDX_ENTRY;
+    crc32 = get_le(entry, 4); crc16 = get_le(entry + 4, 2);
+
+    if(crc32 < key.crc32 || (crc32 == key.crc32 && crc16 < key.crc16))
+      lo = mid + 1;
+    else if(crc32 != key.crc32 || crc16 != key.crc16)
+      hi = mid;
+    else
+      return mid;
+  }
+
+  return mapped_count;
+}
+
+CAdPlugDatabase::CRecord *CAdPlugDatabase::read_mapped(unsigned long i) const
+/* Makes a new record from index entry 'i' */
+{
+  const unsigned char	*entry = mapped + DB_IDX_HEADER + i * DB_IDX_ENTRY;
+  unsigned long		pool = DB_IDX_HEADER + mapped_count * DB_IDX_ENTRY;
+  unsigned long		offset = get_le(entry + 8, 4), size;
+
+  // record type and size must lie within the file
+  if(offset > mapped_size - pool || mapped_size - pool - offset < 5)
+    return 0;
+  offset += pool;
+  size = get_le(mapped + offset + 1, 4);
+  if(size > mapped_size - offset - 5) return 0;
+
+  binisstream in((void *)(mapped + offset), size + 5);
+  in.setFlag(binio::BigEndian, false); in.setFlag(binio::FloatIEEE);
+  return CRecord::factory(in);
+}
+
+bool CAdPlugDatabase::insert(CRecord *record)
+{
   // sanity checks
   if(!record) return false;			// null-pointer given
-  if(linear_length == hash_radix) return false;	// max. db size exceeded
   if(lookup(record->key)) return false;		// record already in db
 
-  // make bucket
-  DB_Bucket *bucket = new DB_Bucket(linear_length, record);
-  if(!bucket) return false;
+  return add(record);
+}
 
-  // add to linear list
-  db_linear[linear_length] = bucket;
-  linear_logic_length++; linear_length++;
+bool CAdPlugDatabase::add(CRecord *record)
+{
+  if(records.size() >= 0xffffffffUL) return false;	// max. db size exceeded
 
-  // add to hashed list
-  index = make_hash(record->key);
+  // Keep at least half of the slots empty, counting those of wiped records
+  if((slot_used + 1) * 2 > slot_count) rehash();
 
-  if(!db_hashed[index])	// First entry in hashtable
-    db_hashed[index] = bucket;
-  else {		// Add entry in chained list
-    DB_Bucket *chain = db_hashed[index];
+  records.push_back(record);
+  put(record->key, records.size());
+  linear_logic_length++;
+  return true;
+}
 
-    while(chain->chain) chain = chain->chain;
-    chain->chain = bucket;
-  }
+void CAdPlugDatabase::put(CKey const &key, unsigned long index)
+/* Puts record number 'index' (counted from 1) into the first free slot */
+{
+  unsigned long s = make_hash(key) & (slot_count - 1);
 
-  return true;
+  while(slots[s].index) s = (s + 1) & (slot_count - 1);
+  slots[s].crc32 = (uint32_t)key.crc32;
+  slots[s].index = (uint32_t)index;
+  slot_used++;
+}
+
+void CAdPlugDatabase::rehash()
+/* Makes a table of at least four slots per record, without wiped records */
+{
+  unsigned long i, n = 64;
+
+  while(n < (linear_logic_length + 1) * 4) n *= 2;
+
+  delete [] slots;
+  slots = new Slot[n];
+  memset(slots, 0, sizeof(Slot) * n);
+  slot_count = n; slot_used = 0;
+
+  for(i = 0; i < records.size(); i++)
+    if(records[i])
+      put(records[i]->key, i + 1);
 }
 
 void CAdPlugDatabase::wipe(CRecord *record)
@@ -182,64 +457,115 @@ void CAdPlugDatabase::wipe(CRecord *record)
 
 void CAdPlugDatabase::wipe()
 {
-  if(!linear_length) return;
-
-  DB_Bucket *bucket = db_linear[linear_index];
+  if(linear_index >= records.size() || !records[linear_index]) return;
 
-  if(!bucket->deleted) {
-    delete bucket->record;
-    linear_logic_length--;
-    bucket->deleted = true;
-  }
+  delete records[linear_index];
+  records[linear_index] = 0;
+  linear_logic_length--;
 }
 
 CAdPlugDatabase::CRecord *CAdPlugDatabase::get_record()
 {
-  if(!linear_length) return 0;
-  return db_linear[linear_index]->record;
+  if(linear_index >= records.size()) return 0;
+  return records[linear_index];
 }
 
 bool CAdPlugDatabase::go_forward()
 {
-  if(linear_index + 1 < linear_length) {
-    linear_index++;
-    return true;
-  } else
-    return false;
+  return step(linear_index, true);
 }
 
 bool CAdPlugDatabase::go_backward()
 {
-  if(!linear_index) return false;
-  linear_index--;
-  return true;
+  return step(linear_index, false);
 }
 
 void CAdPlugDatabase::goto_begin()
-{	
-  if(linear_length) linear_index = 0;
+{
+  if(records.empty()) return;
+  linear_index = 0;
+  if(!records[0]) step(linear_index, true);
 }
 
 void CAdPlugDatabase::goto_end()
 {
-  if(linear_length) linear_index = linear_length - 1;
+  if(records.empty()) return;
+  linear_index = records.size() - 1;
+  if(!records[linear_index]) step(linear_index, false);
+}
+
+bool CAdPlugDatabase::step(unsigned long &index, bool forward) const
+/* Moves 'index' to the next or previous record that isn't wiped */
+{
+  unsigned long i;
+
+  if(forward) {
+    for(i = index + 1; i < records.size(); i++)
+      if(records[i]) { index = i; return true; }
+  } else
+    for(i = index; i > 0; i--)
+      if(records[i - 1]) { index = i - 1; return true; }
+
+  return false;
+}
+
+void CAdPlugDatabase::unmap()
+{
+  unsigned long i;
+
+  if(!mapped) return;
+  for(i = 0; i < mapped_count; i++)
+    delete mapped_records[i].record.load();
+  free(mapped_records);
+  release(mapped, mapped_size);
+  mapped = 0; mapped_records = 0; mapped_size = mapped_count = 0;
+}
+
+inline unsigned long CAdPlugDatabase::make_hash(CKey const &key) const
+{
+  // Keys typed in by users needn't be spread well, so all bits are mixed
+  uint32_t h = (uint32_t)key.crc32 ^ ((uint32_t)key.crc16 * 0x85ebca6bU);
+
+  h ^= h >> 16; h *= 0x7feb352dU;
+  h ^= h >> 15; h *= 0x846ca68bU;
+  return h ^ (h >> 16);
+}
+
+/***** CAdPlugDatabase::CIterator *****/
+
+CAdPlugDatabase::CIterator::CIterator(const CAdPlugDatabase &newdb)
+  : db(newdb), index(0)
+{
+  goto_begin();
+}
+
+CAdPlugDatabase::CRecord *CAdPlugDatabase::CIterator::get_record() const
+{
+  if(index >= db.records.size()) return 0;
+  return db.records[index];
 }
 
-inline unsigned long CAdPlugDatabase::make_hash(CKey const &key)
+bool CAdPlugDatabase::CIterator::go_forward()
 {
-  return (key.crc32 + key.crc16) % hash_radix;
+  return db.step(index, true);
 }
 
-/***** CAdPlugDatabase::DB_Bucket *****/
+bool CAdPlugDatabase::CIterator::go_backward()
+{
+  return db.step(index, false);
+}
 
-CAdPlugDatabase::DB_Bucket::DB_Bucket(unsigned long nindex, CRecord *newrecord, DB_Bucket *newchain)
-  : index(nindex), deleted(false), chain(newchain), record(newrecord)
+void CAdPlugDatabase::CIterator::goto_begin()
 {
+  index = 0;
+  if(!db.records.empty() && !db.records[0]) db.step(index, true);
 }
 
-CAdPlugDatabase::DB_Bucket::~DB_Bucket()
+void CAdPlugDatabase::CIterator::goto_end()
 {
-  if(!deleted) delete record;
+  if(db.records.empty()) return;
+  index = db.records.size() - 1;
+  if(!db.records[index]) db.step(index, false);
 }
 
 /***** CAdPlugDatabase::CRecord *****/
@@ -315,7 +641,14 @@ CAdPlugDatabase::CKey::CKey(binistream &buf)
   make(buf);
 }
 
-bool CAdPlugDatabase::CKey::operator==(const CKey &key)
+CAdPlugDatabase::CKey::CKey(const void *data, unsigned long size)
+  : crc16(0), crc32(0xffffffff)
+{
+  update((const unsigned char *)data, size);
+  finish();
+}
+
+bool CAdPlugDatabase::CKey::operator==(const CKey &key) const
 {
   return ((crc16 == key.crc16) && (crc32 == key.crc32));
 }
@@ -323,33 +656,91 @@ bool CAdPlugDatabase::CKey::operator==(const CKey &key)
 void CAdPlugDatabase::CKey::make(binistream &buf)
 // Key is CRC16:CRC32 pair. CRC16 and CRC32 calculation routines (c) Zhengxi
 {
-  static const unsigned short magic16 = 0xa001;
-  static const unsigned long  magic32 = 0xedb88320;
+  char		data[4096];
+  unsigned long	n;
+
+  crc16 = 0; crc32 = 0xffffffff;
+  if(buf.eof()) { crc32 = 0; return; }
+
+  do {
+    n = buf.readString(data, sizeof(data));
+    update((const unsigned char *)data, n);
+  } while(n == sizeof(data));
+
+  finish();
+}
+
+void CAdPlugDatabase::CKey::update(const unsigned char *p, unsigned long n)
+/* Adds 'n' bytes at 'p' to both CRCs, eight at a time */
+{
+  const CrcTables	&t = crc_tables();
+  uint32_t		c16 = crc16, c32 = crc32, lo, hi, x;
 
-  crc16 = 0; crc32 = ~0;
+  for(; n >= 8; n -= 8, p += 8) {
+    lo = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    hi = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
 
-  while(!buf.eof())
-    {
-      unsigned char byte = buf.readInt(1);
+    x = c32 ^ lo;
+    c32 = t.crc32[7][x & 0xff] ^ t.crc32[6][(x >> 8) & 0xff] ^
+      t.crc32[5][(x >> 16) & 0xff] ^ t.crc32[4][x >> 24] ^
+      t.crc32[3][hi & 0xff] ^ t.crc32[2][(hi >> 8) & 0xff] ^
+      t.crc32[1][(hi >> 16) & 0xff] ^ t.crc32[0][hi >> 24];
 
-      for (int j=0;j<8;j++)
-	{
-	  if ((crc16 ^ byte) & 1)
-	    crc16 = (crc16 >> 1) ^ magic16;
-	  else
-	    crc16 >>= 1;
+    x = c16 ^ lo;
+    c16 = t.crc16[7][x & 0xff] ^ t.crc16[6][(x >> 8) & 0xff] ^
+      t.crc16[5][(x >> 16) & 0xff] ^ t.crc16[4][x >> 24] ^
+      t.crc16[3][hi & 0xff] ^ t.crc16[2][(hi >> 8) & 0xff] ^
+      t.crc16[1][(hi >> 16) & 0xff] ^ t.crc16[0][hi >> 24];
+  }
+
+  for(; n; n--, p++) {
+    c32 = (c32 >> 8) ^ t.crc32[0][(c32 ^ *p) & 0xff];
+    c16 = (c16 >> 8) ^ t.crc16[0][(c16 ^ *p) & 0xff];
+  }
+
+  crc16 = c16; crc32 = c32;
+}
+
+void CAdPlugDatabase::CKey::finish()
+{
+  // Keys always took in the byte a file stream returns at its end, too
+  static const unsigned char eof = 0xff;
+
+  update(&eof, 1);
+  crc32 = ~crc32 & 0xffffffff;
+}
+
+const CAdPlugDatabase::CKey::CrcTables &CAdPlugDatabase::CKey::crc_tables()
+{
+  static const CrcTables tables;
+  return tables;
+}
+
+CAdPlugDatabase::CKey::CrcTables::CrcTables()
+/*
+ * crcN[0] is the usual table of one byte. crcN[k] is that of a byte
+ * followed by k zero bytes, to add eight bytes in one step.
+ */
+{
+  static const unsigned short magic16 = 0xa001;
+  static const unsigned long  magic32 = 0xedb88320;
+  int i, j, k;
 
-	  if ((crc32 ^ byte) & 1)
-	    crc32 = (crc32 >> 1) ^ magic32;
-	  else
-	    crc32 >>= 1;
+  for(i = 0; i < 256; i++) {
+    uint32_t c16 = i, c32 = i;
 
-	  byte >>= 1;
-	}
+    for(j = 0; j < 8; j++) {
+      c16 = c16 & 1 ? (c16 >> 1) ^ magic16 : c16 >> 1;
+      c32 = c32 & 1 ? (c32 >> 1) ^ magic32 : c32 >> 1;
     }
+    crc16[0][i] = c16; crc32[0][i] = c32;
+  }
 
-  crc16 &= 0xffff;
-  crc32  = ~crc32;
+  for(k = 1; k < 8; k++)
+    for(i = 0; i < 256; i++) {
+      crc16[k][i] = (crc16[k - 1][i] >> 8) ^ crc16[0][crc16[k - 1][i] & 0xff];
+      crc32[k][i] = (crc32[k - 1][i] >> 8) ^ crc32[0][crc32[k - 1][i] & 0xff];
+    }
 }
 
 /***** CInfoRecord *****/
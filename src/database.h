@@ -26,6 +26,8 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <stdint.h>
 #include <binio.h>
 
 class CAdPlugDatabase
@@ -38,12 +40,24 @@ public:
     unsigned long	crc32;
 
     CKey() {};
-    CKey(binistream &in);
+    CKey(binistream &in);			// key of the rest of a stream
+    CKey(const void *data, unsigned long size);	// key of a file in memory
 
-    bool operator==(const CKey &key);
+    bool operator==(const CKey &key) const;
 
   private:
+    struct CrcTables {
+      uint16_t	crc16[8][256];
+      uint32_t	crc32[8][256];
+
+      CrcTables();
+    };
+
+    static const CrcTables &crc_tables();
+
     void make(binistream &in);
+    void update(const unsigned char *data, unsigned long size);
+    void finish();
   };
 
   class CRecord
@@ -74,6 +88,26 @@ public:
     virtual bool user_write_own(std::ostream &out) = 0;
   };
 
+  // Walks the records in the order they were inserted, independently of
+  // the database's own position and of other iterators.
+  class CIterator
+  {
+  public:
+    CIterator(const CAdPlugDatabase &newdb);	// starts at the first record
+
+    CRecord *get_record() const;		// 0 if there are no records
+
+    bool	go_forward();
+    bool	go_backward();
+
+    void	goto_begin();
+    void	goto_end();
+
+  private:
+    const CAdPlugDatabase	&db;
+    unsigned long		index;
+  };
+
   CAdPlugDatabase();
   ~CAdPlugDatabase();
 
@@ -82,12 +116,22 @@ public:
   bool	save(std::string db_name);
   bool	save(binostream &f);
 
+  // Index format, searched in place. map() keeps the file mapped until the
+  // database is destroyed and creates records only when they are found.
+  bool	map(std::string db_name);
+  bool	save_index(std::string db_name);
+  bool	save_index(binostream &f);
+
   bool	insert(CRecord *record);
 
   void	wipe(CRecord *record);
   void	wipe();
 
-  CRecord *search(CKey const &key);
+  // search() only reads the database, so any number of threads can
+  // search it and walk it with CIterator, while none of them changes it.
+  // lookup() moves the database's position for get_record(), wipe() and
+  // the following methods instead.
+  CRecord *search(CKey const &key) const;
   bool lookup(CKey const &key);
 
   CRecord *get_record();
@@ -99,27 +143,35 @@ public:
   void	goto_end();
 
 private:
-  static const unsigned short hash_radix;
-
-  class DB_Bucket
-  {
-  public:
-    unsigned long	index;
-    bool		deleted;
-    DB_Bucket		*chain;
-
-    CRecord		*record;
-
-    DB_Bucket(unsigned long nindex, CRecord *newrecord, DB_Bucket *newchain = 0);
-    ~DB_Bucket();
+  // Open addressing hash table slot, with the CRC32 to skip most records
+  // without looking at them. 'index' counts records from 1, 0 is unused.
+  struct Slot {
+    uint32_t	crc32, index;
   };
 
-  DB_Bucket	**db_linear;
-  DB_Bucket	**db_hashed;
-
-  unsigned long	linear_index, linear_logic_length, linear_length;
-
-  unsigned long make_hash(CKey const &key);
+  std::vector<CRecord *>	records;	// in insertion order, 0 if wiped
+  Slot				*slots;
+  unsigned long			slot_count, slot_used;
+
+  unsigned long	linear_index, linear_logic_length;
+
+  // Entry of the mapped index, only defined in database.cpp, so this
+  // header doesn't need C++11 for its std::atomic.
+  struct MappedRecord;
+
+  const unsigned char		*mapped;	// mapped index file, or 0
+  MappedRecord			*mapped_records;
+  unsigned long			mapped_size, mapped_count;
+
+  unsigned long make_hash(CKey const &key) const;
+  unsigned long find(CKey const &key) const;
+  unsigned long find_mapped(CKey const &key) const;
+  CRecord *read_mapped(unsigned long i) const;
+  bool add(CRecord *record);
+  void put(CKey const &key, unsigned long index);
+  void rehash();
+  bool step(unsigned long &index, bool forward) const;
+  void unmap();
 };
 
 class CPlainRecord: public CAdPlugDatabase::CRecord
@@ -30,8 +30,14 @@ CPlayer *CdfmLoader::factory(Copl *newopl)
   return new CdfmLoader(newopl);
 }
 
+int CdfmLoader::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "DFM\x1a", 4) ? PROBE_YES : PROBE_NO;
+}
+
 bool CdfmLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   unsigned char		npats,n,note,fx,c,r,param;
   unsigned int		i;
@@ -25,6 +25,7 @@ class CdfmLoader: public CmodPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
 	CdfmLoader(Copl *newopl)
 		: CmodPlayer(newopl)
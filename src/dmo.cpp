@@ -51,6 +51,7 @@ CPlayer *CdmoLoader::factory(Copl *newopl)
 
 bool CdmoLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   int i,j;
   binistream *f;
 
@@ -37,6 +37,13 @@ CPlayer *CdroPlayer::factory(Copl *newopl)
   return new CdroPlayer(newopl);
 }
 
+int CdroPlayer::probe(const unsigned char *header, unsigned long size)
+{
+	// "DBRAWOPL", followed by version 1.0
+	return probe_id(header, size, 0, "DBRAWOPL\0\0\x01\0", 12) ?
+		PROBE_YES : PROBE_NO;
+}
+
 CdroPlayer::CdroPlayer(Copl *newopl) :
 	CPlayer(newopl),
 	data(0)
@@ -50,6 +57,7 @@ CdroPlayer::~CdroPlayer()
 
 bool CdroPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+	clear_caches();
 	binistream *f = fp.open(filename);
 	if (!f) return false;
 
@@ -41,6 +41,7 @@ class CdroPlayer: public CPlayer
 
 	public:
 		static CPlayer *factory(Copl *newopl);
+		static int probe(const unsigned char *header, unsigned long size);
 
 		CdroPlayer(Copl *newopl);
 		~CdroPlayer();
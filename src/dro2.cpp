@@ -29,6 +29,13 @@ CPlayer *Cdro2Player::factory(Copl *newopl)
   return new Cdro2Player(newopl);
 }
 
+int Cdro2Player::probe(const unsigned char *header, unsigned long size)
+{
+	// "DBRAWOPL", followed by version 2.0
+	return probe_id(header, size, 0, "DBRAWOPL\x02\0\0\0", 12) ?
+		PROBE_YES : PROBE_NO;
+}
+
 Cdro2Player::Cdro2Player(Copl *newopl) :
 	CPlayer(newopl),
 	piConvTable(NULL),
@@ -44,6 +51,7 @@ Cdro2Player::~Cdro2Player()
 
 bool Cdro2Player::load(const std::string &filename, const CFileProvider &fp)
 {
+	clear_caches();
 	binistream *f = fp.open(filename);
 	if (!f) return false;
 
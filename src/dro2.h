@@ -37,6 +37,7 @@ class Cdro2Player: public CPlayer
 
 	public:
 		static CPlayer *factory(Copl *newopl);
+		static int probe(const unsigned char *header, unsigned long size);
 
 		Cdro2Player(Copl *newopl);
 		~Cdro2Player();
@@ -25,6 +25,7 @@ class CdtmLoader: public CmodPlayer
 {
  public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CdtmLoader(Copl *newopl) : CmodPlayer(newopl) { };
 
@@ -19,10 +19,13 @@
  * emuopl.cpp - Emulated OPL, by Simon Peter <dn.tlp@gmx.net>
  */
 
+#include <string.h>
 #include "emuopl.h"
+#include "sampconv.h"
 
 CEmuopl::CEmuopl(int rate, bool bit16, bool usestereo)
-  : use16bit(bit16), stereo(usestereo), mixbufSamples(0)
+  : use16bit(bit16), stereo(usestereo), rate(rate), opl3(0), mixbufSamples(0),
+    stembufSamples(0), mute(0)
 {
   opl[0] = OPLCreate(OPL_TYPE_YM3812, 3579545, rate);
   opl[1] = OPLCreate(OPL_TYPE_YM3812, 3579545, rate);
@@ -35,50 +38,158 @@ CEmuopl::CEmuopl(int rate, bool bit16, bool usestereo)
 CEmuopl::~CEmuopl()
 {
   OPLDestroy(opl[0]); OPLDestroy(opl[1]);
+  if(opl3) OPLDestroy(opl3);
 
   if(mixbufSamples) {
     delete [] mixbuf0;
     delete [] mixbuf1;
   }
+  if(stembufSamples) delete [] stembuf;
+}
+
+// Chip output as 16-bit or unclipped 32-bit samples, for render()
+static void chip_update(FM_OPL *opl, short *buf, int samples)
+{
+  YM3812UpdateOne(opl, buf, samples);
+}
+
+static void chip_update(FM_OPL *opl, int32_t *buf, int samples)
+{
+  YM3812UpdateOne32(opl, buf, samples);
+}
+
+static void opl3_update(FM_OPL *opl, short *buf, int samples)
+{
+  YMF262UpdateOne(opl, buf, samples);
+}
+
+static void opl3_update(FM_OPL *opl, int32_t *buf, int samples)
+{
+  YMF262UpdateOne32(opl, buf, samples);
 }
 
 void CEmuopl::update(short *buf, int samples)
 {
-  int i;
+  growmixbuf(samples);
+
+  //if we are supposed to generate 16bit output,
+  //then we render directly to the actual waveform output "buf"
+  //if we are supposed to generate 8bit output,
+  //there is not enough room in "buf", so we render to mixbuf1
+  //and reduce it to 8bit into "buf" later.
+  //the chips use mixbuf0, which holds two 16bit temp buffers.
+  short *tempbuf = (short *)mixbuf0, *tempbuf2 = tempbuf + samples * 2;
+
+  if(use16bit)
+    render(buf, tempbuf, tempbuf2, samples);
+  else {
+    render((short *)mixbuf1, tempbuf, tempbuf2, samples);
+    sampconv_u8((short *)mixbuf1, (unsigned char *)buf,
+		stereo ? samples * 2 : samples);
+  }
+}
+
+void CEmuopl::update32(int32_t *buf, int samples)
+{
+  growmixbuf(samples);
+  render(buf, mixbuf0, mixbuf1, samples);
+}
+
+void CEmuopl::updatefloat(float *buf, int samples)
+{
+  //floats are as large as 32bit samples, so they are converted in place
+  update32((int32_t *)buf, samples);
+  sampconv_float((int32_t *)buf, buf, stereo ? samples * 2 : samples);
+}
+
+bool CEmuopl::updatestems(int32_t **bufs, int samples)
+{
+  int32_t	*chipbufs[MAX_CHANNELS], *s;
+  int		c, i;
+
+  switch(currType) {
+  case TYPE_OPL2:
+  case TYPE_DUAL_OPL2:
+    //each chip renders its 9 channels mono, which are then
+    //placed like render() places the chips
+    YM3812UpdateStems(opl[0], bufs, samples);
+    if(currType == TYPE_DUAL_OPL2)
+      YM3812UpdateStems(opl[1], bufs + 9, samples);
+
+    for(c = 0; c < MAX_CHANNELS; c++) {
+      if(!(s = bufs[c])) continue;
+
+      if(currType == TYPE_OPL2 && c >= 9)
+	memset(s, 0, (stereo ? samples * 2 : samples) * sizeof(int32_t));
+      else if(currType == TYPE_OPL2) {
+	if(stereo)
+	  for(i = samples - 1; i >= 0; i--)
+	    s[i * 2] = s[i * 2 + 1] = s[i];
+      } else if(stereo)
+	for(i = samples - 1; i >= 0; i--) {
+	  int32_t v = s[i];
+	  s[i * 2 + (c < 9)] = 0;
+	  s[i * 2 + (c >= 9)] = v;
+	}
+      else
+	for(i = 0; i < samples; i++)
+	  s[i] >>= 1;
+    }
+    break;
 
+  case TYPE_OPL3:
+    //the chip renders stereo stems, which mono output mixes down
+    //from a buffer of its own
+    if(stereo) {
+      YMF262UpdateStems(opl3, bufs, samples);
+      break;
+    }
+
+    if(stembufSamples < samples) {
+      if(stembufSamples) delete [] stembuf;
+      stembufSamples = samples;
+      stembuf = new int32_t[samples * 2 * MAX_CHANNELS];
+    }
+    for(c = 0; c < MAX_CHANNELS; c++)
+      chipbufs[c] = bufs[c] ? stembuf + c * samples * 2 : 0;
+    YMF262UpdateStems(opl3, chipbufs, samples);
+
+    for(c = 0; c < MAX_CHANNELS; c++)
+      if((s = bufs[c]))
+	for(i = 0; i < samples; i++)
+	  s[i] = (chipbufs[c][i * 2] >> 1) + (chipbufs[c][i * 2 + 1] >> 1);
+    break;
+  }
+
+  return true;
+}
+
+void CEmuopl::growmixbuf(int samples)
+{
   //ensure that our mix buffers are adequately sized
   if(mixbufSamples < samples) {
     if(mixbufSamples) { delete[] mixbuf0; delete[] mixbuf1; }
     mixbufSamples = samples;
 
     //*2 = make room for stereo, if we need it
-    mixbuf0 = new short[samples*2]; 
-    mixbuf1 = new short[samples*2];
+    mixbuf0 = new int32_t[samples*2];
+    mixbuf1 = new int32_t[samples*2];
   }
+}
 
-  //data should be rendered to outbuf
-  //tempbuf should be used as a temporary buffer
-  //if we are supposed to generate 16bit output,
-  //then outbuf may point directly to the actual waveform output "buf"
-  //if we are supposed to generate 8bit output,
-  //then outbuf cannot point to "buf" (because there will not be enough room)
-  //and so it must point to a mixbuf instead--
-  //it will be reduced to 8bit and put in "buf" later
-  short *outbuf;
-  short *tempbuf=mixbuf0;
-  short *tempbuf2=mixbuf1;
-  if(use16bit) outbuf = buf;
-  else outbuf = mixbuf1;
-  //...there is a potentially confusing situation where mixbuf1 can be aliased.
-  //beware. it is a little loony.
-
-  //all of the following rendering code produces 16bit output
+template<class T> void CEmuopl::render(T *outbuf, T *tempbuf, T *tempbuf2,
+				       int samples)
+{
+  int i;
+
+  //all of the following rendering code produces 16bit or 32bit output.
+  //tempbuf has room for stereo, tempbuf2 for mono
 
   switch(currType) {
   case TYPE_OPL2:
     //for opl2 mode:
     //render chip0 to the output buffer
-    YM3812UpdateOne(opl[0],outbuf,samples);
+    chip_update(opl[0],outbuf,samples);
 
     //if we are supposed to output stereo,
     //then we need to dup the mono channel
@@ -89,37 +200,39 @@ void CEmuopl::update(short *buf, int samples)
       }
     break;
 
-  case TYPE_OPL3:	// unsupported
+  case TYPE_OPL3:
+    //for opl3 mode:
+    //the chip renders stereo, to the output buffer
+    //or to tempbuf for mixing down to mono
+    if(stereo)
+      opl3_update(opl3,outbuf,samples);
+    else {
+      opl3_update(opl3,tempbuf,samples);
+      for(i=0;i<samples;i++)
+	outbuf[i] = (tempbuf[i*2]>>1) + (tempbuf[i*2+1]>>1);
+    }
     break;
 
   case TYPE_DUAL_OPL2:
     //for dual opl2 mode:
     //render each chip to a different tempbuffer
-    YM3812UpdateOne(opl[0],tempbuf2,samples);
-    YM3812UpdateOne(opl[1],tempbuf,samples);
+    chip_update(opl[0],tempbuf2,samples);
+    chip_update(opl[1],tempbuf,samples);
 
     //output stereo:
     //then we need to interleave the two buffers
-    if(stereo){
-      //first, spread tempbuf's samples across left channel
-      //left channel
-      for(i=0;i<samples;i++)
+    if(stereo)
+      for(i=0;i<samples;i++) {
 	outbuf[i*2] = tempbuf2[i];
-      //next, insert the samples from tempbuf2 into right channel
-      for(i=0;i<samples;i++)
 	outbuf[i*2+1] = tempbuf[i];
-    } else
+      }
+    else
       //output mono:
       //then we need to mix the two buffers into buf
       for(i=0;i<samples;i++)
 	outbuf[i] = (tempbuf[i]>>1) + (tempbuf2[i]>>1);
     break;
   }
-
-  //now reduce to 8bit if we need to
-  if(!use16bit)
-    for(i=0;i<(stereo ? samples*2 : samples);i++)
-      ((char *)buf)[i] = (outbuf[i] >> 8) ^ 0x80;
 }
 
 void CEmuopl::write(int reg, int val)
@@ -130,7 +243,10 @@ void CEmuopl::write(int reg, int val)
     OPLWrite(opl[currChip], 0, reg);
     OPLWrite(opl[currChip], 1, val);
     break;
-  case TYPE_OPL3:	// unsupported
+  case TYPE_OPL3:
+    //the second chip is the second register bank
+    OPLWrite(opl3, currChip ? 2 : 0, reg);
+    OPLWrite(opl3, 1, val);
     break;
   }
 }
@@ -138,10 +254,26 @@ void CEmuopl::write(int reg, int val)
 void CEmuopl::init()
 {
   OPLResetChip(opl[0]); OPLResetChip(opl[1]);
+  if(opl3) OPLResetChip(opl3);
   currChip = 0;
 }
 
 void CEmuopl::settype(ChipType type)
 {
+  if(type == TYPE_OPL3 && !opl3) {
+    opl3 = OPLCreate(OPL_TYPE_YMF262, 14318180, rate);
+    OPLSetMute(opl3, mute);
+  }
+
   currType = type;
 }
+
+bool CEmuopl::setmute(uint32_t mask)
+{
+  //the second OPL2 has the upper 9 channels, the OPL3 all of them
+  mute = mask;
+  OPLSetMute(opl[0], mask & 0x1ff);
+  OPLSetMute(opl[1], (mask >> 9) & 0x1ff);
+  if(opl3) OPLSetMute(opl3, mask);
+  return true;
+}
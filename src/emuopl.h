@@ -34,16 +34,28 @@ class CEmuopl: public Copl
   virtual ~CEmuopl();
 
   void update(short *buf, int samples);			// fill buffer
+  void update32(int32_t *buf, int samples);
+  void updatefloat(float *buf, int samples);
+  bool updatestems(int32_t **bufs, int samples);
   void write(int reg, int val);
 
   void init();
   void settype(ChipType type);
+  bool setmute(uint32_t mask);
 
  private:
   bool		use16bit, stereo;
+  int		rate;
   FM_OPL	*opl[2];				// OPL2 emulator data
-  short		*mixbuf0, *mixbuf1;
+  FM_OPL	*opl3;					// OPL3 emulator data, created on demand
+  int32_t	*mixbuf0, *mixbuf1;			// 'mixbufSamples' stereo frames each
   int		mixbufSamples;
+  int32_t	*stembuf;				// stereo stems for mono OPL3 output
+  int		stembufSamples;
+  uint32_t	mute;
+
+  void growmixbuf(int samples);
+  template<class T> void render(T *outbuf, T *tempbuf, T *tempbuf2, int samples);
 };
 
 #endif
@@ -86,6 +86,11 @@ CPlayer *CxadflashPlayer::factory(Copl *newopl)
   return new CxadflashPlayer(newopl);
 }
 
+int CxadflashPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_fmt(header, size, FLASH);
+}
+
 void CxadflashPlayer::xadplayer_rewind(int subsong)
 {
   int i;
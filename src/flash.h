@@ -25,6 +25,7 @@ class CxadflashPlayer: public CxadPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CxadflashPlayer(Copl *newopl): CxadPlayer(newopl)
     { };
@@ -29,8 +29,14 @@ CPlayer *CfmcLoader::factory(Copl *newopl)
   return new CfmcLoader(newopl);
 }
 
+int CfmcLoader::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "FMC!", 4) ? PROBE_YES : PROBE_NO;
+}
+
 bool CfmcLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   const unsigned char conv_fx[16] = {0,1,2,3,4,8,255,255,255,255,26,11,12,13,14,15};
 
@@ -25,6 +25,7 @@ class CfmcLoader: public CmodPlayer
 {
 	public:
 		static CPlayer *factory(Copl *newopl);
+		static int probe(const unsigned char *header, unsigned long size);
 
 		CfmcLoader(Copl *newopl) : CmodPlayer(newopl) { };
 
@@ -126,6 +126,13 @@ static const int slot_array[32]=
 	-1,-1,-1,-1,-1,-1,-1,-1
 };
 
+/* OPL3 4 operator channel pairs : Reg.104 bit of every channel, -1 if none */
+static const int ch4op_bit[18]=
+{
+	 0, 1, 2, 0, 1, 2,-1,-1,-1,
+	 3, 4, 5, 3, 4, 5,-1,-1,-1
+};
+
 /* key scale level */
 /* table is 3dB/OCT , DV converts this in TL step at 6dB/OCT */
 #define DV (EG_STEP/2)
@@ -189,18 +196,10 @@ static const INT32 SL_TABLE[16]={
 /* TotalLevel : 48 24 12  6  3 1.5 0.75 (dB) */
 /* TL_TABLE[ 0      to TL_MAX          ] : plus  section */
 /* TL_TABLE[ TL_MAX to TL_MAX+TL_MAX-1 ] : minus section */
-static INT32 *TL_TABLE;
-
-/* pointers to TL_TABLE with sinwave output offset */
-static INT32 **SIN_TABLE;
-
-/* LFO table */
-static INT32 *AMS_TABLE;
-static INT32 *VIB_TABLE;
-
-/* envelope output curve table */
-/* attack + decay + OFF */
-static INT32 ENV_CURVE[2*EG_ENT+1];
+/* SIN_TABLE holds pointers to TL_TABLE with sinwave output offset. */
+/* ENV_CURVE is the envelope output curve table: attack + decay + OFF */
+#define ENV_CURVE_SIZE (2*EG_ENT+1)
+/* All of them live in FM_OPL, see OPLOpenTable(). */
 
 /* multiple table */
 #define ML 2
@@ -215,28 +214,6 @@ static const UINT32 MUL_TABLE[16]= {
 static INT32 RATE_0[16]=
 {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
 
-/* -------------------- static state --------------------- */
-
-/* lock level of common table */
-static int num_lock = 0;
-
-/* work table */
-static void *cur_chip = NULL;	/* current chip point */
-/* currenct chip state */
-/* static OPLSAMPLE  *bufL,*bufR; */
-static OPL_CH *S_CH;
-static OPL_CH *E_CH;
-OPL_SLOT *SLOT7_1,*SLOT7_2,*SLOT8_1,*SLOT8_2;
-
-static INT32 outd[1];
-static INT32 ams;
-static INT32 vib;
-INT32  *ams_table;
-INT32  *vib_table;
-static INT32 amsIncr;
-static INT32 vibIncr;
-static INT32 feedback2;		/* connect for SLOT 2 */
-
 /* log output level */
 #define LOG_ERR  3      /* ERROR       */
 #define LOG_WAR  2      /* WARNING     */
@@ -328,7 +305,7 @@ INLINE void OPL_KEYOFF(OPL_SLOT *SLOT)
 
 /* ---------- calcrate Envelope Generator & Phase Generator ---------- */
 /* return : envelope output */
-INLINE UINT32 OPL_CALC_SLOT( OPL_SLOT *SLOT )
+INLINE UINT32 OPL_CALC_SLOT( FM_OPL *OPL, OPL_SLOT *SLOT )
 {
 	/* calcrate envelope generator */
 	if( (SLOT->evc+=SLOT->evs) >= SLOT->eve )
@@ -362,17 +339,33 @@ INLINE UINT32 OPL_CALC_SLOT( OPL_SLOT *SLOT )
 		}
 	}
 	/* calcrate envelope */
-	return SLOT->TLL+ENV_CURVE[SLOT->evc>>ENV_BITS]+(SLOT->ams ? ams : 0);
+	return SLOT->TLL+OPL->ENV_CURVE[SLOT->evc>>ENV_BITS]+(SLOT->ams ? OPL->ams : 0);
 }
 
 /* set algorythm connection */
-static void set_algorythm( OPL_CH *CH)
+static void set_algorythm( FM_OPL *OPL, OPL_CH *CH)
 {
-	INT32 *carrier = &outd[0];
-	CH->connect1 = CH->CON ? carrier : &feedback2;
+	INT32 *carrier = &OPL->outd;
+	CH->connect1 = CH->CON ? carrier : &OPL->feedback2;
 	CH->connect2 = carrier;
 }
 
+/* OPL3 4 operator mode of a channel */
+/* 0 : 2 operator channel , 1 : first of a pair , 2 : second of a pair */
+INLINE int CH_4OP(FM_OPL *OPL,int c)
+{
+	int b = ch4op_bit[c];
+
+	if( !OPL->opl3 || b < 0 || !((OPL->connect4op>>b)&1) ) return 0;
+	return (c%9) < 3 ? 1 : 2;
+}
+
+/* channel whose frequency and key drive the slots of channel c */
+INLINE OPL_CH *FREQ_CH(FM_OPL *OPL,int c)
+{
+	return &OPL->P_CH[CH_4OP(OPL,c) == 2 ? c-3 : c];
+}
+
 /* ---------- frequency counter for operater update ---------- */
 INLINE void CALC_FCSLOT(OPL_CH *CH,OPL_SLOT *SLOT)
 {
@@ -398,13 +391,14 @@ INLINE void set_mul(FM_OPL *OPL,int slot,int v)
 {
 	OPL_CH   *CH   = &OPL->P_CH[slot/2];
 	OPL_SLOT *SLOT = &CH->SLOT[slot&1];
+	OPL_CH   *FCH  = FREQ_CH(OPL,slot/2);
 
 	SLOT->mul    = MUL_TABLE[v&0x0f];
 	SLOT->KSR    = (v&0x10) ? 0 : 2;
 	SLOT->eg_typ = (v&0x20)>>5;
 	SLOT->vib    = (v&0x40);
 	SLOT->ams    = (v&0x80);
-	CALC_FCSLOT(CH,SLOT);
+	CALC_FCSLOT(FCH,SLOT);
 }
 
 /* set ksl & tl */
@@ -412,6 +406,7 @@ INLINE void set_ksl_tl(FM_OPL *OPL,int slot,int v)
 {
 	OPL_CH   *CH   = &OPL->P_CH[slot/2];
 	OPL_SLOT *SLOT = &CH->SLOT[slot&1];
+	OPL_CH   *FCH  = FREQ_CH(OPL,slot/2);
 	int ksl = v>>6; /* 0 / 1.5 / 3 / 6 db/OCT */
 
 	SLOT->ksl = ksl ? 3-ksl : 31;
@@ -419,7 +414,7 @@ INLINE void set_ksl_tl(FM_OPL *OPL,int slot,int v)
 
 	if( !(OPL->mode&0x80) )
 	{	/* not CSM latch total level */
-		SLOT->TLL = SLOT->TL + (CH->ksl_base>>SLOT->ksl);
+		SLOT->TLL = SLOT->TL + (FCH->ksl_base>>SLOT->ksl);
 	}
 }
 
@@ -458,15 +453,16 @@ INLINE void set_sl_rr(FM_OPL *OPL,int slot,int v)
 /* operator output calcrator */
 #define OP_OUT(slot,env,con)   slot->wavetable[((slot->Cnt+con)/(0x1000000/SIN_ENT))&(SIN_ENT-1)][env]
 /* ---------- calcrate one of channel ---------- */
-INLINE void OPL_CALC_CH( OPL_CH *CH )
+INLINE void OPL_CALC_CH( FM_OPL *OPL, OPL_CH *CH )
 {
 	UINT32 env_out;
 	OPL_SLOT *SLOT;
+	INT32 vib = OPL->vib;
 
-	feedback2 = 0;
+	OPL->feedback2 = 0;
 	/* SLOT 1 */
 	SLOT = &CH->SLOT[SLOT1];
-	env_out=OPL_CALC_SLOT(SLOT);
+	env_out=OPL_CALC_SLOT(OPL,SLOT);
 	if( env_out < EG_ENT-1 )
 	{
 		/* PG */
@@ -490,33 +486,121 @@ INLINE void OPL_CALC_CH( OPL_CH *CH )
 	}
 	/* SLOT 2 */
 	SLOT = &CH->SLOT[SLOT2];
-	env_out=OPL_CALC_SLOT(SLOT);
+	env_out=OPL_CALC_SLOT(OPL,SLOT);
 	if( env_out < EG_ENT-1 )
 	{
 		/* PG */
 		if(SLOT->vib) SLOT->Cnt += (SLOT->Incr*vib/VIB_RATE);
 		else          SLOT->Cnt += SLOT->Incr;
 		/* connectoion */
-		outd[0] += OP_OUT(SLOT,env_out, feedback2);
+		OPL->outd += OP_OUT(SLOT,env_out, OPL->feedback2);
+	}
+}
+
+/* ---------- calcrate one slot of a 4 operator channel ---------- */
+INLINE INT32 OPL_CALC_OP( FM_OPL *OPL, OPL_SLOT *SLOT, INT32 con )
+{
+	UINT32 env_out = OPL_CALC_SLOT(OPL,SLOT);
+
+	if( env_out >= EG_ENT-1 ) return 0;
+	/* PG */
+	if(SLOT->vib) SLOT->Cnt += (SLOT->Incr*OPL->vib/VIB_RATE);
+	else          SLOT->Cnt += SLOT->Incr;
+	return OP_OUT(SLOT,env_out,con);
+}
+
+/* ---------- calcrate OPL3 4 operator channel (CH and CH+3) ---------- */
+INLINE void OPL_CALC_CH4( FM_OPL *OPL, OPL_CH *CH )
+{
+	OPL_SLOT *SLOT = &CH->SLOT[SLOT1];
+	UINT32 env_out;
+	INT32 op1 = 0, op2, op3;
+
+	/* SLOT 1 , the only one with feedback */
+	env_out=OPL_CALC_SLOT(OPL,SLOT);
+	if( env_out < EG_ENT-1 )
+	{
+		/* PG */
+		if(SLOT->vib) SLOT->Cnt += (SLOT->Incr*OPL->vib/VIB_RATE);
+		else          SLOT->Cnt += SLOT->Incr;
+		/* connectoion */
+		if(CH->FB)
+		{
+			int feedback1 = (CH->op1_out[0]+CH->op1_out[1])>>CH->FB;
+			CH->op1_out[1] = CH->op1_out[0];
+			op1 = CH->op1_out[0] = OP_OUT(SLOT,env_out,feedback1);
+		}
+		else
+		{
+			op1 = OP_OUT(SLOT,env_out,0);
+		}
+	}else
+	{
+		CH->op1_out[1] = CH->op1_out[0];
+		CH->op1_out[0] = 0;
+	}
+
+	/* SLOT 2 , 3 , 4 */
+	switch( (CH->CON<<1) | CH[3].CON )
+	{
+	case 0: /* 1 -> 2 -> 3 -> 4 -> out */
+		op2 = OPL_CALC_OP(OPL,&CH->SLOT[SLOT2],op1);
+		op3 = OPL_CALC_OP(OPL,&CH[3].SLOT[SLOT1],op2);
+		OPL->outd += OPL_CALC_OP(OPL,&CH[3].SLOT[SLOT2],op3);
+		break;
+	case 1: /* (1 -> 2) + (3 -> 4) -> out */
+		OPL->outd += OPL_CALC_OP(OPL,&CH->SLOT[SLOT2],op1);
+		op3 = OPL_CALC_OP(OPL,&CH[3].SLOT[SLOT1],0);
+		OPL->outd += OPL_CALC_OP(OPL,&CH[3].SLOT[SLOT2],op3);
+		break;
+	case 2: /* 1 + (2 -> 3 -> 4) -> out */
+		OPL->outd += op1;
+		op2 = OPL_CALC_OP(OPL,&CH->SLOT[SLOT2],0);
+		op3 = OPL_CALC_OP(OPL,&CH[3].SLOT[SLOT1],op2);
+		OPL->outd += OPL_CALC_OP(OPL,&CH[3].SLOT[SLOT2],op3);
+		break;
+	case 3: /* 1 + (2 -> 3) + 4 -> out */
+		OPL->outd += op1;
+		op2 = OPL_CALC_OP(OPL,&CH->SLOT[SLOT2],0);
+		OPL->outd += OPL_CALC_OP(OPL,&CH[3].SLOT[SLOT1],op2);
+		OPL->outd += OPL_CALC_OP(OPL,&CH[3].SLOT[SLOT2],0);
+		break;
 	}
 }
 
 /* ---------- calcrate rythm block ---------- */
 #define WHITE_NOISE_db 6.0
-INLINE void OPL_CALC_RH( OPL_CH *CH )
+#define NOISE_SEED 1
+/* per chip noise bit, replaces rand() so that output does not depend on */
+/* other chips or threads */
+INLINE int OPL_NOISE( FM_OPL *OPL )
+{
+	OPL->noise = OPL->noise * 1103515245 + 12345;
+	return (OPL->noise >> 16) & 1;
+}
+
+/* output of BD , SD+HH and TAM+TOP-CY goes to out[0] , out[1] and out[2] */
+/* (channels 6 , 7 and 8 for OPL3 panning)                              */
+INLINE void OPL_CALC_RH( FM_OPL *OPL, OPL_CH *CH, INT32 *out )
 {
 	UINT32 env_tam,env_sd,env_top,env_hh;
-	int whitenoise = (rand()&1)*(WHITE_NOISE_db/EG_STEP);
+	int whitenoise = OPL_NOISE(OPL)*(WHITE_NOISE_db/EG_STEP);
 	INT32 tone8;
+	INT32 vib = OPL->vib;
+	INT32 feedback2;
 
 	OPL_SLOT *SLOT;
+	OPL_SLOT *SLOT7_1 = &CH[7].SLOT[SLOT1];
+	OPL_SLOT *SLOT7_2 = &CH[7].SLOT[SLOT2];
+	OPL_SLOT *SLOT8_1 = &CH[8].SLOT[SLOT1];
+	OPL_SLOT *SLOT8_2 = &CH[8].SLOT[SLOT2];
 	int env_out;
 
 	/* BD : same as FM serial mode and output level is large */
 	feedback2 = 0;
 	/* SLOT 1 */
 	SLOT = &CH[6].SLOT[SLOT1];
-	env_out=OPL_CALC_SLOT(SLOT);
+	env_out=OPL_CALC_SLOT(OPL,SLOT);
 	if( env_out < EG_ENT-1 )
 	{
 		/* PG */
@@ -541,24 +625,24 @@ INLINE void OPL_CALC_RH( OPL_CH *CH )
 	}
 	/* SLOT 2 */
 	SLOT = &CH[6].SLOT[SLOT2];
-	env_out=OPL_CALC_SLOT(SLOT);
+	env_out=OPL_CALC_SLOT(OPL,SLOT);
 	if( env_out < EG_ENT-1 )
 	{
 		/* PG */
 		if(SLOT->vib) SLOT->Cnt += (SLOT->Incr*vib/VIB_RATE);
 		else          SLOT->Cnt += SLOT->Incr;
 		/* connectoion */
-		outd[0] += OP_OUT(SLOT,env_out, feedback2)*2;
+		out[0] += OP_OUT(SLOT,env_out, feedback2)*2;
 	}
 
 	// SD  (17) = mul14[fnum7] + white noise
 	// TAM (15) = mul15[fnum8]
 	// TOP (18) = fnum6(mul18[fnum8]+whitenoise)
 	// HH  (14) = fnum7(mul18[fnum8]+whitenoise) + white noise
-	env_sd =OPL_CALC_SLOT(SLOT7_2) + whitenoise;
-	env_tam=OPL_CALC_SLOT(SLOT8_1);
-	env_top=OPL_CALC_SLOT(SLOT8_2);
-	env_hh =OPL_CALC_SLOT(SLOT7_1) + whitenoise;
+	env_sd =OPL_CALC_SLOT(OPL,SLOT7_2) + whitenoise;
+	env_tam=OPL_CALC_SLOT(OPL,SLOT8_1);
+	env_top=OPL_CALC_SLOT(OPL,SLOT8_2);
+	env_hh =OPL_CALC_SLOT(OPL,SLOT7_1) + whitenoise;
 
 	/* PG */
 	if(SLOT7_1->vib) SLOT7_1->Cnt += (2*SLOT7_1->Incr*vib/VIB_RATE);
@@ -574,16 +658,56 @@ INLINE void OPL_CALC_RH( OPL_CH *CH )
 
 	/* SD */
 	if( env_sd < EG_ENT-1 )
-		outd[0] += OP_OUT(SLOT7_1,env_sd, 0)*8;
+		out[1] += OP_OUT(SLOT7_1,env_sd, 0)*8;
 	/* TAM */
 	if( env_tam < EG_ENT-1 )
-		outd[0] += OP_OUT(SLOT8_1,env_tam, 0)*2;
+		out[2] += OP_OUT(SLOT8_1,env_tam, 0)*2;
 	/* TOP-CY */
 	if( env_top < EG_ENT-1 )
-		outd[0] += OP_OUT(SLOT7_2,env_top,tone8)*2;
+		out[2] += OP_OUT(SLOT7_2,env_top,tone8)*2;
 	/* HH */
 	if( env_hh  < EG_ENT-1 )
-		outd[0] += OP_OUT(SLOT7_2,env_hh,tone8)*2;
+		out[1] += OP_OUT(SLOT7_2,env_hh,tone8)*2;
+}
+
+/* ---------- idle channel skipping ---------- */
+/* A slot that is off stays silent until it is keyed on again. A channel */
+/* with both slots off only shifts out its feedback, which is done here  */
+/* at once for 'length' samples instead of calculating every sample.    */
+#define SLOT_IDLE(SLOT) ((SLOT)->evm == ENV_MOD_RR && (SLOT)->evc == EG_OFF)
+
+INLINE int CH_IDLE( OPL_CH *CH )
+{
+	return SLOT_IDLE(&CH->SLOT[SLOT1]) && SLOT_IDLE(&CH->SLOT[SLOT2]);
+}
+
+INLINE void OPL_SKIP_CH( OPL_CH *CH, int length )
+{
+	CH->op1_out[1] = length > 1 ? 0 : CH->op1_out[0];
+	CH->op1_out[0] = 0;
+}
+
+/* The rythm block also runs the noise generator and the phase of the */
+/* SD , TAM , TOP-CY and HH slots whether they are on or not. Without  */
+/* vibrato, these can be advanced at once, too.                       */
+INLINE int RH_IDLE( OPL_CH *CH )
+{
+	return CH_IDLE(&CH[6]) && CH_IDLE(&CH[7]) && CH_IDLE(&CH[8]) &&
+		!CH[7].SLOT[SLOT1].vib && !CH[7].SLOT[SLOT2].vib &&
+		!CH[8].SLOT[SLOT1].vib && !CH[8].SLOT[SLOT2].vib;
+}
+
+static void OPL_SKIP_RH( FM_OPL *OPL, OPL_CH *CH, int length )
+{
+	int i;
+
+	OPL_SKIP_CH(&CH[6],length);
+	CH[7].SLOT[SLOT1].Cnt += 2*CH[7].SLOT[SLOT1].Incr*(UINT32)length;
+	CH[7].SLOT[SLOT2].Cnt += (CH[7].fc*8)*(UINT32)length;
+	CH[8].SLOT[SLOT1].Cnt += CH[8].SLOT[SLOT1].Incr*(UINT32)length;
+	CH[8].SLOT[SLOT2].Cnt += (CH[8].fc*48)*(UINT32)length;
+	for( i=0; i < length ; i++ )
+		OPL_NOISE(OPL);
 }
 
 /* ----------- initialize time tabls ----------- */
@@ -617,17 +741,21 @@ static void init_timetables( FM_OPL *OPL , int ARRATE , int DRRATE )
 }
 
 /* ---------- generic table initialize ---------- */
-static int OPLOpenTable( void )
+/* The tables are built per chip rather than shared, so that creating,  */
+/* rendering and destroying chips needs no locking between threads.     */
+static int OPLOpenTable( FM_OPL *OPL )
 {
 	int s,t;
 	double rate;
 	int i,j;
 	double pom;
+	INT32 *TL_TABLE,**SIN_TABLE,*AMS_TABLE,*VIB_TABLE,*ENV_CURVE;
+	int waves = (OPL->type&OPL_TYPE_OPL3) ? 8 : 4;	/* OPL3 has 8 waveforms */
 
 	/* allocate dynamic tables */
 	if( (TL_TABLE = malloc(TL_MAX*2*sizeof(INT32))) == NULL)
 		return 0;
-	if( (SIN_TABLE = malloc(SIN_ENT*4 *sizeof(INT32 *))) == NULL)
+	if( (SIN_TABLE = malloc(SIN_ENT*waves *sizeof(INT32 *))) == NULL)
 	{
 		free(TL_TABLE);
 		return 0;
@@ -645,6 +773,19 @@ static int OPLOpenTable( void )
 		free(AMS_TABLE);
 		return 0;
 	}
+	if( (ENV_CURVE = malloc(ENV_CURVE_SIZE *sizeof(INT32))) == NULL)
+	{
+		free(TL_TABLE);
+		free(SIN_TABLE);
+		free(AMS_TABLE);
+		free(VIB_TABLE);
+		return 0;
+	}
+	OPL->TL_TABLE  = TL_TABLE;
+	OPL->SIN_TABLE = SIN_TABLE;
+	OPL->AMS_TABLE = AMS_TABLE;
+	OPL->VIB_TABLE = VIB_TABLE;
+	OPL->ENV_CURVE = ENV_CURVE;
 	/* make total level table */
 	for (t = 0;t < EG_ENT-1 ;t++){
 		rate = ((1<<TL_BITS)-1)/pow(10,EG_STEP*t/20);	/* dB -> voltage */
@@ -677,6 +818,18 @@ static int OPLOpenTable( void )
 		SIN_TABLE[SIN_ENT*2+s] = SIN_TABLE[s % (SIN_ENT/2)];
 		SIN_TABLE[SIN_ENT*3+s] = (s/(SIN_ENT/4))&1 ? &TL_TABLE[EG_ENT] : SIN_TABLE[SIN_ENT*2+s];
 	}
+	for (s = 0;s < SIN_ENT && waves > 4;s++)
+	{
+		/* OPL3 : sine and abs-sine at double speed in the first half */
+		SIN_TABLE[SIN_ENT*4+s] = s<(SIN_ENT/2) ? SIN_TABLE[(2*s)%SIN_ENT] : &TL_TABLE[EG_ENT];
+		SIN_TABLE[SIN_ENT*5+s] = s<(SIN_ENT/2) ? SIN_TABLE[(2*s)%(SIN_ENT/2)] : &TL_TABLE[EG_ENT];
+		/* square */
+		SIN_TABLE[SIN_ENT*6+s] = s<(SIN_ENT/2) ? &TL_TABLE[0] : &TL_TABLE[TL_MAX];
+		/* derived square : falls off by 0.1875 dB every 1/2048 of the period */
+		j = (s<(SIN_ENT/2) ? s : SIN_ENT-1-s) * (384.0/SIN_ENT/EG_STEP);
+		if( j > EG_ENT-1 ) j = EG_ENT-1;
+		SIN_TABLE[SIN_ENT*7+s] = s<(SIN_ENT/2) ? &TL_TABLE[j] : &TL_TABLE[TL_MAX+j];
+	}
 
 	/* envelope counter -> envelope output table */
 	for (i=0; i<EG_ENT; i++)
@@ -710,12 +863,13 @@ static int OPLOpenTable( void )
 }
 
 
-static void OPLCloseTable( void )
+static void OPLCloseTable( FM_OPL *OPL )
 {
-	free(TL_TABLE);
-	free(SIN_TABLE);
-	free(AMS_TABLE);
-	free(VIB_TABLE);
+	free(OPL->TL_TABLE);
+	free(OPL->SIN_TABLE);
+	free(OPL->AMS_TABLE);
+	free(OPL->VIB_TABLE);
+	free(OPL->ENV_CURVE);
 }
 
 /* CSM Key Controll */
@@ -756,31 +910,61 @@ static void OPL_initalize(FM_OPL *OPL)
 	OPL->vibIncr = OPL->rate ? (double)VIB_ENT*(1<<VIB_SHIFT) / OPL->rate * 6.4 * ((double)OPL->clock/3600000) : 0;
 }
 
+/* OPL3 : recalcrate the second channels of the 4 operator pairs, after */
+/* they were joined with or separated from the first ones              */
+static void OPL_UPDATE_4OP(FM_OPL *OPL)
+{
+	int c,s;
+
+	for(c = 0;c < OPL->max_ch;c++)
+	{
+		if(ch4op_bit[c] < 0 || (c%9) < 3) continue;
+		for(s = 0;s < 2;s++)
+			CALC_FCSLOT(FREQ_CH(OPL,c),&OPL->P_CH[c].SLOT[s]);
+	}
+}
+
 /* ---------- write a OPL registers ---------- */
+/* r is 0x000-0x0ff , or 0x100-0x1ff for the OPL3 second register bank */
 static void OPLWriteReg(FM_OPL *OPL, int r, int v)
 {
 	OPL_CH *CH;
-	int slot;
+	int slot,c,mode4op;
 	int block_fnum;
 
 	switch(r&0xe0)
 	{
 	case 0x00: /* 00-1f:controll */
+		if(r&0x100)
+		{	/* OPL3 */
+			switch(r&0xff)
+			{
+			case 0x04:	/* 4 operator channel pairs */
+				OPL->connect4op = v&0x3f;
+				OPL_UPDATE_4OP(OPL);
+				break;
+			case 0x05:	/* OPL3 mode */
+				OPL->opl3 = v&1;
+				OPL_UPDATE_4OP(OPL);
+				break;
+			}
+			return;
+		}
 		switch(r&0x1f)
 		{
 		case 0x01:
-			/* wave selector enable */
+			/* wave selector enable , always on for OPL3 */
 			if(OPL->type&OPL_TYPE_WAVESEL)
 			{
-				OPL->wavesel = v&0x20;
+				OPL->wavesel = (OPL->type&OPL_TYPE_OPL3) ? 0x20 : v&0x20;
 				if(!OPL->wavesel)
 				{
 					/* preset compatible mode */
 					int c;
 					for(c=0;c<OPL->max_ch;c++)
 					{
-						OPL->P_CH[c].SLOT[SLOT1].wavetable = &SIN_TABLE[0];
-						OPL->P_CH[c].SLOT[SLOT2].wavetable = &SIN_TABLE[0];
+						OPL->P_CH[c].SLOT[SLOT1].wavetable = &OPL->SIN_TABLE[0];
+						OPL->P_CH[c].SLOT[SLOT2].wavetable = &OPL->SIN_TABLE[0];
 					}
 				}
 			}
@@ -875,21 +1059,25 @@ static void OPLWriteReg(FM_OPL *OPL, int r, int v)
 	case 0x20:	/* am,vib,ksr,eg type,mul */
 		slot = slot_array[r&0x1f];
 		if(slot == -1) return;
+		if(r&0x100) slot += 18;
 		set_mul(OPL,slot,v);
 		return;
 	case 0x40:
 		slot = slot_array[r&0x1f];
 		if(slot == -1) return;
+		if(r&0x100) slot += 18;
 		set_ksl_tl(OPL,slot,v);
 		return;
 	case 0x60:
 		slot = slot_array[r&0x1f];
 		if(slot == -1) return;
+		if(r&0x100) slot += 18;
 		set_ar_dr(OPL,slot,v);
 		return;
 	case 0x80:
 		slot = slot_array[r&0x1f];
 		if(slot == -1) return;
+		if(r&0x100) slot += 18;
 		set_sl_rr(OPL,slot,v);
 		return;
 	case 0xa0:
@@ -899,8 +1087,8 @@ static void OPLWriteReg(FM_OPL *OPL, int r, int v)
 			/* amsep,vibdep,r,bd,sd,tom,tc,hh */
 			{
 			UINT8 rkey = OPL->rythm^v;
-			OPL->ams_table = &AMS_TABLE[v&0x80 ? AMS_ENT : 0];
-			OPL->vib_table = &VIB_TABLE[v&0x40 ? VIB_ENT : 0];
+			OPL->ams_table = &OPL->AMS_TABLE[v&0x80 ? AMS_ENT : 0];
+			OPL->vib_table = &OPL->VIB_TABLE[v&0x40 ? VIB_ENT : 0];
 			OPL->rythm  = v&0x3f;
 			if(OPL->rythm&0x20)
 			{
@@ -951,7 +1139,11 @@ static void OPLWriteReg(FM_OPL *OPL, int r, int v)
 		}
 		/* keyon,block,fnum */
 		if( (r&0x0f) > 8) return;
-		CH = &OPL->P_CH[r&0x0f];
+		c = (r&0x0f) + ((r&0x100) ? 9 : 0);
+		CH = &OPL->P_CH[c];
+		/* OPL3 4 operator pairs run on the first channel's frequency and key, */
+		/* the second channel's ones are only stored                          */
+		mode4op = CH_4OP(OPL,c);
 		if(!(r&0x10))
 		{	/* a0-a8 */
 			block_fnum  = (CH->block_fnum&0x1f00) | v;
@@ -962,16 +1154,26 @@ static void OPLWriteReg(FM_OPL *OPL, int r, int v)
 			block_fnum = ((v&0x1f)<<8) | (CH->block_fnum&0xff);
 			if(CH->keyon != keyon)
 			{
-				if( (CH->keyon=keyon) )
+				if( (CH->keyon=keyon) && mode4op != 2 )
 				{
 					CH->op1_out[0] = CH->op1_out[1] = 0;
 					OPL_KEYON(&CH->SLOT[SLOT1]);
 					OPL_KEYON(&CH->SLOT[SLOT2]);
+					if(mode4op == 1)
+					{
+						OPL_KEYON(&CH[3].SLOT[SLOT1]);
+						OPL_KEYON(&CH[3].SLOT[SLOT2]);
+					}
 				}
-				else
+				else if( mode4op != 2 )
 				{
 					OPL_KEYOFF(&CH->SLOT[SLOT1]);
 					OPL_KEYOFF(&CH->SLOT[SLOT2]);
+					if(mode4op == 1)
+					{
+						OPL_KEYOFF(&CH[3].SLOT[SLOT1]);
+						OPL_KEYOFF(&CH[3].SLOT[SLOT2]);
+					}
 				}
 			}
 		}
@@ -986,107 +1188,155 @@ static void OPLWriteReg(FM_OPL *OPL, int r, int v)
 			CH->fc = OPL->FN_TABLE[fnum]>>blockRv;
 			CH->kcode = CH->block_fnum>>9;
 			if( (OPL->mode&0x40) && CH->block_fnum&0x100) CH->kcode |=1;
-			CALC_FCSLOT(CH,&CH->SLOT[SLOT1]);
-			CALC_FCSLOT(CH,&CH->SLOT[SLOT2]);
+			if(mode4op != 2)
+			{
+				CALC_FCSLOT(CH,&CH->SLOT[SLOT1]);
+				CALC_FCSLOT(CH,&CH->SLOT[SLOT2]);
+			}
+			if(mode4op == 1)
+			{
+				CALC_FCSLOT(CH,&CH[3].SLOT[SLOT1]);
+				CALC_FCSLOT(CH,&CH[3].SLOT[SLOT2]);
+			}
 		}
 		return;
 	case 0xc0:
-		/* FB,C */
+		/* OPL3 panning,FB,C */
 		if( (r&0x0f) > 8) return;
-		CH = &OPL->P_CH[r&0x0f];
+		CH = &OPL->P_CH[(r&0x0f) + ((r&0x100) ? 9 : 0)];
 		{
 		int feedback = (v>>1)&7;
 		CH->FB   = feedback ? (8+1) - feedback : 0;
 		CH->CON = v&1;
-		set_algorythm(CH);
+		CH->pan = (v>>4)&3;
+		set_algorythm(OPL,CH);
 		}
 		return;
 	case 0xe0: /* wave type */
 		slot = slot_array[r&0x1f];
 		if(slot == -1) return;
+		if(r&0x100) slot += 18;
 		CH = &OPL->P_CH[slot/2];
 		if(OPL->wavesel)
 		{
 			/* LOG(LOG_INF,("OPL SLOT %d wave select %d\n",slot,v&3)); */
-			CH->SLOT[slot&1].wavetable = &SIN_TABLE[(v&0x03)*SIN_ENT];
+			/* OPL3 mode adds waveforms 4-7 */
+			CH->SLOT[slot&1].wavetable = &OPL->SIN_TABLE[(v&(OPL->opl3 ? 0x07 : 0x03))*SIN_ENT];
 		}
 		return;
 	}
 }
 
-/* lock/unlock for common table */
-static int OPL_LockTable(void)
-{
-	num_lock++;
-	if(num_lock>1) return 0;
-	/* first time */
-	cur_chip = NULL;
-	/* allocate total level table (128kb space) */
-	if( !OPLOpenTable() )
-	{
-		num_lock--;
-		return -1;
-	}
-	return 0;
-}
-
-static void OPL_UnLockTable(void)
-{
-	if(num_lock) num_lock--;
-	if(num_lock) return;
-	/* last time */
-	cur_chip = NULL;
-	OPLCloseTable();
-}
-
 #if (BUILD_YM3812 || BUILD_YM3526)
 /*******************************************************************************/
 /*		YM3812 local section                                                   */
 /*******************************************************************************/
 
 /* ---------- update one of chip ----------- */
-void YM3812UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
+/* to 'buf' , or to 'buf32' without limiting if that is given , or every */
+/* channel to its own buffer if 'stems' is given                         */
+static void YM3812Update(FM_OPL *OPL, OPLSAMPLE *buf, INT32 *buf32, INT32 **stems, int length)
 {
     int i;
 	int data;
-	OPLSAMPLE *buf = buffer;
 	UINT32 amsCnt  = OPL->amsCnt;
 	UINT32 vibCnt  = OPL->vibCnt;
 	UINT8 rythm = OPL->rythm&0x20;
 	OPL_CH *CH,*R_CH;
+	/* channel pointers */
+	OPL_CH *S_CH = OPL->P_CH;
+	OPL_CH *E_CH = &S_CH[9];
+	/* LFO state */
+	INT32 amsIncr = OPL->amsIncr;
+	INT32 vibIncr = OPL->vibIncr;
+	INT32 *ams_table = OPL->ams_table;
+	INT32 *vib_table = OPL->vib_table;
+	/* channels that are not idle , and which are not calculated */
+	OPL_CH *A_CH[9];
+	int a,c,n_ch = 0;
+	UINT32 skip = OPL->mute;
+	INT32 rh[3];
+
+	if(stems)
+		for( c=0; c < 9; c++ )
+		{
+			if( stems[c] ) memset(stems[c],0,length*sizeof(INT32));
+			else           skip |= 1<<c;
+		}
 
-	if( (void *)OPL != cur_chip ){
-		cur_chip = (void *)OPL;
-		/* channel pointers */
-		S_CH = OPL->P_CH;
-		E_CH = &S_CH[9];
-		/* rythm slot */
-		SLOT7_1 = &S_CH[7].SLOT[SLOT1];
-		SLOT7_2 = &S_CH[7].SLOT[SLOT2];
-		SLOT8_1 = &S_CH[8].SLOT[SLOT1];
-		SLOT8_2 = &S_CH[8].SLOT[SLOT2];
-		/* LFO state */
-		amsIncr = OPL->amsIncr;
-		vibIncr = OPL->vibIncr;
-		ams_table = OPL->ams_table;
-		vib_table = OPL->vib_table;
-	}
 	R_CH = rythm ? &S_CH[6] : E_CH;
-    for( i=0; i < length ; i++ )
+	for(CH=S_CH ; CH < R_CH ; CH++)
+	{
+		if( (skip>>(CH-S_CH))&1 ) continue;
+		if( CH_IDLE(CH) ) OPL_SKIP_CH(CH,length);
+		else              A_CH[n_ch++] = CH;
+	}
+	if( rythm && ((skip>>6)&7) == 7 )
+		rythm = 0;
+	if( rythm && RH_IDLE(S_CH) )
+	{
+		OPL_SKIP_RH(OPL,S_CH,length);
+		rythm = 0;
+	}
+
+	if( !n_ch && !rythm )
+	{	/* silent chip , only the LFOs run */
+		amsCnt += amsIncr*(UINT32)length;
+		vibCnt += vibIncr*(UINT32)length;
+		if(buf32)    memset(buf32,0,length*sizeof(INT32));
+		else if(buf) memset(buf,0,length*sizeof(OPLSAMPLE));
+	}
+	else if(stems) for( i=0; i < length ; i++ )
+	{
+		/* LFO */
+		OPL->ams = ams_table[(amsCnt+=amsIncr)>>AMS_SHIFT];
+		OPL->vib = vib_table[(vibCnt+=vibIncr)>>VIB_SHIFT];
+		/* FM part , one channel at a time */
+		for(a=0 ; a < n_ch ; a++)
+		{
+			OPL->outd = 0;
+			OPL_CALC_CH(OPL,A_CH[a]);
+			stems[A_CH[a]-S_CH][i] = OPL->outd >> OPL_OUTSB;
+		}
+		/* Rythn part */
+		if(rythm)
+		{
+			rh[0] = rh[1] = rh[2] = 0;
+			OPL_CALC_RH(OPL,S_CH,rh);
+			/* muted parts and those without a buffer stay silent */
+			for( c=0; c < 3; c++ )
+				if( !((skip>>(6+c))&1) ) stems[6+c][i] = rh[c] >> OPL_OUTSB;
+		}
+	}
+	else for( i=0; i < length ; i++ )
 	{
 		/*            channel A         channel B         channel C      */
 		/* LFO */
-		ams = ams_table[(amsCnt+=amsIncr)>>AMS_SHIFT];
-		vib = vib_table[(vibCnt+=vibIncr)>>VIB_SHIFT];
-		outd[0] = 0;
+		OPL->ams = ams_table[(amsCnt+=amsIncr)>>AMS_SHIFT];
+		OPL->vib = vib_table[(vibCnt+=vibIncr)>>VIB_SHIFT];
+		OPL->outd = 0;
 		/* FM part */
-		for(CH=S_CH ; CH < R_CH ; CH++)
-			OPL_CALC_CH(CH);
+		for(a=0 ; a < n_ch ; a++)
+			OPL_CALC_CH(OPL,A_CH[a]);
 		/* Rythn part */
 		if(rythm)
-			OPL_CALC_RH(S_CH);
+		{
+			rh[0] = rh[1] = rh[2] = 0;
+			OPL_CALC_RH(OPL,S_CH,rh);
+			if( skip )
+			{	/* muted parts are calculated , but not output */
+				for( c=0; c < 3; c++ )
+					if( !((skip>>(6+c))&1) ) OPL->outd += rh[c];
+			}
+			else OPL->outd += rh[0] + rh[1] + rh[2];
+		}
+		if(buf32)
+		{
+			buf32[i] = OPL->outd >> OPL_OUTSB;
+			continue;
+		}
 		/* limit check */
-		data = Limit( outd[0] , OPL_MAXOUT, OPL_MINOUT );
+		data = Limit( OPL->outd , OPL_MAXOUT, OPL_MINOUT );
 		/* store to sound buffer */
 		buf[i] = data >> OPL_OUTSB;
 	}
@@ -1102,8 +1352,191 @@ void YM3812UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
 	}
 #endif
 }
+
+void YM3812UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
+{
+	YM3812Update(OPL,buffer,NULL,NULL,length);
+}
+
+void YM3812UpdateOne32(FM_OPL *OPL, INT32 *buffer, int length)
+{
+	YM3812Update(OPL,NULL,buffer,NULL,length);
+}
+
+void YM3812UpdateStems(FM_OPL *OPL, INT32 **buffers, int length)
+{
+	YM3812Update(OPL,NULL,NULL,buffers,length);
+}
 #endif /* (BUILD_YM3812 || BUILD_YM3526) */
 
+/*******************************************************************************/
+/*		YMF262 local section                                                   */
+/*******************************************************************************/
+
+/* ---------- update one of chip , stereo ----------- */
+/* to 'buf' , 'buf32' or to every channel's 'stems' buffer as above */
+static void YMF262Update(FM_OPL *OPL, OPLSAMPLE *buf, INT32 *buf32, INT32 **stems, int length)
+{
+    int i,c;
+	int data;
+	UINT32 amsCnt  = OPL->amsCnt;
+	UINT32 vibCnt  = OPL->vibCnt;
+	UINT8 rythm = OPL->rythm&0x20;
+	/* channels , 2 operator ones only without OPL3 mode */
+	OPL_CH *S_CH = OPL->P_CH;
+	int max_ch = OPL->opl3 ? 18 : 9;
+	/* channels that are not idle , 4op ones and where they are output */
+	OPL_CH *A_CH[18];
+	UINT8 is4op[18],pan[18];
+	int a,n_ch = 0;
+	INT32 outl,outr,rh[3];
+	UINT8 rhpan[3];
+	OPL_CH *CH;
+	/* channels that are not calculated */
+	UINT32 skip = OPL->mute;
+	INT32 *stem;
+	/* LFO state */
+	INT32 amsIncr = OPL->amsIncr;
+	INT32 vibIncr = OPL->vibIncr;
+	INT32 *ams_table = OPL->ams_table;
+	INT32 *vib_table = OPL->vib_table;
+
+	if(stems)
+		for( c=0; c < 18; c++ )
+		{
+			if( stems[c] ) memset(stems[c],0,length*2*sizeof(INT32));
+			else           skip |= 1<<c;
+		}
+
+	for( c=0; c < max_ch; c++ )
+	{
+		CH = &S_CH[c];
+		if( rythm && c >= 6 && c < 9 ) continue;
+		if( (skip>>c)&1 ) continue;
+		switch( CH_4OP(OPL,c) )
+		{
+		case 1:
+			if( CH_IDLE(CH) && CH_IDLE(CH+3) ) OPL_SKIP_CH(CH,length);
+			else
+			{
+				A_CH[n_ch] = CH; is4op[n_ch] = 1;
+				pan[n_ch++] = CH->pan;
+			}
+			break;
+		case 2:	/* done with the first channel */
+			break;
+		default:
+			if( CH_IDLE(CH) ) OPL_SKIP_CH(CH,length);
+			else
+			{
+				A_CH[n_ch] = CH; is4op[n_ch] = 0;
+				pan[n_ch++] = OPL->opl3 ? CH->pan : 3;
+			}
+			break;
+		}
+	}
+	for( c=0; c < 3; c++ )
+		rhpan[c] = ((skip>>(6+c))&1) ? 0 : (OPL->opl3 ? S_CH[6+c].pan : 3);
+	if( rythm && ((skip>>6)&7) == 7 )
+		rythm = 0;
+	if( rythm && RH_IDLE(S_CH) )
+	{
+		OPL_SKIP_RH(OPL,S_CH,length);
+		rythm = 0;
+	}
+
+	if( !n_ch && !rythm )
+	{	/* silent chip , only the LFOs run */
+		amsCnt += amsIncr*(UINT32)length;
+		vibCnt += vibIncr*(UINT32)length;
+		if(buf32)    memset(buf32,0,length*2*sizeof(INT32));
+		else if(buf) memset(buf,0,length*2*sizeof(OPLSAMPLE));
+	}
+	else if(stems) for( i=0; i < length ; i++ )
+	{
+		/* LFO */
+		OPL->ams = ams_table[(amsCnt+=amsIncr)>>AMS_SHIFT];
+		OPL->vib = vib_table[(vibCnt+=vibIncr)>>VIB_SHIFT];
+		/* FM part */
+		for( a=0; a < n_ch; a++ )
+		{
+			OPL->outd = 0;
+			if( is4op[a] ) OPL_CALC_CH4(OPL,A_CH[a]);
+			else           OPL_CALC_CH(OPL,A_CH[a]);
+			stem = stems[A_CH[a]-S_CH];
+			if( pan[a]&1 ) stem[i*2] = OPL->outd >> OPL_OUTSB;
+			if( pan[a]&2 ) stem[i*2+1] = OPL->outd >> OPL_OUTSB;
+		}
+		/* Rythn part */
+		if(rythm)
+		{
+			rh[0] = rh[1] = rh[2] = 0;
+			OPL_CALC_RH(OPL,S_CH,rh);
+			for( c=0; c < 3; c++ )
+			{
+				if( rhpan[c]&1 ) stems[6+c][i*2] = rh[c] >> OPL_OUTSB;
+				if( rhpan[c]&2 ) stems[6+c][i*2+1] = rh[c] >> OPL_OUTSB;
+			}
+		}
+	}
+	else for( i=0; i < length ; i++ )
+	{
+		/* LFO */
+		OPL->ams = ams_table[(amsCnt+=amsIncr)>>AMS_SHIFT];
+		OPL->vib = vib_table[(vibCnt+=vibIncr)>>VIB_SHIFT];
+		outl = outr = 0;
+		/* FM part */
+		for( a=0; a < n_ch; a++ )
+		{
+			OPL->outd = 0;
+			if( is4op[a] ) OPL_CALC_CH4(OPL,A_CH[a]);
+			else           OPL_CALC_CH(OPL,A_CH[a]);
+			if( pan[a]&1 ) outl += OPL->outd;
+			if( pan[a]&2 ) outr += OPL->outd;
+		}
+		/* Rythn part */
+		if(rythm)
+		{
+			rh[0] = rh[1] = rh[2] = 0;
+			OPL_CALC_RH(OPL,S_CH,rh);
+			for( c=0; c < 3; c++ )
+			{
+				if( rhpan[c]&1 ) outl += rh[c];
+				if( rhpan[c]&2 ) outr += rh[c];
+			}
+		}
+		if(buf32)
+		{
+			buf32[i*2] = outl >> OPL_OUTSB;
+			buf32[i*2+1] = outr >> OPL_OUTSB;
+			continue;
+		}
+		/* limit check , store to sound buffer */
+		data = Limit( outl , OPL_MAXOUT, OPL_MINOUT );
+		buf[i*2] = data >> OPL_OUTSB;
+		data = Limit( outr , OPL_MAXOUT, OPL_MINOUT );
+		buf[i*2+1] = data >> OPL_OUTSB;
+	}
+
+	OPL->amsCnt = amsCnt;
+	OPL->vibCnt = vibCnt;
+}
+
+void YMF262UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
+{
+	YMF262Update(OPL,buffer,NULL,NULL,length);
+}
+
+void YMF262UpdateOne32(FM_OPL *OPL, INT32 *buffer, int length)
+{
+	YMF262Update(OPL,NULL,buffer,NULL,length);
+}
+
+void YMF262UpdateStems(FM_OPL *OPL, INT32 **buffers, int length)
+{
+	YMF262Update(OPL,NULL,NULL,buffers,length);
+}
+
 #if BUILD_Y8950
 
 void Y8950UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
@@ -1115,46 +1548,42 @@ void Y8950UpdateOne(FM_OPL *OPL, INT16 *buffer, int length)
 	UINT32 vibCnt  = OPL->vibCnt;
 	UINT8 rythm = OPL->rythm&0x20;
 	OPL_CH *CH,*R_CH;
+	/* channel pointers */
+	OPL_CH *S_CH = OPL->P_CH;
+	OPL_CH *E_CH = &S_CH[9];
+	/* LFO state */
+	INT32 amsIncr = OPL->amsIncr;
+	INT32 vibIncr = OPL->vibIncr;
+	INT32 *ams_table = OPL->ams_table;
+	INT32 *vib_table = OPL->vib_table;
 	YM_DELTAT *DELTAT = OPL->deltat;
 
 	/* setup DELTA-T unit */
 	YM_DELTAT_DECODE_PRESET(DELTAT);
 
-	if( (void *)OPL != cur_chip ){
-		cur_chip = (void *)OPL;
-		/* channel pointers */
-		S_CH = OPL->P_CH;
-		E_CH = &S_CH[9];
-		/* rythm slot */
-		SLOT7_1 = &S_CH[7].SLOT[SLOT1];
-		SLOT7_2 = &S_CH[7].SLOT[SLOT2];
-		SLOT8_1 = &S_CH[8].SLOT[SLOT1];
-		SLOT8_2 = &S_CH[8].SLOT[SLOT2];
-		/* LFO state */
-		amsIncr = OPL->amsIncr;
-		vibIncr = OPL->vibIncr;
-		ams_table = OPL->ams_table;
-		vib_table = OPL->vib_table;
-	}
 	R_CH = rythm ? &S_CH[6] : E_CH;
     for( i=0; i < length ; i++ )
 	{
 		/*            channel A         channel B         channel C      */
 		/* LFO */
-		ams = ams_table[(amsCnt+=amsIncr)>>AMS_SHIFT];
-		vib = vib_table[(vibCnt+=vibIncr)>>VIB_SHIFT];
-		outd[0] = 0;
+		OPL->ams = ams_table[(amsCnt+=amsIncr)>>AMS_SHIFT];
+		OPL->vib = vib_table[(vibCnt+=vibIncr)>>VIB_SHIFT];
+		OPL->outd = 0;
 		/* deltaT ADPCM */
 		if( DELTAT->portstate )
 			YM_DELTAT_ADPCM_CALC(DELTAT);
 		/* FM part */
 		for(CH=S_CH ; CH < R_CH ; CH++)
-			OPL_CALC_CH(CH);
+			OPL_CALC_CH(OPL,CH);
 		/* Rythn part */
 		if(rythm)
-			OPL_CALC_RH(S_CH);
+		{
+			INT32 rh[3] = { 0, 0, 0 };
+			OPL_CALC_RH(OPL,S_CH,rh);
+			OPL->outd += rh[0] + rh[1] + rh[2];
+		}
 		/* limit check */
-		data = Limit( outd[0] , OPL_MAXOUT, OPL_MINOUT );
+		data = Limit( OPL->outd , OPL_MAXOUT, OPL_MINOUT );
 		/* store to sound buffer */
 		buf[i] = data >> OPL_OUTSB;
 	}
@@ -1174,6 +1603,7 @@ void OPLResetChip(FM_OPL *OPL)
 
 	/* reset chip */
 	OPL->mode   = 0;	/* normal mode */
+	OPL->noise  = NOISE_SEED;
 	OPL_STATUS_RESET(OPL,0x7f);
 	/* reset with register write */
 	OPLWriteReg(OPL,0x01,0); /* wabesel disable */
@@ -1181,6 +1611,12 @@ void OPLResetChip(FM_OPL *OPL)
 	OPLWriteReg(OPL,0x03,0); /* Timer2 */
 	OPLWriteReg(OPL,0x04,0); /* IRQ mask clear */
 	for(i = 0xff ; i >= 0x20 ; i-- ) OPLWriteReg(OPL,i,0);
+	if(OPL->type&OPL_TYPE_OPL3)
+	{
+		OPLWriteReg(OPL,0x105,0); /* OPL2 mode */
+		OPLWriteReg(OPL,0x104,0); /* 2 operator channels only */
+		for(i = 0x1ff ; i >= 0x120 ; i-- ) OPLWriteReg(OPL,i,0);
+	}
 	/* reset OPerator paramater */
 	for( c = 0 ; c < OPL->max_ch ; c++ )
 	{
@@ -1189,7 +1625,7 @@ void OPLResetChip(FM_OPL *OPL)
 		for(s = 0 ; s < 2 ; s++ )
 		{
 			/* wave table */
-			CH->SLOT[s].wavetable = &SIN_TABLE[0];
+			CH->SLOT[s].wavetable = &OPL->SIN_TABLE[0];
 			/* CH->SLOT[s].evm = ENV_MOD_RR; */
 			CH->SLOT[s].evc = EG_OFF;
 			CH->SLOT[s].eve = EG_OFF+1;
@@ -1202,7 +1638,7 @@ void OPLResetChip(FM_OPL *OPL)
 		YM_DELTAT *DELTAT = OPL->deltat;
 
 		DELTAT->freqbase = OPL->freqbase;
-		DELTAT->output_pointer = outd;
+		DELTAT->output_pointer = &OPL->outd;
 		DELTAT->portshift = 5;
 		DELTAT->output_range = DELTAT_MIXING_LEVEL<<TL_BITS;
 		YM_DELTAT_ADPCM_Reset(DELTAT,0);
@@ -1217,9 +1653,8 @@ FM_OPL *OPLCreate(int type, int clock, int rate)
 	char *ptr;
 	FM_OPL *OPL;
 	int state_size;
-	int max_ch = 9; /* normaly 9 channels */
+	int max_ch = (type&OPL_TYPE_OPL3) ? 18 : 9; /* normaly 9 channels */
 
-	if( OPL_LockTable() ==-1) return NULL;
 	/* allocate OPL state space */
 	state_size  = sizeof(FM_OPL);
 	state_size += sizeof(OPL_CH)*max_ch;
@@ -1238,9 +1673,17 @@ FM_OPL *OPLCreate(int type, int clock, int rate)
 #endif
 	/* set channel state pointer */
 	OPL->type  = type;
-	OPL->clock = clock;
+	/* the YMF262 runs at 4 times the clock of the YM3812 for the same */
+	/* sample rate , everything else is calculated for the YM3812 one  */
+	OPL->clock = (type&OPL_TYPE_OPL3) ? clock/4 : clock;
 	OPL->rate  = rate;
 	OPL->max_ch = max_ch;
+	/* allocate total level table (128kb space) */
+	if( !OPLOpenTable(OPL) )
+	{
+		free(OPL);
+		return NULL;
+	}
 	/* init grobal tables */
 	OPL_initalize(OPL);
 	/* reset chip */
@@ -1276,7 +1719,7 @@ void OPLDestroy(FM_OPL *OPL)
 		opl_dbg_fp = NULL;
 	}
 #endif
-	OPL_UnLockTable();
+	OPLCloseTable(OPL);
 	free(OPL);
 }
 
@@ -1297,6 +1740,10 @@ void OPLSetUpdateHandler(FM_OPL *OPL,OPL_UPDATEHANDLER UpdateHandler,int param)
 	OPL->UpdateHandler = UpdateHandler;
 	OPL->UpdateParam = param;
 }
+void OPLSetMute(FM_OPL *OPL,UINT32 mask)
+{
+	OPL->mute = mask;
+}
 #if BUILD_Y8950
 void OPLSetPortHandler(FM_OPL *OPL,OPL_PORTHANDLER_W PortHandler_w,OPL_PORTHANDLER_R PortHandler_r,int param)
 {
@@ -1316,8 +1763,9 @@ void OPLSetKeyboardHandler(FM_OPL *OPL,OPL_PORTHANDLER_W KeyboardHandler_w,OPL_P
 int OPLWrite(FM_OPL *OPL,int a,int v)
 {
 	if( !(a&1) )
-	{	/* address port */
+	{	/* address port , the second one selects the OPL3 register bank 1 */
 		OPL->address = v & 0xff;
+		if( (a&2) && (OPL->type&OPL_TYPE_OPL3) ) OPL->address |= 0x100;
 	}
 	else
 	{	/* data port */
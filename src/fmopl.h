@@ -45,6 +45,7 @@ typedef unsigned char (*OPL_PORTHANDLER_R)(int param);
 #define OPL_TYPE_ADPCM     0x02  /* DELTA-T ADPCM unit */
 #define OPL_TYPE_KEYBOARD  0x04  /* keyboard interface */
 #define OPL_TYPE_IO        0x08  /* I/O port */
+#define OPL_TYPE_OPL3      0x10  /* OPL3 register set, stereo output */
 
 /* Saving is necessary for member of the 'R' mark for suspend/resume */
 /* ---------- OPL one of slot  ---------- */
@@ -91,6 +92,7 @@ typedef struct fm_opl_channel {
 	UINT32  fc;			/* Freq. Increment base                */
 	UINT32  ksl_base;	/* KeyScaleLevel Base step             */
 	UINT8 keyon;		/* key on/off flag                     */
+	UINT8 pan;			/* OPL3 output : bit0 left, bit1 right */
 } OPL_CH;
 
 /* OPL state */
@@ -100,7 +102,7 @@ typedef struct fm_opl_f {
 	int rate;			/* sampling rate (Hz)                */
 	double freqbase;	/* frequency base                    */
 	double TimerBase;	/* Timer base time (==sampling time) */
-	UINT8 address;		/* address register                  */
+	UINT16 address;		/* address register (bit 8 : OPL3 bank) */
 	UINT8 status;		/* status flag                       */
 	UINT8 statusmask;	/* status mask                       */
 	UINT32 mode;		/* Reg.08 : CSM , notesel,etc.       */
@@ -112,6 +114,9 @@ typedef struct fm_opl_f {
 	int	max_ch;			/* maximum channel                   */
 	/* Rythm sention */
 	UINT8 rythm;		/* Rythm mode , key flag */
+	/* OPL3 */
+	UINT8 opl3;			/* Reg.105 : OPL3 mode (NEW)         */
+	UINT8 connect4op;	/* Reg.104 : 4 operator channel pairs */
 #if BUILD_Y8950
 	/* Delta-T ADPCM unit (Y8950) */
 	YM_DELTAT *deltat;			/* DELTA-T ADPCM       */
@@ -138,6 +143,19 @@ typedef struct fm_opl_f {
 	INT32 vibIncr;
 	/* wave selector enable flag */
 	UINT8 wavesel;
+	/* render state (one set per chip, so chips can run concurrently) */
+	INT32 outd;			/* output accumulator                */
+	INT32 feedback2;	/* connect for SLOT 2                */
+	INT32 ams;			/* current AM level                  */
+	INT32 vib;			/* current vibrato level             */
+	UINT32 noise;		/* rhythm white noise generator      */
+	UINT32 mute;		/* channels that are not calculated  */
+	/* common tables, built per chip by OPLCreate() */
+	INT32 *TL_TABLE;	/* total level table                 */
+	INT32 **SIN_TABLE;	/* sinwave pointers into TL_TABLE    */
+	INT32 *AMS_TABLE;	/* LFO AM table                      */
+	INT32 *VIB_TABLE;	/* LFO vibrato table                 */
+	INT32 *ENV_CURVE;	/* envelope output curve             */
 	/* external event callback handler */
 	OPL_TIMERHANDLER  TimerHandler;		/* TIMER handler   */
 	int TimerParam;						/* TIMER parameter */
@@ -151,6 +169,7 @@ typedef struct fm_opl_f {
 #define OPL_TYPE_YM3526 (0)
 #define OPL_TYPE_YM3812 (OPL_TYPE_WAVESEL)
 #define OPL_TYPE_Y8950  (OPL_TYPE_ADPCM|OPL_TYPE_KEYBOARD|OPL_TYPE_IO)
+#define OPL_TYPE_YMF262 (OPL_TYPE_WAVESEL|OPL_TYPE_OPL3)
 
 FM_OPL *OPLCreate(int type, int clock, int rate);
 void OPLDestroy(FM_OPL *OPL);
@@ -160,6 +179,9 @@ void OPLSetUpdateHandler(FM_OPL *OPL,OPL_UPDATEHANDLER UpdateHandler,int param);
 /* Y8950 port handlers */
 void OPLSetPortHandler(FM_OPL *OPL,OPL_PORTHANDLER_W PortHandler_w,OPL_PORTHANDLER_R PortHandler_r,int param);
 void OPLSetKeyboardHandler(FM_OPL *OPL,OPL_PORTHANDLER_W KeyboardHandler_w,OPL_PORTHANDLER_R KeyboardHandler_r,int param);
+/* channels with their bit set in 'mask' are skipped by the update functions */
+/* ( bits 6-8 are BD , SD+HH and TAM+TOP-CY in rythm mode )                  */
+void OPLSetMute(FM_OPL *OPL,UINT32 mask);
 
 void OPLResetChip(FM_OPL *OPL);
 int OPLWrite(FM_OPL *OPL,int a,int v);
@@ -168,6 +190,18 @@ int OPLTimerOver(FM_OPL *OPL,int c);
 
 /* YM3626/YM3812 local section */
 void YM3812UpdateOne(FM_OPL *OPL, INT16 *buffer, int length);
+/* 16 bit scale , but not limited */
+void YM3812UpdateOne32(FM_OPL *OPL, INT32 *buffer, int length);
+/* every channel to its own buffer , 32 bit as above . channels whose */
+/* buffer is NULL are skipped like muted ones                         */
+void YM3812UpdateStems(FM_OPL *OPL, INT32 **buffers, int length);
+
+/* YMF262 local section : 'length' stereo samples, left first */
+void YMF262UpdateOne(FM_OPL *OPL, INT16 *buffer, int length);
+void YMF262UpdateOne32(FM_OPL *OPL, INT32 *buffer, int length);
+/* 18 stereo buffers , the second bank's channels last . a 4op channel */
+/* is output to the buffer of its first channel                       */
+void YMF262UpdateStems(FM_OPL *OPL, INT32 **buffers, int length);
 
 void Y8950UpdateOne(FM_OPL *OPL, INT16 *buffer, int length);
 
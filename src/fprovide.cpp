@@ -19,9 +19,11 @@
  * fprovide.cpp - File provider class framework, by Simon Peter <dn.tlp@gmx.net>
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <binio.h>
 #include <binfile.h>
+#include <binstr.h>
 
 #include "fprovide.h"
 
@@ -50,23 +52,75 @@ unsigned long CFileProvider::filesize(binistream *f)
   return size;
 }
 
+/***** binisstream_buf *****/
+
+// Memory stream that owns its buffer
+class binisstream_buf: public binisstream
+{
+public:
+  binisstream_buf(unsigned char *buf, unsigned long len)
+    : binisstream(buf, len), buf(buf)
+    {
+    }
+
+  ~binisstream_buf()
+    {
+      delete [] buf;
+    }
+
+private:
+  unsigned char	*buf;
+};
+
+static binistream *x86_stream(binistream *f)
+{
+  // Open all files as little endian with IEEE floats by default
+  f->setFlag(binio::BigEndian, false); f->setFlag(binio::FloatIEEE);
+  return f;
+}
+
 /***** CProvider_Filesystem *****/
 
 binistream *CProvider_Filesystem::open(std::string filename) const
 {
+  if(preload) {
+    FILE		*fp = fopen(filename.c_str(), "rb");
+    long		size;
+    unsigned char	*buf;
+
+    if(!fp) return 0;
+    if(fseek(fp, 0, SEEK_END) || (size = ftell(fp)) < 0 ||
+       fseek(fp, 0, SEEK_SET)) {
+      fclose(fp);
+      return 0;
+    }
+
+    buf = new unsigned char [size ? size : 1];
+    if(fread(buf, 1, size, fp) != (size_t)size) {
+      fclose(fp);
+      delete [] buf;
+      return 0;
+    }
+
+    fclose(fp);
+    return x86_stream(new binisstream_buf(buf, size));
+  }
+
   binifstream *f = new binifstream(filename);
 
   if(!f) return 0;
   if(f->error()) { delete f; return 0; }
 
-  // Open all files as little endian with IEEE floats by default
-  f->setFlag(binio::BigEndian, false); f->setFlag(binio::FloatIEEE);
-
-  return f;
+  return x86_stream(f);
 }
 
 void CProvider_Filesystem::close(binistream *f) const
 {
+  if(preload) {
+    delete f;
+    return;
+  }
+
   binifstream *ff = (binifstream *)f;
 
   if(f) {
@@ -74,3 +128,30 @@ void CProvider_Filesystem::close(binistream *f) const
     delete ff;
   }
 }
+
+/***** CProvider_Memory *****/
+
+void CProvider_Memory::add(const std::string &filename, const void *data,
+			   unsigned long size)
+{
+  files[filename].assign((const char *)data, size);
+}
+
+void CProvider_Memory::remove(const std::string &filename)
+{
+  files.erase(filename);
+}
+
+binistream *CProvider_Memory::open(std::string filename) const
+{
+  std::map<std::string, std::string>::const_iterator i = files.find(filename);
+
+  if(i == files.end()) return 0;
+  return x86_stream(new binisstream((void *)i->second.data(),
+				    i->second.size()));
+}
+
+void CProvider_Memory::close(binistream *f) const
+{
+  delete f;
+}
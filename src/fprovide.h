@@ -23,6 +23,7 @@
 #define H_ADPLUG_FILEPROVIDER
 
 #include <string>
+#include <map>
 #include <binio.h>
 
 class CFileProvider
@@ -43,8 +44,34 @@ public:
 class CProvider_Filesystem: public CFileProvider
 {
 public:
+  // With 'preload' set, open() reads the whole file into memory at once
+  // and the player parses it from there.
+  explicit CProvider_Filesystem(bool preload = false)
+    : preload(preload)
+    {
+    }
+
+  virtual binistream *open(std::string filename) const;
+  virtual void close(binistream *f) const;
+
+private:
+  bool	preload;
+};
+
+class CProvider_Memory: public CFileProvider
+{
+public:
+  // Makes a copy of 'size' bytes at 'data' available under 'filename'.
+  // Companion files (instrument banks etc.) must be added under the name
+  // the player derives from the main file's name.
+  void add(const std::string &filename, const void *data, unsigned long size);
+  void remove(const std::string &filename);
+
   virtual binistream *open(std::string filename) const;
   virtual void close(binistream *f) const;
+
+private:
+  std::map<std::string, std::string>	files;
 };
 
 #endif
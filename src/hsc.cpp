@@ -33,6 +33,7 @@ CPlayer *ChscPlayer::factory(Copl *newopl)
 
 bool ChscPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream	*f = fp.open(filename);
   int		i;
 
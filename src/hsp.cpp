@@ -30,6 +30,7 @@ CPlayer *ChspLoader::factory(Copl *newopl)
 
 bool ChspLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream	*f = fp.open(filename); if(!f) return false;
   unsigned long	i, j, orgsize, filesize;
   unsigned char	*cmp, *org;
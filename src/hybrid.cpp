@@ -67,6 +67,11 @@ CPlayer *CxadhybridPlayer::factory(Copl *newopl)
   return new CxadhybridPlayer(newopl);
 }
 
+int CxadhybridPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_fmt(header, size, HYBRID);
+}
+
 bool CxadhybridPlayer::xadplayer_load()
 {
   if(xad.fmt != HYBRID)
@@ -25,6 +25,7 @@ class CxadhybridPlayer: public CxadPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CxadhybridPlayer(Copl *newopl): CxadPlayer(newopl)
     { }
@@ -62,6 +62,11 @@ CPlayer *CxadhypPlayer::factory(Copl *newopl)
   return new CxadhypPlayer(newopl);
 }
 
+int CxadhypPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_fmt(header, size, HYP);
+}
+
 void CxadhypPlayer::xadplayer_rewind(int subsong)
 {
   int i;
@@ -25,6 +25,7 @@ class CxadhypPlayer: public CxadPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CxadhypPlayer(Copl *newopl): CxadPlayer(newopl)
     { }
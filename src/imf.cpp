@@ -55,6 +55,7 @@ CPlayer *CimfPlayer::factory(Copl *newopl)
 
 bool CimfPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   unsigned long fsize, flsize, mfsize = 0;
   unsigned int i;
@@ -48,8 +48,8 @@ static const unsigned short notetable[96] = {
 
 static const unsigned char percmx_tab[4] = { 0x14, 0x12, 0x15, 0x11 };
 static const unsigned char perchn_tab[5] = { 6, 7, 8, 8, 7 };
-static unsigned char percmaskoff[5] = { 0xef, 0xf7, 0xfb, 0xfd, 0xfe };
-static unsigned char percmaskon[5] =  { 0x10, 0x08, 0x04, 0x02, 0x01 };
+static const unsigned char percmaskoff[5] = { 0xef, 0xf7, 0xfb, 0xfd, 0xfe };
+static const unsigned char percmaskon[5] =  { 0x10, 0x08, 0x04, 0x02, 0x01 };
 
 static inline unsigned short GET_WORD(unsigned char *b, int x)
 {
@@ -63,8 +63,15 @@ CPlayer *CjbmPlayer::factory(Copl *newopl)
   return new CjbmPlayer(newopl);
 }
 
+int CjbmPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  // Only the first word is fixed, which is not much to go by
+  return probe_id(header, size, 0, "\x02\0", 2) ? PROBE_MAYBE : PROBE_NO;
+}
+
 bool CjbmPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream	*f = fp.open(filename); if(!f) return false;
   int		filelen = fp.filesize(f);
   int		i;
@@ -28,6 +28,7 @@ class CjbmPlayer: public CPlayer
 {
  public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CjbmPlayer(Copl *newopl) : CPlayer(newopl), m(0)
     { }
@@ -34,28 +34,44 @@ public:
   CKemuopl(int rate, bool bit16, bool usestereo)
     : use16bit(bit16), stereo(usestereo)
     {
-      adlibinit(rate, usestereo ? 2 : 1, bit16 ? 2 : 1);
+      emu = adlibcreate(rate, usestereo ? 2 : 1, bit16 ? 2 : 1);
       currType = TYPE_OPL2;
     };
 
+  virtual ~CKemuopl()
+    {
+      adlibdestroy(emu);
+    }
+
   void update(short *buf, int samples)
     {
       if(use16bit) samples *= 2;
       if(stereo) samples *= 2;
-      adlibgetsample(buf, samples);
+      adlibgetsample(emu, buf, samples);
+    }
+
+  void update32(int32_t *buf, int samples)
+    {
+      adlibgetsample32(emu, buf, samples);
+    }
+
+  void updatefloat(float *buf, int samples)
+    {
+      adlibgetsamplef(emu, buf, samples);
     }
 
   // template methods
   void write(int reg, int val)
     {
       if(currChip == 0)
-	adlib0(reg, val);
+	adlib0(emu, reg, val);
     };
 
   void init() {};
 
 private:
-  bool	use16bit,stereo;
+  bool			use16bit,stereo;
+  adlibemu_context	*emu;		// holds emulator data
 };
 
 #endif
@@ -42,6 +42,7 @@ CPlayer *CksmPlayer::factory(Copl *newopl)
 
 bool CksmPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream	*f;
   int		i;
   char		*fn = new char[filename.length() + 9];
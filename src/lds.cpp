@@ -85,6 +85,7 @@ CldsPlayer::~CldsPlayer()
 
 bool CldsPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream	*f;
   unsigned int	i, j;
   SoundBank	*sb;
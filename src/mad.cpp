@@ -29,8 +29,14 @@ CPlayer *CmadLoader::factory(Copl *newopl)
   return new CmadLoader(newopl);
 }
 
+int CmadLoader::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "MAD+", 4) ? PROBE_YES : PROBE_NO;
+}
+
 bool CmadLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   const unsigned char conv_inst[10] = { 2,1,10,9,4,3,6,5,8,7 };
   unsigned int i, j, k, t = 0;
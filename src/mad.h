@@ -25,6 +25,7 @@ class CmadLoader: public CmodPlayer
 {
 public:
 	static CPlayer *factory(Copl *newopl);
+	static int probe(const unsigned char *header, unsigned long size);
 
 	CmadLoader(Copl *newopl) : CmodPlayer(newopl) { };
 
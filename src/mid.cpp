@@ -283,6 +283,7 @@ void CmidPlayer::sierra_next_section()
 
 bool CmidPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+    clear_caches();
     binistream *f = fp.open(filename); if(!f) return false;
     int good;
     unsigned char s[6];
@@ -30,8 +30,14 @@ CPlayer *CmkjPlayer::factory(Copl *newopl)
   return new CmkjPlayer(newopl);
 }
 
+int CmkjPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "MKJamz", 6) ? PROBE_YES : PROBE_NO;
+}
+
 bool CmkjPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   char	id[6];
   float	ver;
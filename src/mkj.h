@@ -25,6 +25,7 @@ class CmkjPlayer: public CPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
 	CmkjPlayer(Copl *newopl)
 		: CPlayer(newopl), songbuf(0)
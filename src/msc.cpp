@@ -36,6 +36,12 @@ CPlayer *CmscPlayer::factory (Copl * newopl)
   return new CmscPlayer (newopl);
 }
 
+int CmscPlayer::probe (const unsigned char * header, unsigned long size)
+{
+  return probe_id (header, size, 0, (const char *) msc_signature,
+		   MSC_SIGN_LEN) ? PROBE_YES : PROBE_NO;
+}
+
 CmscPlayer::CmscPlayer(Copl * newopl) : CPlayer (newopl)
 {
   desc = NULL;
@@ -65,6 +71,7 @@ CmscPlayer::~CmscPlayer()
 
 bool CmscPlayer::load(const std::string & filename, const CFileProvider & fp)
 {
+  clear_caches();
   binistream * 	bf;
   msc_header	hdr;
 
@@ -28,6 +28,7 @@ class CmscPlayer: public CPlayer
 {
  public:
   static CPlayer * factory(Copl * newopl);
+  static int probe(const unsigned char * header, unsigned long size);
 
   CmscPlayer(Copl * newopl);
   ~CmscPlayer();
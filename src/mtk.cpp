@@ -29,8 +29,15 @@ CPlayer *CmtkLoader::factory(Copl *newopl)
   return new CmtkLoader(newopl);
 }
 
+int CmtkLoader::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "mpu401tr\x92kk\xeer@data", 18) ?
+    PROBE_YES : PROBE_NO;
+}
+
 bool CmtkLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   struct {
     char id[18];
@@ -25,6 +25,7 @@ class CmtkLoader: public ChscPlayer
 {
  public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CmtkLoader(Copl *newopl)
     : ChscPlayer(newopl)
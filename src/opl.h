@@ -22,6 +22,8 @@
 #ifndef H_ADPLUG_OPL
 #define H_ADPLUG_OPL
 
+#include <stdint.h>
+
 class Copl
 {
  public:
@@ -29,6 +31,9 @@ class Copl
     TYPE_OPL2, TYPE_OPL3, TYPE_DUAL_OPL2
   } ChipType;
 
+  // Channels of two OPL2 chips or an OPL3, see setmute() and updatestems()
+  static const int MAX_CHANNELS = 18;
+
   Copl()
     : currChip(0), currType(TYPE_OPL2)
     {
@@ -61,6 +66,33 @@ class Copl
   // Emulation only: fill buffer
   virtual void update(short *buf, int samples) {}
 
+  // Emulation only: fill buffer with 32-bit samples, mono or stereo as
+  // with update(). Integers have the 16-bit scale, floats 1.0 for 32768,
+  // and neither is clipped.
+  virtual void update32(int32_t *buf, int samples) {}
+  virtual void updatefloat(float *buf, int samples) {}
+
+  // Emulation only: channels whose bit is set in 'mask' are left out of
+  // the output and not calculated at all, so their state pauses until they
+  // are unmuted. Bits 0-8 are the channels of the first chip, 9-17 those of
+  // the second chip or OPL3 register bank. In rhythm mode, bits 6-8 stand
+  // for the bass drum, snare drum + hihat and tom-tom + cymbal. Returns
+  // false if this OPL can't mute channels.
+  virtual bool setmute(uint32_t mask) { return false; }
+
+  // Emulation only: fill 'bufs[c]' with the part that channel 'c' adds to
+  // the output of update32(), for all MAX_CHANNELS channels in one pass.
+  // Every buffer has the layout of update32()'s buffer. Channels with a
+  // NULL buffer are skipped like muted ones. The stems add up to the mix
+  // within rounding. Returns false if this OPL can't render stems, which
+  // can be checked with 'samples' = 0.
+  virtual bool updatestems(int32_t **bufs, int samples) { return false; }
+
+  // Timestamped writes: following writes take effect 'offset' sample
+  // frames into the next update(). Returns false if this OPL applies
+  // writes immediately (see CQueueopl).
+  virtual bool settime(unsigned long offset) { return false; }
+
  protected:
   int		currChip;		// currently selected OPL chip number
   ChipType	currType;		// this OPL chip's type
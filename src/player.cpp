@@ -19,10 +19,17 @@
  * player.cpp - Replayer base class, by Simon Peter <dn.tlp@gmx.net>
  */
 
+#include <float.h>
+#include <string.h>
+#include <set>
 #include "player.h"
 #include "adplug.h"
+#include "shadowopl.h"
 #include "silentopl.h"
 
+// Song time between two snapshots, in ms
+#define SNAPSHOT_INTERVAL	10000
+
 /***** CPlayer *****/
 
 const unsigned short CPlayer::note_table[12] =
@@ -32,27 +39,79 @@ const unsigned char CPlayer::op_table[9] =
   {0x00, 0x01, 0x02, 0x08, 0x09, 0x0a, 0x10, 0x11, 0x12};
 
 CPlayer::CPlayer(Copl *newopl)
-  : opl(newopl), db(CAdPlug::database)
+  : opl(newopl), db(CAdPlug::database), timingonly(false), caching(false)
 {
 }
 
 CPlayer::~CPlayer()
 {
+  for(unsigned int i = 0; i < snapshots.size(); i++)
+    delete snapshots[i].state;
+}
+
+bool CPlayer::probe_id(const unsigned char *header, unsigned long size,
+			unsigned long ofs, const char *id, unsigned long len)
+{
+  return ofs + len <= size && !memcmp(header + ofs, id, len);
 }
 
 unsigned long CPlayer::songlength(int subsong)
 {
-  CSilentopl	tempopl;
+  CShadowopl	tempopl(0, opl->gettype());
+  CSilentopl	nullopl(opl->gettype());
   Copl		*saveopl = opl;
-  float		slength = 0.0f;
+  float		slength = 0.0f, last;
+  std::set<unsigned long long>	seen;	// positions at pattern boundaries
+  unsigned int	lastord, lastrow;
+  bool		positions;
 
   // save original OPL from being overwritten
   opl = &tempopl;
-
-  // get song length
   rewind(subsong);
-  while(update() && slength < 600000)	// song length limit: 10 minutes
+
+  // the length of every subsong is only determined once
+  std::map<unsigned int, unsigned long>::const_iterator i =
+    lengths.find(getsubsong());
+  if(caching && i != lengths.end()) {
+    opl = saveopl;
+    return i->second;
+  }
+
+  // Players that take no snapshots and report no position only need to
+  // keep time, as the OPL registers aren't looked at then. Positions of
+  // players with a state are only compared if the state can be hashed,
+  // as pattern loops and jumps return to a position with the same OPL
+  // state without looping the song.
+  CState *state = getstate();
+  unsigned long long h = 0;
+  positions = getorders() != 0 && (!state || state->hash(h));
+  timingonly = !state && !getorders();
+  delete state;
+
+  // get song length, taking snapshots on the way
+  const Snapshot *snap = find_snapshot(getsubsong(), FLT_MAX);
+  last = snap ? snap->pos : 0.0f;
+  if(timingonly) opl = &nullopl;
+  lastord = getorder(); lastrow = getrow();
+  while(update() && slength < 600000) {	// song length limit: 10 minutes
     slength += 1000.0f / getrefresh();
+    if(timingonly) continue;
+    add_snapshot(slength, &tempopl, last);
+
+    // A song that reaches a pattern boundary a second time with the same
+    // speed and OPL state has looped without telling us.
+    if(positions && !getrow() && (lastrow || getorder() != lastord)) {
+      state = getstate();
+      bool looped = !seen.insert(hash_position(&tempopl, state)).second;
+      delete state;
+      if(looped) break;
+    }
+    lastord = getorder(); lastrow = getrow();
+  }
+
+  if(caching) lengths[getsubsong()] = (unsigned long)slength;
+  timingonly = false;
+  opl = &tempopl;
   rewind(subsong);
 
   // restore original OPL and return
@@ -62,9 +121,155 @@ unsigned long CPlayer::songlength(int subsong)
 
 void CPlayer::seek(unsigned long ms)
 {
-  float pos = 0.0f;
+  CShadowopl	shadow(opl, opl->gettype());
+  Copl		*saveopl = opl;
+  float		pos = 0.0f, last;
 
+  // record the registers while seeking, for new snapshots
+  opl = &shadow;
   rewind();
-  while(pos < ms && update())		// seek to new position
+
+  // continue from the nearest snapshot before the new position
+  const Snapshot *snap = find_snapshot(getsubsong(), ms);
+  if(snap) {
+    restore_snapshot(snap);
+    pos = snap->pos;
+  }
+
+  snap = find_snapshot(getsubsong(), FLT_MAX);
+  last = snap ? snap->pos : 0.0f;
+  while(pos < ms && update()) {		// seek to new position
     pos += 1000/getrefresh();
+    add_snapshot(pos, &shadow, last);
+  }
+
+  opl = saveopl;
+}
+
+void CPlayer::clear_caches()
+{
+  for(unsigned int i = 0; i < snapshots.size(); i++)
+    delete snapshots[i].state;
+  snapshots.clear();
+  lengths.clear();
+  caching = true;
+}
+
+/***** CPlayer::CState *****/
+
+void CPlayer::CState::hash_bytes(unsigned long long &h, const void *data,
+				 unsigned long size)
+{
+  for(unsigned long i = 0; i < size; i++) {
+    h ^= ((const unsigned char *)data)[i];
+    h *= 1099511628211ULL;
+  }
+}
+
+/***** Private methods *****/
+
+const CPlayer::Snapshot *CPlayer::find_snapshot(unsigned int subsong, float pos)
+  /*
+   * Returns the last snapshot of 'subsong' not behind 'pos', or NULL.
+   */
+{
+  const Snapshot *snap = 0;
+
+  for(unsigned int i = 0; i < snapshots.size(); i++)
+    if(snapshots[i].subsong == subsong && snapshots[i].pos <= pos &&
+       (!snap || snapshots[i].pos > snap->pos))
+      snap = &snapshots[i];
+
+  return snap;
+}
+
+void CPlayer::add_snapshot(float pos, CShadowopl *shadow, float &last)
+  /*
+   * Takes a snapshot at 'pos', if it is SNAPSHOT_INTERVAL behind 'last', the
+   * position of the last snapshot of this subsong.
+   */
+{
+  Snapshot snap;
+
+  if(!caching || pos < last + SNAPSHOT_INTERVAL)
+    return;
+
+  snap.state = getstate();
+  if(!snap.state) {		// player doesn't support snapshots
+    last = FLT_MAX;
+    return;
+  }
+
+  snap.subsong = getsubsong();
+  snap.pos = pos;
+  snap.chip = shadow->getchip();
+  memcpy(snap.regs[0], shadow->getregs(0), 256);
+  memcpy(snap.regs[1], shadow->getregs(1), 256);
+  snapshots.push_back(snap);
+  last = pos;
+}
+
+unsigned long long CPlayer::hash_position(CShadowopl *shadow,
+					  const CState *state)
+  /*
+   * Returns a 64-bit FNV-1a hash of the song position, speed, OPL state
+   * and replay 'state', if there is one.
+   */
+{
+  unsigned long long	hash = 14695981039346656037ULL;
+  unsigned long		pos[5];
+  int			i, chip;
+
+  pos[0] = getorder(); pos[1] = getpattern(); pos[2] = getrow();
+  pos[3] = getspeed(); pos[4] = (unsigned long)(getrefresh() * 1000);
+  for(i = 0; i < 5; i++) {
+    hash ^= pos[i];
+    hash *= 1099511628211ULL;
+  }
+
+  for(chip = 0; chip < 2; chip++)
+    for(i = 0; i < 256; i++) {
+      hash ^= shadow->getregs(chip)[i];
+      hash *= 1099511628211ULL;
+    }
+
+  if(state) state->hash(hash);
+  return hash;
+}
+
+void CPlayer::restore_snapshot(const Snapshot *snap)
+  /*
+   * Restores the replay state and reprograms the OPL from 'snap'. Notes are
+   * keyed on last, after all other registers are set up.
+   */
+{
+  int	chip, reg, lastchip = 0;
+
+  setstate(snap->state);
+
+  // leave the second chip alone if it was never used
+  for(reg = 0; reg < 256; reg++)
+    if(snap->regs[1][reg]) lastchip = 1;
+
+  if(lastchip) {		// OPL3 mode and 4-op connections first
+    opl->setchip(1);
+    opl->write(5, snap->regs[1][5]);
+    opl->write(4, snap->regs[1][4]);
+  }
+
+  for(chip = lastchip; chip >= 0; chip--) {
+    opl->setchip(chip);
+    for(reg = 1; reg < 256; reg++)
+      if((chip || reg < 2 || reg > 4) &&	// no timers, only on chip 0
+	 (reg < 0xb0 || reg > 0xb8))
+	opl->write(reg, snap->regs[chip][reg]);
+  }
+
+  for(chip = lastchip; chip >= 0; chip--) {
+    opl->setchip(chip);
+    for(reg = 0xb0; reg <= 0xb8; reg++)
+      opl->write(reg, snap->regs[chip][reg]);
+  }
+
+  opl->setchip(snap->chip);
 }
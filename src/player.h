@@ -23,14 +23,42 @@
 #define H_ADPLUG_PLAYER
 
 #include <string>
+#include <vector>
+#include <map>
 
 #include "fprovide.h"
 #include "opl.h"
 #include "database.h"
 
+class CShadowopl;
+
 class CPlayer
 {
 public:
+	// Replay state of a player, as returned by getstate()
+	class CState
+	{
+	public:
+	  virtual ~CState() {}
+
+	  // Adds everything that decides how the replay goes on to 'h' and
+	  // returns true. songlength() then can tell a loop of the song from
+	  // a pattern loop. States that don't support it return false.
+	  virtual bool hash(unsigned long long &h) const
+	    { return false; }
+
+	protected:
+	  // adds 'size' bytes at 'data' to the FNV-1a hash 'h'
+	  static void hash_bytes(unsigned long long &h, const void *data,
+				 unsigned long size);
+	};
+
+	// Results of a player's optional static probe() method. It looks at
+	// the first PROBE_SIZE bytes of a file (less for smaller files) and
+	// tells whether load() has any chance, before the file is loaded.
+	enum { PROBE_NO, PROBE_MAYBE, PROBE_YES };
+	enum { PROBE_SIZE = 128 };
+
         CPlayer(Copl *newopl);
 	virtual ~CPlayer();
 
@@ -42,6 +70,8 @@ public:
 	virtual bool update() = 0;			// executes replay code for 1 tick
 	virtual void rewind(int subsong = -1) = 0;	// rewinds to specified subsong
 	virtual float getrefresh() = 0;			// returns needed timer refresh rate
+	void setdatabase(CAdPlugDatabase *newdb)	// sets database for next load()
+	  { db = newdb; }
 
 /***** Informational methods *****/
 	unsigned long songlength(int subsong = -1);
@@ -74,12 +104,55 @@ public:
 	virtual std::string getinstrument(unsigned int n)	// returns n-th instrument name
 	  { return std::string(); }
 
+/***** Snapshot methods *****/
+	// Players that can save their replay state return a copy of it here,
+	// to be deleted by the caller. seek() then restores the nearest state
+	// recorded by an earlier songlength() or seek() instead of replaying
+	// the song from the beginning. Unsupported players return NULL.
+	virtual CState *getstate()
+	  { return 0; }
+	virtual void setstate(const CState *state)	// restores replay state
+	  { }
+
 protected:
+	// Forgets the snapshots and song lengths of the previous file. Only
+	// players that call it at the start of load() keep them at all, as
+	// they don't fit a file loaded into the same object later.
+	void clear_caches();
+
 	Copl		*opl;	// our OPL chip
 	CAdPlugDatabase	*db;	// AdPlug Database
 
+	// Set by songlength() for players without getorders() and getstate(),
+	// whose OPL output nobody looks at then. They may skip work that only
+	// computes register values, as long as the replay itself takes the
+	// same course. Never set by seek() or for other players.
+	bool		timingonly;
+
 	static const unsigned short	note_table[12];	// standard adlib note table
 	static const unsigned char	op_table[9];	// the 9 operators as expected by the OPL
+
+	// true if 'size' bytes at 'header' hold the 'len' bytes of 'id' at 'ofs'
+	static bool probe_id(const unsigned char *header, unsigned long size,
+			     unsigned long ofs, const char *id, unsigned long len);
+
+private:
+	struct Snapshot {
+	  unsigned int	subsong;
+	  float		pos;		// song position in ms
+	  int		chip;		// selected OPL chip
+	  CState	*state;		// replay state
+	  unsigned char	regs[2][256];	// OPL registers
+	};
+
+	std::vector<Snapshot>			snapshots;
+	std::map<unsigned int, unsigned long>	lengths;	// songlength() per subsong
+	bool					caching;	// clear_caches() called
+
+	const Snapshot *find_snapshot(unsigned int subsong, float pos);
+	void add_snapshot(float pos, CShadowopl *shadow, float &last);
+	void restore_snapshot(const Snapshot *snap);
+	unsigned long long hash_position(CShadowopl *shadow, const CState *state);
 };
 
 #endif
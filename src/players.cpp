@@ -27,12 +27,13 @@
 /***** CPlayerDesc *****/
 
 CPlayerDesc::CPlayerDesc()
-  : factory(0), extensions(0), extlength(0)
+  : factory(0), probe(0), extensions(0), extlength(0)
 {
 }
 
 CPlayerDesc::CPlayerDesc(const CPlayerDesc &pd)
-  : factory(pd.factory), filetype(pd.filetype), extlength(pd.extlength)
+  : factory(pd.factory), probe(pd.probe), filetype(pd.filetype),
+    extlength(pd.extlength)
 {
   if(pd.extensions) {
     extensions = (char *)malloc(extlength);
@@ -41,8 +42,9 @@ CPlayerDesc::CPlayerDesc(const CPlayerDesc &pd)
     extensions = 0;
 }
 
-CPlayerDesc::CPlayerDesc(Factory f, const std::string &type, const char *ext)
-  : factory(f), filetype(type), extensions(0)
+CPlayerDesc::CPlayerDesc(Factory f, const std::string &type, const char *ext,
+			 Probe p)
+  : factory(f), probe(p), filetype(type), extensions(0)
 {
   const char *i = ext;
 
@@ -78,6 +80,15 @@ const char *CPlayerDesc::get_extension(unsigned int n) const
   return (*i != '\0' ? i : 0);
 }
 
+int CPlayerDesc::rank(const unsigned char *header, unsigned long size) const
+  /*
+   * Returns the probe result for a file, CPlayer::PROBE_MAYBE for players
+   * that can't tell without loading it.
+   */
+{
+  return probe ? probe(header, size) : CPlayer::PROBE_MAYBE;
+}
+
 /***** CPlayers *****/
 
 const CPlayerDesc *CPlayers::lookup_filetype(const std::string &ftype) const
@@ -32,18 +32,22 @@ class CPlayerDesc
 {
 public:
   typedef CPlayer *(*Factory)(Copl *);
+  typedef int (*Probe)(const unsigned char *header, unsigned long size);
 
   Factory	factory;
+  Probe		probe;		// optional, may be NULL
   std::string	filetype;
 
   CPlayerDesc();
   CPlayerDesc(const CPlayerDesc &pd);
-  CPlayerDesc(Factory f, const std::string &type, const char *ext);
+  CPlayerDesc(Factory f, const std::string &type, const char *ext,
+	      Probe p = 0);
 
   ~CPlayerDesc();
 
   void add_extension(const char *ext);
   const char *get_extension(unsigned int n) const;
+  int rank(const unsigned char *header, unsigned long size) const;
 
 private:
   char		*extensions;
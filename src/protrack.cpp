@@ -26,6 +26,8 @@
  */
 
 #include <cstring>
+#include <vector>
+#include <algorithm>
 #include "protrack.h"
 #include "debug.h"
 
@@ -528,6 +530,49 @@ float CmodPlayer::getrefresh()
   return (float) (tempo / 2.5);
 }
 
+class CmodPlayer::CmodState: public CPlayer::CState
+{
+public:
+  unsigned char		speed, del, songend, regbd;
+  unsigned short	tempo;
+  unsigned long		rw, ord;
+  int			curchip;
+  std::vector<Channel>	channel;
+
+  bool hash(unsigned long long &h) const
+    {
+      unsigned long v[] = { speed, del, songend, regbd, tempo, rw, ord,
+			    (unsigned long)curchip };
+
+      hash_bytes(h, v, sizeof(v));
+      // Channel is made of chars and shorts only, without any padding
+      if(!channel.empty())
+	hash_bytes(h, &channel[0], channel.size() * sizeof(Channel));
+      return true;
+    }
+};
+
+CPlayer::CState *CmodPlayer::getstate()
+{
+  CmodState *state = new CmodState;
+
+  state->speed = speed; state->del = del; state->songend = songend;
+  state->regbd = regbd; state->tempo = tempo; state->rw = rw;
+  state->ord = ord; state->curchip = curchip;
+  state->channel.assign(channel, channel + nchans);
+  return state;
+}
+
+void CmodPlayer::setstate(const CState *s)
+{
+  const CmodState *state = (const CmodState *)s;
+
+  speed = state->speed; del = state->del; songend = state->songend;
+  regbd = state->regbd; tempo = state->tempo; rw = state->rw;
+  ord = state->ord; curchip = state->curchip;
+  std::copy(state->channel.begin(), state->channel.end(), channel);
+}
+
 void CmodPlayer::init_trackord()
 {
   unsigned long i;
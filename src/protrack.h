@@ -34,6 +34,9 @@ public:
   void rewind(int subsong);
   float getrefresh();
 
+  CState *getstate();
+  void setstate(const CState *state);
+
   unsigned int getpatterns()
     { return nop; }
   unsigned int getpattern()
@@ -90,6 +93,8 @@ public:
   void dealloc();
 
  private:
+  class CmodState;
+
   static const unsigned short sa2_notetable[12];
   static const unsigned char vibratotab[32];
 
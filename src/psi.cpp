@@ -63,6 +63,11 @@ CPlayer *CxadpsiPlayer::factory(Copl *newopl)
   return new CxadpsiPlayer(newopl);
 }
 
+int CxadpsiPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_fmt(header, size, PSI);
+}
+
 void CxadpsiPlayer::xadplayer_rewind(int subsong)
 {
   opl_write(0x01, 0x20);
@@ -25,6 +25,7 @@ class CxadpsiPlayer: public CxadPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CxadpsiPlayer(Copl *newopl): CxadPlayer(newopl)
     { }
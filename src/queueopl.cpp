@@ -0,0 +1,142 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * queueopl.cpp - Queueing OPL, applies timestamped writes to another OPL
+ *                at the right sample frame
+ */
+
+#include "queueopl.h"
+
+CQueueopl::CQueueopl(Copl *newtarget, bool bit16, bool stereo)
+  : target(newtarget), framesize((bit16 ? 2 : 1) * (stereo ? 2 : 1)),
+    channels(stereo ? 2 : 1), time(0)
+{
+  currType = target->gettype();
+}
+
+void CQueueopl::write(int reg, int val)
+{
+  add(reg, val);
+}
+
+void CQueueopl::init()
+  /*
+   * Players reinitialize the chip when they rewind, so this has to happen
+   * in order with the writes around it.
+   */
+{
+  add(-1, 0);
+}
+
+bool CQueueopl::settime(unsigned long offset)
+{
+  if(!queue.empty() && offset < queue.back().offset)
+    offset = queue.back().offset;
+
+  time = offset;
+  return true;
+}
+
+void CQueueopl::update(short *buf, int samples)
+{
+  render(buf, samples, OUT_NATIVE);
+}
+
+void CQueueopl::update32(int32_t *buf, int samples)
+{
+  render(buf, samples, OUT_INT32);
+}
+
+void CQueueopl::updatefloat(float *buf, int samples)
+{
+  render(buf, samples, OUT_FLOAT);
+}
+
+bool CQueueopl::updatestems(int32_t **bufs, int samples)
+{
+  if(!target->updatestems(bufs, 0))
+    return false;
+
+  render(bufs, samples, OUT_STEMS);
+  return true;
+}
+
+void CQueueopl::render(void *buf, int samples, Format format)
+{
+  unsigned long	done = 0, n = samples;
+  unsigned long	i;
+
+  // Render up to every write that is due and apply it
+  for(i = 0; i < queue.size() && queue[i].offset < n; i++) {
+    const Write &w = queue[i];
+
+    if(w.offset > done) {
+      output(buf, done, (int)(w.offset - done), format);
+      done = w.offset;
+    }
+
+    if(w.reg < 0)
+      target->init();
+    else {
+      target->setchip(w.chip);
+      target->write(w.reg, w.val);
+    }
+  }
+
+  if(done < n)
+    output(buf, done, (int)(n - done), format);
+
+  // Keep the rest, relative to the next call
+  queue.erase(queue.begin(), queue.begin() + i);
+  for(i = 0; i < queue.size(); i++)
+    queue[i].offset -= n;
+  time = time > n ? time - n : 0;
+}
+
+void CQueueopl::add(int reg, int val)
+{
+  Write w = { time, currChip, reg, val };
+
+  queue.push_back(w);
+}
+
+void CQueueopl::output(void *buf, unsigned long offset, int samples,
+		       Format format)
+  /*
+   * Renders 'samples' frames to 'buf', starting 'offset' frames into it.
+   */
+{
+  int32_t **bufs = (int32_t **)buf, *stems[MAX_CHANNELS];
+
+  switch(format) {
+  case OUT_NATIVE:
+    target->update((short *)((unsigned char *)buf + offset * framesize), samples);
+    break;
+  case OUT_INT32:
+    target->update32((int32_t *)buf + offset * channels, samples);
+    break;
+  case OUT_FLOAT:
+    target->updatefloat((float *)buf + offset * channels, samples);
+    break;
+  case OUT_STEMS:
+    for(int c = 0; c < MAX_CHANNELS; c++)
+      stems[c] = bufs[c] ? bufs[c] + offset * channels : 0;
+    target->updatestems(stems, samples);
+    break;
+  }
+}
@@ -0,0 +1,75 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * queueopl.h - Queueing OPL, applies timestamped writes to another OPL
+ *              at the right sample frame
+ */
+
+#ifndef H_ADPLUG_QUEUEOPL
+#define H_ADPLUG_QUEUEOPL
+
+#include <vector>
+#include "opl.h"
+
+class CQueueopl: public Copl
+{
+public:
+  // 'bit16' and 'stereo' have to match the settings 'target' was created
+  // with. The target is not owned by the queue.
+  CQueueopl(Copl *newtarget, bool bit16, bool stereo);
+
+  void write(int reg, int val);
+  void init();
+
+  // These render 'samples' frames, applying the queued writes that fall into
+  // them. Later writes are kept and moved to the start of the next call.
+  void update(short *buf, int samples);
+  void update32(int32_t *buf, int samples);
+  void updatefloat(float *buf, int samples);
+  bool updatestems(int32_t **bufs, int samples);
+
+  // Muting is not queued, it applies to the next update() as a whole
+  bool setmute(uint32_t mask) { return target->setmute(mask); }
+
+  // Offsets must not decrease between updates, smaller ones are raised
+  // to the last offset set.
+  bool settime(unsigned long offset);
+
+  // Number of writes not applied yet
+  unsigned long getpending() { return queue.size(); }
+
+private:
+  struct Write {
+    unsigned long	offset;		// frames into the next update()
+    int			chip, reg, val;	// 'reg' < 0 reinitializes the chip
+  };
+
+  // Which update method of the target to use
+  enum Format { OUT_NATIVE, OUT_INT32, OUT_FLOAT, OUT_STEMS };
+
+  Copl			*target;
+  unsigned int		framesize, channels;
+  unsigned long		time;		// offset of the following writes
+  std::vector<Write>	queue;
+
+  void add(int reg, int val);
+  void render(void *buf, int samples, Format format);
+  void output(void *buf, unsigned long offset, int samples, Format format);
+};
+
+#endif
@@ -30,8 +30,14 @@ CPlayer *CradLoader::factory(Copl *newopl)
   return new CradLoader(newopl);
 }
 
+int CradLoader::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "RAD by REALiTY!!", 16) ? PROBE_YES : PROBE_NO;
+}
+
 bool CradLoader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   char id[16];
   unsigned char buf,ch,c,b,inp;
@@ -25,6 +25,7 @@ class CradLoader: public CmodPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
 	CradLoader(Copl *newopl)
 		: CmodPlayer(newopl)
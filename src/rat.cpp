@@ -50,6 +50,11 @@ CPlayer *CxadratPlayer::factory(Copl *newopl)
   return new CxadratPlayer(newopl);
 }
 
+int CxadratPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_fmt(header, size, RAT);
+}
+
 bool CxadratPlayer::xadplayer_load()
 {
   if(xad.fmt != RAT)
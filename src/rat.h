@@ -25,6 +25,7 @@ class CxadratPlayer: public CxadPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   CxadratPlayer(Copl *newopl): CxadPlayer(newopl)
     { }
@@ -29,8 +29,14 @@ CPlayer *CrawPlayer::factory(Copl *newopl)
   return new CrawPlayer(newopl);
 }
 
+int CrawPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "RAWADATA", 8) ? PROBE_YES : PROBE_NO;
+}
+
 bool CrawPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   char id[8];
   unsigned long i;
@@ -25,6 +25,7 @@ class CrawPlayer: public CPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
 	CrawPlayer(Copl *newopl)
 		: CPlayer(newopl), data(0)
@@ -0,0 +1,132 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * renderer.cpp - Offline renderer, drives a player and an OPL emulator
+ */
+
+#include "renderer.h"
+
+// Largest block handed to Copl::update() at once
+#define MAXCHUNK	0x10000
+
+CRenderer::CRenderer(CPlayer *newplayer, Copl *newopl, int rate, bool bit16,
+		     bool stereo)
+  : player(newplayer), opl(newopl), rate(rate),
+    framesize((bit16 ? 2 : 1) * (stereo ? 2 : 1)), channels(stereo ? 2 : 1),
+    looping(false), ended(false), queued(newopl->settime(0)), ticksamples(0),
+    fraction(0.0), rendered(0)
+{
+}
+
+unsigned long CRenderer::render(void *buf, unsigned long samples)
+{
+  return render(buf, samples, false);
+}
+
+unsigned long CRenderer::renderstems(int32_t **bufs, unsigned long samples)
+{
+  return render(bufs, samples, true);
+}
+
+unsigned long CRenderer::render(void *buf, unsigned long samples, bool stems)
+{
+  unsigned long	done = 0, n;
+
+  while(done < samples) {
+    if(!ticksamples) {
+      // Writes of the next tick are due at the frame it starts at
+      if(queued) opl->settime(done);
+      if(!nexttick()) break;
+    }
+
+    // Render as much of the current tick as fits, so the emulator gets
+    // whole ticks instead of small fixed-size pieces.
+    n = samples - done;
+    if(n > ticksamples) n = ticksamples;
+    if(!queued) {
+      if(n > MAXCHUNK) n = MAXCHUNK;
+      output(buf, done, n, stems);
+    }
+    done += n;
+    ticksamples -= n;
+  }
+
+  // With a queue, the ticks only collected their writes so far
+  if(queued)
+    for(unsigned long i = 0; i < done; i += n) {
+      n = done - i;
+      if(n > MAXCHUNK) n = MAXCHUNK;
+      output(buf, i, n, stems);
+    }
+
+  rendered += done;
+  return done;
+}
+
+void CRenderer::output(void *buf, unsigned long offset, unsigned long n,
+		       bool stems)
+  /*
+   * Lets the emulator fill 'n' frames, 'offset' frames into 'buf'.
+   */
+{
+  int32_t *stembufs[Copl::MAX_CHANNELS], **bufs = (int32_t **)buf;
+
+  if(!stems) {
+    opl->update((short *)((unsigned char *)buf + offset * framesize), (int)n);
+    return;
+  }
+
+  for(int c = 0; c < Copl::MAX_CHANNELS; c++)
+    stembufs[c] = bufs[c] ? bufs[c] + offset * channels : 0;
+  opl->updatestems(stembufs, (int)n);
+}
+
+void CRenderer::rewind(int subsong)
+{
+  player->rewind(subsong);
+  ended = false;
+  ticksamples = 0;
+  fraction = 0.0;
+  rendered = 0;
+}
+
+bool CRenderer::nexttick()
+  /*
+   * Advances the player until a tick yields at least one frame. The part of
+   * a frame that doesn't fit into a tick is carried over to the next one, so
+   * the output does not drift against the player's timing. The tick that
+   * ends the song is still rendered, like frontends do; only the next call
+   * returns false.
+   */
+{
+  double	s;
+
+  do {
+    if(ended && !looping)
+      return false;
+
+    if(!player->update())
+      ended = true;
+
+    s = rate / player->getrefresh() + fraction;
+    ticksamples = (unsigned long)s;
+    fraction = s - ticksamples;
+  } while(!ticksamples);
+
+  return true;
+}
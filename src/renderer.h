@@ -0,0 +1,72 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * renderer.h - Offline renderer, drives a player and an OPL emulator
+ */
+
+#ifndef H_ADPLUG_RENDERER
+#define H_ADPLUG_RENDERER
+
+#include "player.h"
+#include "opl.h"
+
+class CRenderer
+{
+public:
+  // 'rate', 'bit16' and 'stereo' have to match the settings 'opl' was
+  // created with. Neither object is owned by the renderer. If 'opl'
+  // supports timestamped writes (see CQueueopl), the player is run ahead
+  // and every render() call is one large update() of the emulator.
+  CRenderer(CPlayer *newplayer, Copl *newopl, int rate, bool bit16,
+	    bool stereo);
+
+  // Fills 'buf' with up to 'samples' sample frames and returns the number
+  // of frames written. Less than 'samples' are only returned at the end
+  // of the song, unless looping is enabled.
+  unsigned long render(void *buf, unsigned long samples);
+
+  // The same, with every channel rendered to its own buffer of 32-bit
+  // samples (see Copl::updatestems(), which 'opl' has to support).
+  unsigned long renderstems(int32_t **bufs, unsigned long samples);
+
+  // Rewinds the player to 'subsong' and restarts sample counting.
+  void rewind(int subsong = -1);
+
+  // Keep rendering when the song ends (it is rewound by the player).
+  void setloop(bool loop) { looping = loop; }
+
+  bool songend() { return ended; }			// song has ended
+  unsigned long getsamples() { return rendered; }	// frames since rewind
+  unsigned int getframesize() { return framesize; }	// bytes per frame
+
+private:
+  CPlayer	*player;
+  Copl		*opl;
+  int		rate;
+  unsigned int	framesize, channels;
+  bool		looping, ended, queued;
+  unsigned long	ticksamples;	// frames left to render of the current tick
+  double	fraction;	// fractional frame carried over to the next tick
+  unsigned long	rendered;
+
+  unsigned long render(void *buf, unsigned long samples, bool stems);
+  void output(void *buf, unsigned long offset, unsigned long n, bool stems);
+  bool nexttick();
+};
+
+#endif
@@ -0,0 +1,264 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * resampleopl.cpp - Resampling OPL, converts the output of an emulator
+ *                   running at the chip's native rate
+ */
+
+#include <math.h>
+#include <string.h>
+#include "resampleopl.h"
+#include "sampconv.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RESAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+// Input samples dropped from the history at once
+#define DROP_SIZE	4096
+
+#define PI	3.14159265358979323846
+
+const int CResampleopl::NATIVE_RATE;
+
+/*
+ * Kaiser windowed sinc filters. 'cutoff' is relative to the lower of both
+ * Nyquist frequencies, 'beta' trades the width of the transition band
+ * against the attenuation of the stop band.
+ */
+static const struct {
+  unsigned int	taps, phases;
+  bool		interpolate;
+  double	cutoff, beta;
+} presets[] = {
+  { 8, 64, false, 0.80, 4.0 },		// QUALITY_FAST
+  { 16, 128, false, 0.88, 6.0 },	// QUALITY_MEDIUM
+  { 32, 256, true, 0.92, 8.0 },		// QUALITY_HIGH
+  { 64, 512, true, 0.95, 10.0 }		// QUALITY_BEST
+};
+
+static double bessel_i0(double x)
+/* Modified Bessel function of the first kind, order 0 */
+{
+  double sum = 1.0, term = 1.0;
+
+  for(int k = 1; k < 50 && term > sum * 1e-12; k++) {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+
+  return sum;
+}
+
+static float dot(const float *x, const float *h, unsigned int n)
+/* Dot product of 'n' samples, a multiple of 4, and coefficients */
+{
+#ifdef RESAMPLE_SSE2
+  __m128	sum = _mm_setzero_ps();
+
+  for(unsigned int i = 0; i < n; i += 4)
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(h + i)));
+
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+  return _mm_cvtss_f32(sum);
+#else
+  float	sum[4] = { 0, 0, 0, 0 };
+
+  for(unsigned int i = 0; i < n; i += 4) {
+    sum[0] += x[i] * h[i]; sum[1] += x[i + 1] * h[i + 1];
+    sum[2] += x[i + 2] * h[i + 2]; sum[3] += x[i + 3] * h[i + 3];
+  }
+
+  return (sum[0] + sum[2]) + (sum[1] + sum[3]);
+#endif
+}
+
+CResampleopl::CResampleopl(Copl *newtarget, int rate, bool bit16, bool stereo,
+			   Quality quality)
+  : target(newtarget), rate(rate), use16bit(bit16), stereo(stereo),
+    taps(presets[quality].taps), phases(presets[quality].phases),
+    interpolate(presets[quality].interpolate)
+{
+  unsigned int	rows = phases + 1, half = taps / 2, p, k;
+  double	fc = presets[quality].cutoff, beta = presets[quality].beta;
+  double	i0beta = bessel_i0(beta);
+
+  currType = target->gettype();
+
+  // Downsampling has to remove everything above the output's Nyquist
+  if(rate < NATIVE_RATE) fc *= (double)rate / NATIVE_RATE;
+
+  coefs = new float[rows * taps * (interpolate ? 2 : 1)];
+  for(p = 0; p < rows; p++) {
+    double	*row = new double[taps], sum = 0.0;
+
+    // Tap k weighs input sample wpos + k, the output lies 'p / phases'
+    // after sample wpos + half - 1
+    for(k = 0; k < taps; k++) {
+      double d = (double)k - (half - 1) - (double)p / phases;
+      double x = d / half, s = fc * d * PI;
+
+      row[k] = (s != 0.0 ? fc * sin(s) / s : fc) *
+	(fabs(x) < 1.0 ? bessel_i0(beta * sqrt(1.0 - x * x)) / i0beta : 0.0);
+      sum += row[k];
+    }
+
+    // Unity gain at every phase
+    for(k = 0; k < taps; k++)
+      coefs[p * taps + k] = (float)(row[k] / sum);
+    delete [] row;
+  }
+
+  if(interpolate)
+    for(p = 0; p < phases; p++)
+      for(k = 0; k < taps; k++)
+	coefs[(rows + p) * taps + k] =
+	  coefs[(p + 1) * taps + k] - coefs[p * taps + k];
+
+  reset();
+}
+
+CResampleopl::~CResampleopl()
+{
+  delete [] coefs;
+}
+
+void CResampleopl::init()
+{
+  // The previous song's filter tail and phase must not leak into this one
+  target->init();
+  reset();
+}
+
+void CResampleopl::setchip(int n)
+{
+  Copl::setchip(n);
+  target->setchip(n);
+}
+
+void CResampleopl::update(short *buf, int samples)
+{
+  unsigned long n = stereo ? samples * 2 : samples;
+
+  if(outbuf.size() < n) outbuf.resize(n);
+  resample(&outbuf[0], samples);
+
+  // 32-bit samples take as much room as floats
+  sampconv_int32(&outbuf[0], (int32_t *)&outbuf[0], n);
+  sampconv_s16((int32_t *)&outbuf[0], use16bit ? buf : (short *)&outbuf[0], n);
+  if(!use16bit)
+    sampconv_u8((short *)&outbuf[0], (unsigned char *)buf, n);
+}
+
+void CResampleopl::update32(int32_t *buf, int samples)
+{
+  resample((float *)buf, samples);
+  sampconv_int32((float *)buf, buf, stereo ? samples * 2 : samples);
+}
+
+void CResampleopl::updatefloat(float *buf, int samples)
+{
+  resample(buf, samples);
+}
+
+void CResampleopl::reset()
+/* Empties the history, so the first output sample lies on the first input */
+{
+  for(int k = 0; k < 2; k++)
+    hist[k].assign(taps / 2 - 1, 0.0f);
+  wpos = 0; frac = 0;
+}
+
+void CResampleopl::resample(float *out, int samples)
+  /*
+   * Renders 'samples' frames of floats. The input position advances by
+   * NATIVE_RATE / rate per frame, counted exactly in 'frac', so there is
+   * no drift.
+   */
+{
+  unsigned int	channels = stereo ? 2 : 1, c;
+  unsigned long	pos = wpos, f = frac, need;
+  const float	*h, *d;
+
+  if(samples <= 0) return;
+
+  // Nothing to convert
+  if(rate == NATIVE_RATE) {
+    target->updatefloat(out, samples);
+    return;
+  }
+
+  // Render the input up to the end of the last filter window
+  need = wpos + (unsigned long)((frac + (uint64_t)(samples - 1) * NATIVE_RATE) / rate) + taps;
+  if(need > hist[0].size())
+    fill(need - hist[0].size());
+
+  for(int i = 0; i < samples; i++) {
+    uint64_t	fp = (uint64_t)f * phases;
+    unsigned int p = (unsigned int)(fp / rate);
+
+    h = coefs + p * taps;
+    if(interpolate) {
+      float mu = (float)(fp % rate) / rate;
+
+      d = coefs + (phases + 1 + p) * taps;
+      for(c = 0; c < channels; c++) {
+	const float *x = &hist[c][pos];
+	*out++ = dot(x, h, taps) + mu * dot(x, d, taps);
+      }
+    } else
+      for(c = 0; c < channels; c++)
+	*out++ = dot(&hist[c][pos], h, taps);
+
+    f += NATIVE_RATE;
+    pos += f / rate;
+    f %= rate;
+  }
+
+  wpos = pos; frac = f;
+
+  // Forget the input that no filter window reaches anymore
+  if(wpos >= DROP_SIZE) {
+    for(c = 0; c < channels; c++)
+      hist[c].erase(hist[c].begin(), hist[c].begin() + wpos);
+    wpos = 0;
+  }
+}
+
+void CResampleopl::fill(unsigned long frames)
+  /*
+   * Appends 'frames' input frames from the emulator to the history.
+   */
+{
+  unsigned long	size = hist[0].size(), i;
+
+  inbuf.resize(stereo ? frames * 2 : frames);
+  target->updatefloat(&inbuf[0], (int)frames);
+
+  if(stereo) {
+    hist[0].resize(size + frames);
+    hist[1].resize(size + frames);
+    for(i = 0; i < frames; i++) {
+      hist[0][size + i] = inbuf[i * 2];
+      hist[1][size + i] = inbuf[i * 2 + 1];
+    }
+  } else
+    hist[0].insert(hist[0].end(), inbuf.begin(), inbuf.end());
+}
@@ -0,0 +1,80 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * resampleopl.h - Resampling OPL, converts the output of an emulator
+ *                 running at the chip's native rate
+ */
+
+#ifndef H_ADPLUG_RESAMPLEOPL
+#define H_ADPLUG_RESAMPLEOPL
+
+#include <vector>
+#include "opl.h"
+
+class CResampleopl: public Copl
+{
+public:
+  // Sample rate of the chip, at which the emulators need no rate
+  // conversion of their own
+  static const int NATIVE_RATE = 49716;
+
+  // Filter presets, from a short filter for previews to a long one for
+  // archival renders
+  typedef enum {
+    QUALITY_FAST, QUALITY_MEDIUM, QUALITY_HIGH, QUALITY_BEST
+  } Quality;
+
+  // 'target' has to be an emulator created with NATIVE_RATE and the same
+  // 'stereo' setting. It is not owned by the resampler. 'rate', 'bit16'
+  // and 'stereo' are the output settings.
+  CResampleopl(Copl *newtarget, int rate, bool bit16, bool stereo,
+	       Quality quality = QUALITY_HIGH);
+  ~CResampleopl();
+
+  void write(int reg, int val) { target->write(reg, val); }
+  void setchip(int n);
+  void init();
+  bool setmute(uint32_t mask) { return target->setmute(mask); }
+
+  void update(short *buf, int samples);
+  void update32(int32_t *buf, int samples);
+  void updatefloat(float *buf, int samples);
+
+private:
+  Copl			*target;
+  int			rate;
+  bool			use16bit, stereo;
+
+  // Polyphase filter: 'phases' + 1 rows of 'taps' coefficients for the
+  // fractional positions between two input samples. With 'interpolate',
+  // the differences to the next row follow, to interpolate between rows.
+  unsigned int		taps, phases;
+  bool			interpolate;
+  float			*coefs;
+
+  std::vector<float>	hist[2];	// input samples of both channels
+  unsigned long		wpos;		// first input sample of the next filter window
+  unsigned long		frac;		// position between input samples, in 1/rate
+  std::vector<float>	inbuf, outbuf;	// scratch buffers
+
+  void reset();
+  void resample(float *out, int samples);
+  void fill(unsigned long frames);
+};
+
+#endif
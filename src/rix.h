@@ -56,6 +56,7 @@ class CrixPlayer: public CPlayer
   uint16_t insbuf[28];
   uint16_t displace[11];
   ADDT reg_bufs[18];
+  uint8_t for40reg[18];
   uint32_t pos,length;
   uint8_t index;
 
@@ -64,7 +65,6 @@ class CrixPlayer: public CPlayer
   static const uint8_t ad_C0_offs[18];
   static const uint8_t modify[28];
   static const uint8_t bd_reg_data[124];
-  static uint8_t for40reg[18];
   static const uint16_t mus_time;
   uint32_t I,T;
   uint16_t mus_block;
@@ -184,6 +184,7 @@ CrolPlayer::~CrolPlayer()
 //---------------------------------------------------------
 bool CrolPlayer::load(const std::string & filename, const CFileProvider & fp)
 {
+    clear_caches();
     binistream *f = fp.open(filename);
 
     if (!f)
@@ -41,6 +41,13 @@ CPlayer *Cs3mPlayer::factory(Copl *newopl)
   return new Cs3mPlayer(newopl);
 }
 
+int Cs3mPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  // EOF marker and module type after the song name, then "SCRM"
+  return probe_id(header, size, 28, "\x1a\x10", 2) &&
+    probe_id(header, size, 44, "SCRM", 4) ? PROBE_YES : PROBE_NO;
+}
+
 Cs3mPlayer::Cs3mPlayer(Copl *newopl): CPlayer(newopl)
 {
   int i,j,k;
@@ -58,6 +65,7 @@ Cs3mPlayer::Cs3mPlayer(Copl *newopl): CPlayer(newopl)
 
 bool Cs3mPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream		*f = fp.open(filename); if(!f) return false;
   unsigned short	insptr[99],pattptr[99];
   int			i,row;
@@ -404,6 +412,45 @@ void Cs3mPlayer::rewind(int subsong)
   opl->write(1,32);			// Go to ym3812 mode
 }
 
+class Cs3mPlayer::Cs3mState: public CPlayer::CState
+{
+public:
+  s3mchan	channel[9];
+  unsigned char	crow, ord, speed, tempo, del, songend, loopstart, loopcnt;
+
+  bool hash(unsigned long long &h) const
+    {
+      // s3mchan is made of chars and shorts only, without any padding
+      hash_bytes(h, channel, sizeof(channel));
+      hash_bytes(h, &crow, 1); hash_bytes(h, &ord, 1);
+      hash_bytes(h, &speed, 1); hash_bytes(h, &tempo, 1);
+      hash_bytes(h, &del, 1); hash_bytes(h, &songend, 1);
+      hash_bytes(h, &loopstart, 1); hash_bytes(h, &loopcnt, 1);
+      return true;
+    }
+};
+
+CPlayer::CState *Cs3mPlayer::getstate()
+{
+  Cs3mState *state = new Cs3mState;
+
+  memcpy(state->channel, channel, sizeof(channel));
+  state->crow = crow; state->ord = ord; state->speed = speed;
+  state->tempo = tempo; state->del = del; state->songend = songend;
+  state->loopstart = loopstart; state->loopcnt = loopcnt;
+  return state;
+}
+
+void Cs3mPlayer::setstate(const CState *s)
+{
+  const Cs3mState *state = (const Cs3mState *)s;
+
+  memcpy(channel, state->channel, sizeof(channel));
+  crow = state->crow; ord = state->ord; speed = state->speed;
+  tempo = state->tempo; del = state->del; songend = state->songend;
+  loopstart = state->loopstart; loopcnt = state->loopcnt;
+}
+
 std::string Cs3mPlayer::gettype()
 {
   char filever[5];
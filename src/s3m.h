@@ -28,6 +28,7 @@ class Cs3mPlayer: public CPlayer
 {
  public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
   Cs3mPlayer(Copl *newopl);
 
@@ -36,6 +37,9 @@ class Cs3mPlayer: public CPlayer
   void rewind(int subsong);
   float getrefresh();
 
+  CState *getstate();
+  void setstate(const CState *state);
+
   std::string gettype();
   std::string gettitle()
     { return std::string(header.name); };
@@ -80,7 +84,7 @@ class Cs3mPlayer: public CPlayer
     unsigned char note,oct,instrument,volume,command,info;
   } pattern[99][64][32];
 
-  struct {
+  struct s3mchan {
     unsigned short freq,nextfreq;
     unsigned char oct,vol,inst,fx,info,dualinfo,key,nextoct,trigger,note;
   } channel[9];
@@ -90,6 +94,8 @@ class Cs3mPlayer: public CPlayer
   unsigned char crow,ord,speed,tempo,del,songend,loopstart,loopcnt;
 
  private:
+  class Cs3mState;
+
   static const signed char chnresolv[];
   static const unsigned short notetable[12];
   static const unsigned char vibratotab[32];
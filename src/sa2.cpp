@@ -32,8 +32,14 @@ CPlayer *Csa2Loader::factory(Copl *newopl)
   return new Csa2Loader(newopl);
 }
 
+int Csa2Loader::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "SAdT", 4) ? PROBE_YES : PROBE_NO;
+}
+
 bool Csa2Loader::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   struct {
     unsigned char data[11],arpstart,arpspeed,arppos,arpspdcnt;
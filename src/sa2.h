@@ -26,6 +26,7 @@ class Csa2Loader: public CmodPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
 	Csa2Loader(Copl *newopl)
 		: CmodPlayer(newopl)
@@ -0,0 +1,101 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * sampconv.cpp - Sample format conversion for the emulators' output
+ */
+
+#include <math.h>
+#include "sampconv.h"
+
+// SSE2 is part of every x86-64 processor, so no run-time check is needed.
+// The vector code gives exactly the same results as the plain loops.
+#if defined(__SSE2__) || defined(_M_X64)
+#define SAMPCONV_SSE2
+#include <emmintrin.h>
+#endif
+
+void sampconv_float(const int32_t *in, float *out, unsigned long n)
+{
+  const float	scale = 1.0f / 32768.0f;
+  unsigned long	i = 0;
+
+#ifdef SAMPCONV_SSE2
+  const __m128	vscale = _mm_set1_ps(scale);
+
+  for(; i + 4 <= n; i += 4) {
+    __m128i s = _mm_loadu_si128((const __m128i *)(in + i));
+    _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(s), vscale));
+  }
+#endif
+
+  for(; i < n; i++)
+    out[i] = (float)in[i] * scale;
+}
+
+void sampconv_int32(const float *in, int32_t *out, unsigned long n)
+{
+  unsigned long	i = 0;
+
+#ifdef SAMPCONV_SSE2
+  const __m128	vscale = _mm_set1_ps(32768.0f);
+
+  for(; i + 4 <= n; i += 4) {
+    __m128 f = _mm_loadu_ps(in + i);
+    _mm_storeu_si128((__m128i *)(out + i), _mm_cvtps_epi32(_mm_mul_ps(f, vscale)));
+  }
+#endif
+
+  for(; i < n; i++)
+    out[i] = (int32_t)lrintf(in[i] * 32768.0f);
+}
+
+void sampconv_s16(const int32_t *in, short *out, unsigned long n)
+{
+  unsigned long	i = 0;
+
+#ifdef SAMPCONV_SSE2
+  // Both halves are loaded before anything is stored, for in place use
+  for(; i + 8 <= n; i += 8) {
+    __m128i lo = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i hi = _mm_loadu_si128((const __m128i *)(in + i + 4));
+    _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(lo, hi));
+  }
+#endif
+
+  for(; i < n; i++)
+    out[i] = in[i] > 32767 ? 32767 : (in[i] < -32768 ? -32768 : in[i]);
+}
+
+void sampconv_u8(const short *in, unsigned char *out, unsigned long n)
+{
+  unsigned long	i = 0;
+
+#ifdef SAMPCONV_SSE2
+  const __m128i	sign = _mm_set1_epi8((char)0x80);
+
+  for(; i + 16 <= n; i += 16) {
+    __m128i lo = _mm_srai_epi16(_mm_loadu_si128((const __m128i *)(in + i)), 8);
+    __m128i hi = _mm_srai_epi16(_mm_loadu_si128((const __m128i *)(in + i + 8)), 8);
+    _mm_storeu_si128((__m128i *)(out + i),
+		     _mm_xor_si128(_mm_packs_epi16(lo, hi), sign));
+  }
+#endif
+
+  for(; i < n; i++)
+    out[i] = (in[i] >> 8) ^ 0x80;
+}
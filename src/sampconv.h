@@ -0,0 +1,45 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * sampconv.h - Sample format conversion for the emulators' output
+ */
+
+#ifndef H_ADPLUG_SAMPCONV
+#define H_ADPLUG_SAMPCONV
+
+#include <stdint.h>
+
+/*
+ * 32-bit samples keep the scale of the 16-bit ones, but are not clipped.
+ * All functions convert 'n' samples and work in place, i.e. 'in' and 'out'
+ * may point to the same buffer. They use SSE2 where available.
+ */
+
+// To floats, 32768 becomes 1.0
+void sampconv_float(const int32_t *in, float *out, unsigned long n);
+
+// From floats, rounding to the nearest integer
+void sampconv_int32(const float *in, int32_t *out, unsigned long n);
+
+// To 16 bits, clipping
+void sampconv_s16(const int32_t *in, short *out, unsigned long n);
+
+// From 16 bits to unsigned 8 bits
+void sampconv_u8(const short *in, unsigned char *out, unsigned long n);
+
+#endif
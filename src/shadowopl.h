@@ -0,0 +1,95 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * shadowopl.h - Shadow OPL, keeps a copy of all registers written to
+ *               another OPL
+ */
+
+#ifndef H_ADPLUG_SHADOWOPL
+#define H_ADPLUG_SHADOWOPL
+
+#include <string.h>
+#include "opl.h"
+
+class CShadowopl: public Copl
+{
+public:
+  // Forwards everything to 'target', if given. The chip type is reported
+  // as 'type', so players behave as they would with the target.
+  CShadowopl(Copl *newtarget = 0, ChipType type = TYPE_OPL2)
+    : target(newtarget)
+    {
+      currType = type;
+      memset(regs, 0, sizeof(regs));
+    }
+
+  void write(int reg, int val)
+    {
+      regs[currChip][reg & 0xff] = val;
+      if(target) target->write(reg, val);
+    }
+
+  void setchip(int n)
+    {
+      Copl::setchip(n);
+      if(target) target->setchip(n);
+    }
+
+  void init()
+    {
+      memset(regs, 0, sizeof(regs));
+      if(target) target->init();
+    }
+
+  void update(short *buf, int samples)
+    {
+      if(target) target->update(buf, samples);
+    }
+
+  void update32(int32_t *buf, int samples)
+    {
+      if(target) target->update32(buf, samples);
+    }
+
+  void updatefloat(float *buf, int samples)
+    {
+      if(target) target->updatefloat(buf, samples);
+    }
+
+  bool updatestems(int32_t **bufs, int samples)
+    {
+      return target && target->updatestems(bufs, samples);
+    }
+
+  bool setmute(uint32_t mask)
+    {
+      return target && target->setmute(mask);
+    }
+
+  // Register file of chip 'n', i.e. the last value written to every register
+  const unsigned char *getregs(int n)
+    {
+      return regs[n];
+    }
+
+private:
+  Copl		*target;
+  unsigned char	regs[2][256];
+};
+
+#endif
@@ -24,6 +24,9 @@
 class CSilentopl: public Copl
 {
 public:
+	CSilentopl(ChipType type = TYPE_OPL2)
+	  { currType = type; }
+
 	void write(int reg, int val) {}
 	void init() {}
 };
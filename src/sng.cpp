@@ -27,8 +27,14 @@ CPlayer *CsngPlayer::factory(Copl *newopl)
   return new CsngPlayer(newopl);
 }
 
+int CsngPlayer::probe(const unsigned char *header, unsigned long size)
+{
+  return probe_id(header, size, 0, "ObsM", 4) ? PROBE_YES : PROBE_NO;
+}
+
 bool CsngPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   int i;
 
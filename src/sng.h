@@ -28,6 +28,7 @@ class CsngPlayer: public CPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl);
+  static int probe(const unsigned char *header, unsigned long size);
 
 	CsngPlayer(Copl *newopl)
 		: CPlayer(newopl), data(0)
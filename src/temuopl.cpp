@@ -19,7 +19,9 @@
  * temuopl.cpp - Tatsuyuki Satoh's OPL2 emulator, by Simon Peter <dn.tlp@gmx.net>
  */
 
+#include <string.h>
 #include "temuopl.h"
+#include "sampconv.h"
 
 CTemuopl::CTemuopl(int rate, bool bit16, bool usestereo)
   : use16bit(bit16), stereo(usestereo)
@@ -56,13 +58,60 @@ void CTemuopl::update(short *buf, int samples)
 	tempbuf[i*2+1] = tempbuf[i];
       }
 
-    for(i=0;i<(stereo ? samples*2 : samples);i++)
-      ((char *)buf)[i] = (tempbuf[i] >> 8) ^ 0x80;
+    sampconv_u8(tempbuf, (unsigned char *)buf, stereo ? samples*2 : samples);
 
     delete [] tempbuf;
   }
 }
 
+void CTemuopl::update32(int32_t *buf, int samples)
+{
+  int i;
+
+  YM3812UpdateOne32(opl,buf,samples);
+
+  if(stereo)
+    for(i=samples-1;i>=0;i--) {
+      buf[i*2] = buf[i];
+      buf[i*2+1] = buf[i];
+    }
+}
+
+void CTemuopl::updatefloat(float *buf, int samples)
+{
+  // floats are as large as 32-bit samples, so they are converted in place
+  update32((int32_t *)buf, samples);
+  sampconv_float((int32_t *)buf, buf, stereo ? samples*2 : samples);
+}
+
+bool CTemuopl::updatestems(int32_t **bufs, int samples)
+{
+  int i, c;
+
+  YM3812UpdateStems(opl,bufs,samples);
+
+  // there is only one chip, the upper channels stay silent
+  for(c=0;c<MAX_CHANNELS;c++) {
+    if(!bufs[c]) continue;
+
+    if(c >= 9)
+      memset(bufs[c],0,(stereo ? samples*2 : samples)*sizeof(int32_t));
+    else if(stereo)
+      for(i=samples-1;i>=0;i--) {
+	bufs[c][i*2] = bufs[c][i];
+	bufs[c][i*2+1] = bufs[c][i];
+      }
+  }
+
+  return true;
+}
+
+bool CTemuopl::setmute(uint32_t mask)
+{
+  OPLSetMute(opl,mask & 0x1ff);
+  return true;
+}
+
 void CTemuopl::write(int reg, int val)
 {
   OPLWrite(opl,0,reg);
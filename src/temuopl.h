@@ -34,6 +34,10 @@ class CTemuopl: public Copl
   virtual ~CTemuopl();
 
   void update(short *buf, int samples);	// fill buffer
+  void update32(int32_t *buf, int samples);
+  void updatefloat(float *buf, int samples);
+  bool updatestems(int32_t **bufs, int samples);
+  bool setmute(uint32_t mask);
 
   // template methods
   void write(int reg, int val);
@@ -36,6 +36,7 @@ CPlayer *Cu6mPlayer::factory(Copl *newopl)
 
 bool Cu6mPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   // file validation section
   // this section only checks a few *necessary* conditions
   unsigned long filesize, decompressed_filesize;
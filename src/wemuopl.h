@@ -23,6 +23,7 @@
 #define H_ADPLUG_WEMUOPL
 
 #include "opl.h"
+#include "sampconv.h"
 extern "C" {
 #include "woodyopl.h"
 }
@@ -31,6 +32,7 @@ class CWemuopl: public Copl
 {
 public:
   CWemuopl(int rate, bool bit16, bool usestereo)
+    : stereo(usestereo)
     {
       opl.adlib_init(rate, usestereo ? 2 : 1, bit16 ? 2 : 1);
       currType = TYPE_OPL2;
@@ -41,6 +43,30 @@ public:
       opl.adlib_getsample(buf, samples);
     }
 
+  void update32(int32_t *buf, int samples)
+    {
+      opl.adlib_getsample32(buf, samples);
+    }
+
+  // floats are as large as 32-bit samples, so they are converted in place
+  void updatefloat(float *buf, int samples)
+    {
+      opl.adlib_getsample32((int32_t *)buf, samples);
+      sampconv_float((int32_t *)buf, buf, stereo ? samples * 2 : samples);
+    }
+
+  bool updatestems(int32_t **bufs, int samples)
+    {
+      opl.adlib_getstems((Bit32s **)bufs, samples);
+      return true;
+    }
+
+  bool setmute(uint32_t mask)
+    {
+      opl.adlib_setmute(mask);
+      return true;
+    }
+
   // template methods
   void write(int reg, int val)
     {
@@ -50,6 +76,7 @@ public:
   void init() {};
 
 private:
+  bool		stereo;
   OPLChipClass	opl;
 };
 
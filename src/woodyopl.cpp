@@ -29,13 +29,29 @@
  */
 
 #include <math.h>
-#include <stdlib.h> // rand()
 #include <string.h> // memset
 #include "woodyopl.h"
 
+// SIMD block kernels, only where the plain C code computes with SSE2 as well,
+// so both give bit-identical results
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define WOODY_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
 
-static fltype recipsamp;	// inverse of sampling rate
-static Bit16s wavtable[WAVEPREC*3];	// wave form table
+
+/*
+	The following tables are shared by all chips. They are filled in once by
+	init_tables() and only read afterwards, everything that is modified while
+	rendering lives in OPLChipClass.
+*/
+static Bit16s wavtable[WAVEPREC*3+1];	// wave form table (+1 for 32-bit gathers of the last entry)
 
 // vibrato/tremolo tables
 static Bit32s vib_table[VIBTAB_SIZE];
@@ -44,16 +60,6 @@ static Bit32s trem_table[TREMTAB_SIZE*2];
 static Bit32s vibval_const[BLOCKBUF_SIZE];
 static Bit32s tremval_const[BLOCKBUF_SIZE];
 
-// vibrato value tables (used per-operator)
-static Bit32s vibval_var1[BLOCKBUF_SIZE];
-static Bit32s vibval_var2[BLOCKBUF_SIZE];
-//static Bit32s vibval_var3[BLOCKBUF_SIZE];
-//static Bit32s vibval_var4[BLOCKBUF_SIZE];
-
-// vibrato/trmolo value table pointers
-static Bit32s *vibval1, *vibval2, *vibval3, *vibval4;
-static Bit32s *tremval1, *tremval2, *tremval3, *tremval4;
-
 
 // key scale level lookup table
 static const fltype kslmul[4] = {
@@ -64,9 +70,6 @@ static const fltype kslmul[4] = {
 static const fltype frqmul_tab[16] = {
 	0.5,1,2,3,4,5,6,7,8,9,10,10,12,12,15,15
 };
-// calculated frequency multiplication values (depend on sampling rate)
-static fltype frqmul[16];
-
 // key scale levels
 static Bit8u kslev[8][16];
 
@@ -98,7 +101,7 @@ static const Bit8u regbase2op[22] = {
 
 
 // start of the waveform
-static Bit32u waveform[8] = {
+static const Bit32u waveform[8] = {
 	WAVEPREC,
 	WAVEPREC>>1,
 	WAVEPREC,
@@ -110,7 +113,7 @@ static Bit32u waveform[8] = {
 };
 
 // length of the waveform as mask
-static Bit32u wavemask[8] = {
+static const Bit32u wavemask[8] = {
 	WAVEPREC-1,
 	WAVEPREC-1,
 	(WAVEPREC>>1)-1,
@@ -122,7 +125,7 @@ static Bit32u wavemask[8] = {
 };
 
 // where the first entry resides
-static Bit32u wavestart[8] = {
+static const Bit32u wavestart[8] = {
 	0,
 	WAVEPREC>>1,
 	0,
@@ -134,13 +137,13 @@ static Bit32u wavestart[8] = {
 };
 
 // envelope generator function constants
-static fltype attackconst[4] = {
+static const fltype attackconst[4] = {
 	(fltype)(1/2.82624),
 	(fltype)(1/2.25280),
 	(fltype)(1/1.88416),
 	(fltype)(1/1.59744)
 };
-static fltype decrelconst[4] = {
+static const fltype decrelconst[4] = {
 	(fltype)(1/39.28064),
 	(fltype)(1/31.41608),
 	(fltype)(1/26.17344),
@@ -148,7 +151,7 @@ static fltype decrelconst[4] = {
 };
 
 
-void operator_advance(op_type* op_pt, Bit32s vib) {
+void OPLChipClass::operator_advance(op_type* op_pt, Bit32s vib) {
 	op_pt->wfpos = op_pt->tcount;						// waveform position
 
 	// advance waveform time
@@ -158,12 +161,14 @@ void operator_advance(op_type* op_pt, Bit32s vib) {
 	op_pt->generator_pos += generator_add;
 }
 
-void operator_advance_drums(op_type* op_pt1, Bit32s vib1, op_type* op_pt2, Bit32s vib2, op_type* op_pt3, Bit32s vib3) {
+void OPLChipClass::operator_advance_drums(op_type* op_pt1, Bit32s vib1, op_type* op_pt2, Bit32s vib2, op_type* op_pt3, Bit32s vib3) {
 	Bit32u c1 = op_pt1->tcount/FIXEDPT;
 	Bit32u c3 = op_pt3->tcount/FIXEDPT;
 	Bit32u phasebit = (((c1 & 0x88) ^ ((c1<<5) & 0x80)) | ((c3 ^ (c3<<2)) & 0x20)) ? 0x02 : 0x00;
 
-	Bit32u noisebit = rand()&1;
+	// per-chip pseudo random generator, so chips don't share any state
+	noise = noise*1103515245+12345;
+	Bit32u noisebit = (noise>>16)&1;
 
 	Bit32u snare_phase_bit = (((Bitu)((op_pt1->tcount/FIXEDPT) / 0x100))&1);
 
@@ -306,7 +311,7 @@ void operator_attack(op_type* op_pt) {
 
 typedef void (*optype_fptr)(op_type*);
 
-optype_fptr opfuncs[6] = {
+static const optype_fptr opfuncs[6] = {
 	operator_attack,
 	operator_decay,
 	operator_release,
@@ -315,6 +320,434 @@ optype_fptr opfuncs[6] = {
 	operator_off
 };
 
+
+/*
+	Block kernels. The operators are rendered one after the other for a whole
+	block, instead of sample by sample. They don't share any state except for
+	the modulator output, which is passed on in a buffer.
+*/
+
+// waveform positions of an operator without vibrato
+static void phase_block_c(Bit32u tcount, Bit32u tinc, Bit32u* wfpos, Bits n) {
+	for (Bits i=0; i<n; i++) {
+		wfpos[i] = tcount;
+		tcount += tinc;
+	}
+}
+
+// operator output, the same as operator_output() without feedback
+static void output_block_c(const fltype* amps, fltype vol, const Bit16s* wform, Bit32u wmask,
+						   const Bit32u* wfpos, const Bit32s* mod, const Bit32s* trem, Bit32s* out, Bits n) {
+	for (Bits i=0; i<n; i++) {
+		Bit32u pos = wfpos[i];
+		if (mod) pos += (Bit32u)mod[i]<<16;		// modulator*FIXEDPT
+		out[i] = (Bit32s)(amps[i]*vol*wform[(pos/FIXEDPT)&wmask]*trem[i]/16.0);
+	}
+}
+
+#if defined(WOODY_SIMD)
+static void phase_block_sse2(Bit32u tcount, Bit32u tinc, Bit32u* wfpos, Bits n) {
+	__m128i pos = _mm_set_epi32(tcount+3*tinc, tcount+2*tinc, tcount+tinc, tcount);
+	__m128i step = _mm_set1_epi32(4*tinc);
+	Bits i;
+
+	for (i=0; i+4<=n; i+=4) {
+		_mm_storeu_si128((__m128i*)(wfpos+i), pos);
+		pos = _mm_add_epi32(pos, step);
+	}
+	phase_block_c(tcount+(Bit32u)i*tinc, tinc, wfpos+i, n-i);
+}
+
+static void output_block_sse2(const fltype* amps, fltype vol, const Bit16s* wform, Bit32u wmask,
+							  const Bit32u* wfpos, const Bit32s* mod, const Bit32s* trem, Bit32s* out, Bits n) {
+	const __m128i mask = _mm_set1_epi32(wmask);
+	const __m128d v = _mm_set1_pd(vol), sixteenth = _mm_set1_pd(1/16.0);
+	Bit32u idx[4];
+	Bits i;
+
+	for (i=0; i+4<=n; i+=4) {
+		__m128i pos = _mm_loadu_si128((const __m128i*)(wfpos+i));
+		if (mod) pos = _mm_add_epi32(pos, _mm_slli_epi32(_mm_loadu_si128((const __m128i*)(mod+i)), 16));
+		_mm_storeu_si128((__m128i*)idx, _mm_and_si128(_mm_srli_epi32(pos, 16), mask));
+		__m128i w = _mm_set_epi32(wform[idx[3]], wform[idx[2]], wform[idx[1]], wform[idx[0]]);
+		__m128i t = _mm_loadu_si128((const __m128i*)(trem+i));
+
+		// the same operations in the same order as output_block_c()
+		__m128d lo = _mm_mul_pd(_mm_loadu_pd(amps+i), v);
+		lo = _mm_mul_pd(lo, _mm_cvtepi32_pd(w));
+		lo = _mm_mul_pd(lo, _mm_cvtepi32_pd(t));
+		lo = _mm_mul_pd(lo, sixteenth);
+		__m128d hi = _mm_mul_pd(_mm_loadu_pd(amps+i+2), v);
+		hi = _mm_mul_pd(hi, _mm_cvtepi32_pd(_mm_srli_si128(w, 8)));
+		hi = _mm_mul_pd(hi, _mm_cvtepi32_pd(_mm_srli_si128(t, 8)));
+		hi = _mm_mul_pd(hi, sixteenth);
+		_mm_storeu_si128((__m128i*)(out+i), _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi)));
+	}
+	output_block_c(amps+i, vol, wform, wmask, wfpos+i, mod ? mod+i : 0, trem+i, out+i, n-i);
+}
+
+TARGET_AVX2
+static void phase_block_avx2(Bit32u tcount, Bit32u tinc, Bit32u* wfpos, Bits n) {
+	__m256i pos = _mm256_add_epi32(_mm256_set1_epi32(tcount),
+		_mm256_mullo_epi32(_mm256_set1_epi32(tinc), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+	__m256i step = _mm256_set1_epi32(8*tinc);
+	Bits i;
+
+	for (i=0; i+8<=n; i+=8) {
+		_mm256_storeu_si256((__m256i*)(wfpos+i), pos);
+		pos = _mm256_add_epi32(pos, step);
+	}
+	phase_block_c(tcount+(Bit32u)i*tinc, tinc, wfpos+i, n-i);
+}
+
+TARGET_AVX2
+static void output_block_avx2(const fltype* amps, fltype vol, const Bit16s* wform, Bit32u wmask,
+							  const Bit32u* wfpos, const Bit32s* mod, const Bit32s* trem, Bit32s* out, Bits n) {
+	const __m256i mask = _mm256_set1_epi32(wmask);
+	const __m256d v = _mm256_set1_pd(vol), sixteenth = _mm256_set1_pd(1/16.0);
+	Bits i;
+
+	for (i=0; i+8<=n; i+=8) {
+		__m256i pos = _mm256_loadu_si256((const __m256i*)(wfpos+i));
+		if (mod) pos = _mm256_add_epi32(pos, _mm256_slli_epi32(_mm256_loadu_si256((const __m256i*)(mod+i)), 16));
+		__m256i idx = _mm256_and_si256(_mm256_srli_epi32(pos, 16), mask);
+		// gather 32 bits at each entry and keep the sign extended lower half
+		__m256i w = _mm256_i32gather_epi32((const int*)wform, idx, 2);
+		w = _mm256_srai_epi32(_mm256_slli_epi32(w, 16), 16);
+		__m256i t = _mm256_loadu_si256((const __m256i*)(trem+i));
+
+		// the same operations in the same order as output_block_c()
+		__m256d lo = _mm256_mul_pd(_mm256_loadu_pd(amps+i), v);
+		lo = _mm256_mul_pd(lo, _mm256_cvtepi32_pd(_mm256_castsi256_si128(w)));
+		lo = _mm256_mul_pd(lo, _mm256_cvtepi32_pd(_mm256_castsi256_si128(t)));
+		lo = _mm256_mul_pd(lo, sixteenth);
+		__m256d hi = _mm256_mul_pd(_mm256_loadu_pd(amps+i+4), v);
+		hi = _mm256_mul_pd(hi, _mm256_cvtepi32_pd(_mm256_extracti128_si256(w, 1)));
+		hi = _mm256_mul_pd(hi, _mm256_cvtepi32_pd(_mm256_extracti128_si256(t, 1)));
+		hi = _mm256_mul_pd(hi, sixteenth);
+		_mm256_storeu_si256((__m256i*)(out+i), _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)), _mm256_cvttpd_epi32(hi), 1));
+	}
+	output_block_c(amps+i, vol, wform, wmask, wfpos+i, mod ? mod+i : 0, trem+i, out+i, n-i);
+}
+
+// AVX2 needs support by the CPU and the operating system
+static bool detect_avx2() {
+#if defined(_MSC_VER)
+	int r[4];
+	__cpuid(r, 0);
+	if (r[0] < 7) return false;
+	__cpuid(r, 1);
+	if ((r[2] & (3<<27)) != (3<<27)) return false;	// OSXSAVE and AVX
+	if ((_xgetbv(0) & 6) != 6) return false;		// XMM and YMM state enabled
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1<<5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+Bitu OPLChipClass::adlib_setsimd(Bitu level) {
+	simd = SIMD_NONE;
+	phase_block = phase_block_c;
+	output_block = output_block_c;
+
+#if defined(WOODY_SIMD)
+	// initialization of a local static is serialized by the compiler
+	static const bool has_avx2 = detect_avx2();
+
+	if (level >= SIMD_AVX2 && has_avx2) {
+		simd = SIMD_AVX2;
+		phase_block = phase_block_avx2;
+		output_block = output_block_avx2;
+	} else if (level >= SIMD_SSE2) {	// always there on x86-64
+		simd = SIMD_SSE2;
+		phase_block = phase_block_sse2;
+		output_block = output_block_sse2;
+	}
+#endif
+
+	return simd;
+}
+
+// keep the envelope of a sustained operator going for n samples, the same as
+// n calls of operator_sustain() after advancing the generator
+void OPLChipClass::envelope_sustain(op_type* op_pt, Bits n) {
+	// the first addition may wrap around like it does sample by sample
+	Bit32u pos = op_pt->generator_pos + generator_add;
+	uint64_t total = (uint64_t)pos + (uint64_t)(n-1)*generator_add;
+
+	op_pt->cur_env_step += (Bits)(total/FIXEDPT);
+	op_pt->generator_pos = (Bit32u)(total%FIXEDPT);
+}
+
+// true if one of the n (standardized) samples after cur_env_step is the
+// first of an envelope step of env_step+1 samples. The envelope functions
+// check for this sample by sample, but the outcome of the check is the same
+// each time within one output sample.
+static inline bool envelope_step(Bits cur_env_step, Bit32u n, Bits env_step) {
+	return ((cur_env_step+(Bits)n) & ~env_step) != (cur_env_step & ~env_step);
+}
+
+// operator_decay() for as many samples from i on as the operator stays in
+// decay mode, returns the next sample
+static Bits envelope_decay(op_type* op_pt, Bit32u generator_add, fltype* amps, Bits i, Bits n) {
+	fltype amp = op_pt->amp, step_amp = op_pt->step_amp;
+	const fltype sustain_level = op_pt->sustain_level, decaymul = op_pt->decaymul;
+	const Bits env_step_d = op_pt->env_step_d;
+	Bit32u generator_pos = op_pt->generator_pos, op_state = OF_TYPE_DEC;
+	Bits cur_env_step = op_pt->cur_env_step;
+
+	while (i<n && op_state==OF_TYPE_DEC) {
+		generator_pos += generator_add;
+		if (amp > sustain_level) amp *= decaymul;
+
+		Bit32u num_steps_add = generator_pos/FIXEDPT;
+		if (envelope_step(cur_env_step, num_steps_add, env_step_d)) {
+			if (amp <= sustain_level) {
+				if (op_pt->sus_keep) {
+					op_state = OF_TYPE_SUS;
+					amp = sustain_level;
+				} else op_state = OF_TYPE_SUS_NOKEEP;
+			}
+			step_amp = amp;
+		}
+		cur_env_step += num_steps_add;
+		generator_pos -= num_steps_add*FIXEDPT;
+		amps[i++] = step_amp;
+	}
+
+	op_pt->amp = amp;
+	op_pt->step_amp = step_amp;
+	op_pt->generator_pos = generator_pos;
+	op_pt->cur_env_step = cur_env_step;
+	op_pt->op_state = op_state;
+	return i;
+}
+
+// operator_release() for as many samples from i on as the operator isn't
+// switched off, returns the next sample
+static Bits envelope_release(op_type* op_pt, Bit32u generator_add, fltype* amps, Bits i, Bits n) {
+	fltype amp = op_pt->amp, step_amp = op_pt->step_amp;
+	const fltype releasemul = op_pt->releasemul;
+	const Bits env_step_r = op_pt->env_step_r;
+	Bit32u generator_pos = op_pt->generator_pos, op_state = op_pt->op_state;
+	Bits cur_env_step = op_pt->cur_env_step;
+
+	while (i<n && op_state!=OF_TYPE_OFF) {
+		generator_pos += generator_add;
+		if (amp > 0.00000001) amp *= releasemul;
+
+		Bit32u num_steps_add = generator_pos/FIXEDPT;
+		if (envelope_step(cur_env_step, num_steps_add, env_step_r)) {
+			if (amp <= 0.00000001) {
+				amp = 0.0;
+				if (op_state == OF_TYPE_REL) op_state = OF_TYPE_OFF;
+			}
+			step_amp = amp;
+		}
+		cur_env_step += num_steps_add;
+		generator_pos -= num_steps_add*FIXEDPT;
+		amps[i++] = step_amp;
+	}
+
+	op_pt->amp = amp;
+	op_pt->step_amp = step_amp;
+	op_pt->generator_pos = generator_pos;
+	op_pt->cur_env_step = cur_env_step;
+	op_pt->op_state = op_state;
+	return i;
+}
+
+// waveform positions and envelope of an operator for n samples, the same as
+// operator_advance() and opfuncs[] for every sample. Returns the number of
+// samples before the operator got switched off.
+Bits OPLChipClass::operator_envelope(op_type* op_pt, const Bit32s* vib, Bit32u* wfpos, fltype* amps, Bits n) {
+	Bits i, active = n;
+
+	// waveform positions
+	if (vib == vibval_const) {
+		phase_block(op_pt->tcount, op_pt->tinc, wfpos, n);
+		op_pt->tcount += (Bit32u)n*op_pt->tinc;
+	} else {
+		for (i=0; i<n; i++) {
+			wfpos[i] = op_pt->tcount;
+			op_pt->tcount += op_pt->tinc;
+			op_pt->tcount += (Bit32s)(op_pt->tinc)*vib[i]/FIXEDPT;
+		}
+	}
+	op_pt->wfpos = wfpos[n-1];
+
+	// envelope, the amplification of every sample the operator is on
+	if (op_pt->op_state == OF_TYPE_OFF) {
+		op_pt->generator_pos += (Bit32u)n*generator_add;
+		return 0;
+	}
+	for (i=0; i<active; ) {
+		switch (op_pt->op_state) {
+		case OF_TYPE_SUS:
+			// only the step counter changes from here on
+			envelope_sustain(op_pt, n-i);
+			for (; i<n; i++) amps[i] = op_pt->step_amp;
+			break;
+		case OF_TYPE_DEC:
+			i = envelope_decay(op_pt, generator_add, amps, i, n);
+			break;
+		case OF_TYPE_REL:
+		case OF_TYPE_SUS_NOKEEP:
+			i = envelope_release(op_pt, generator_add, amps, i, n);
+			break;
+		default:
+			op_pt->generator_pos += generator_add;
+			opfuncs[op_pt->op_state](op_pt);
+			amps[i++] = op_pt->step_amp;
+			break;
+		}
+
+		if (op_pt->op_state == OF_TYPE_OFF) {
+			// switched off during the last sample, no output from there on
+			op_pt->generator_pos += (Bit32u)(n-i)*generator_add;
+			active = i-1;
+		}
+	}
+
+	return active;
+}
+
+// render n samples of an operator without feedback, the same as
+// operator_advance(), opfuncs[] and operator_output() for every sample.
+// The output goes to out, the modulator (if any) is taken from mod.
+void OPLChipClass::operator_block(op_type* op_pt, const Bit32s* vib, const Bit32s* trem, const Bit32s* mod, Bit32s* out, Bits n) {
+	Bit32u wfpos[BLOCKBUF_SIZE];
+	fltype amps[BLOCKBUF_SIZE];
+	Bits i, active = operator_envelope(op_pt, vib, wfpos, amps, n);
+
+	if (active) {
+		output_block(amps, op_pt->vol, op_pt->cur_wform, op_pt->cur_wmask, wfpos, mod, trem, out, active);
+		op_pt->lastcval = active > 1 ? out[active-2] : op_pt->cval;
+		op_pt->cval = out[active-1];
+	}
+
+	// a switched off operator keeps its last output
+	for (i=active; i<n; i++) out[i] = op_pt->cval;
+}
+
+// waveform positions and envelopes of an operator with feedback (op1) and,
+// if not NULL, of the next operator (op2) for fbpair_render()
+void OPLChipClass::fbpair_prepare(fbpair_type* p, op_type* op1, const Bit32s* vib1, const Bit32s* trem1,
+								  op_type* op2, const Bit32s* vib2, const Bit32s* trem2, bool modulated, Bits n) {
+	p->op1 = op1;
+	p->op2 = op2;
+	p->trem1 = trem1;
+	p->trem2 = trem2;
+	p->modulated = modulated;
+	p->active1 = operator_envelope(op1, vib1, p->wfpos1, p->amps1, n);
+	p->active2 = op2 ? operator_envelope(op2, vib2, p->wfpos2, p->amps2, n) : 0;
+}
+
+// state of a feedback pair while it is rendered, kept in locals so that the
+// chain from one sample to the next doesn't go through memory
+typedef struct {
+	const fbpair_type* p;
+	Bit32s mfbi;
+	fltype vol1, vol2;
+	const Bit16s *wform1, *wform2;
+	Bit32u wmask1, wmask2;
+	Bit32s cval1, lastcval1, cval2, lastcval2;
+} fbpair_regs;
+
+static inline void fbpair_load(fbpair_regs& r, const fbpair_type* p) {
+	r.p = p;
+	r.mfbi = p->op1->mfbi;
+	r.vol1 = p->op1->vol;
+	r.wform1 = p->op1->cur_wform;
+	r.wmask1 = p->op1->cur_wmask;
+	r.cval1 = p->op1->cval;
+	r.lastcval1 = p->op1->lastcval;
+	if (p->op2) {
+		r.vol2 = p->op2->vol;
+		r.wform2 = p->op2->cur_wform;
+		r.wmask2 = p->op2->cur_wmask;
+		r.cval2 = p->op2->cval;
+		r.lastcval2 = p->op2->lastcval;
+	} else {
+		// never read, since active2 is 0, but keep the pair fully defined
+		r.vol2 = 0;
+		r.wform2 = p->op1->cur_wform;
+		r.wmask2 = 0;
+		r.cval2 = r.lastcval2 = 0;
+	}
+}
+
+static inline void fbpair_store(const fbpair_regs& r) {
+	r.p->op1->cval = r.cval1;
+	r.p->op1->lastcval = r.lastcval1;
+	if (r.p->op2) {
+		r.p->op2->cval = r.cval2;
+		r.p->op2->lastcval = r.lastcval2;
+	}
+}
+
+// one sample of a feedback pair, the same as operator_output() for op1 and op2
+static inline void fbpair_sample(fbpair_regs& r, fbpair_type* p, Bits i) {
+	if (i < p->active1) {
+		Bit32s modulator = (r.lastcval1+r.cval1)*r.mfbi/2;
+		r.lastcval1 = r.cval1;
+		Bit32u idx = (Bit32u)((p->wfpos1[i]+modulator)/FIXEDPT);
+		r.cval1 = (Bit32s)(p->amps1[i]*r.vol1*r.wform1[idx&r.wmask1]*p->trem1[i]/16.0);
+	}
+	p->out1[i] = r.cval1;
+
+	if (i < p->active2) {
+		Bit32u pos = p->wfpos2[i];
+		if (p->modulated) pos += (Bit32u)r.cval1<<16;	// modulator*FIXEDPT
+		r.lastcval2 = r.cval2;
+		r.cval2 = (Bit32s)(p->amps2[i]*r.vol2*r.wform2[(pos/FIXEDPT)&r.wmask2]*p->trem2[i]/16.0);
+	}
+	p->out2[i] = r.cval2;
+}
+
+// render n samples of one or two prepared feedback pairs into their out1/out2.
+// The feedback makes op1 depend on its previous sample, so this is a serial
+// chain; interleaving two independent pairs lets their chains overlap.
+void OPLChipClass::fbpair_render(fbpair_type* p1, fbpair_type* p2, Bits n) {
+	fbpair_regs r1, r2;
+	Bits i;
+
+	fbpair_load(r1, p1);
+	if (p2) {
+		fbpair_load(r2, p2);
+		for (i=0; i<n; i++) {
+			fbpair_sample(r1, p1, i);
+			fbpair_sample(r2, p2, i);
+		}
+		fbpair_store(r2);
+	} else {
+		for (i=0; i<n; i++) fbpair_sample(r1, p1, i);
+	}
+	fbpair_store(r1);
+}
+
+// render n samples of an operator with feedback (op1) and, if not NULL, of the
+// next operator (op2), which is modulated by op1 if requested
+void OPLChipClass::operator_block_fb(op_type* op1, const Bit32s* vib1, const Bit32s* trem1, Bit32s* out1,
+									 op_type* op2, const Bit32s* vib2, const Bit32s* trem2, bool modulated, Bit32s* out2, Bits n) {
+	if (!op1->mfbi) {
+		operator_block(op1, vib1, trem1, 0, out1, n);
+		if (op2) operator_block(op2, vib2, trem2, modulated ? out1 : 0, out2, n);
+		return;
+	}
+
+	// fbpair[0] may hold a pair that adlib_getsample() hasn't rendered yet
+	fbpair_type* p = &fbpair[1];
+	fbpair_prepare(p, op1, vib1, trem1, op2, vib2, trem2, modulated, n);
+	fbpair_render(p, 0, n);
+	memcpy(out1, p->out1, n*sizeof(Bit32s));
+	if (op2) memcpy(out2, p->out2, n*sizeof(Bit32s));
+}
+
 void OPLChipClass::change_attackrate(Bitu regbase, op_type* op_pt) {
 	Bits attackrate = adlibreg[ARC_ATTR_DECR+regbase]>>4;
 	if (attackrate) {
@@ -330,7 +763,7 @@ void OPLChipClass::change_attackrate(Bitu regbase, op_type* op_pt) {
 		op_pt->env_step_a = (1<<(steps<=12?12-steps:0))-1;
 
 		Bits step_num = (step_skip<=48)?(4-(step_skip&3)):0;
-		static Bit8u step_skip_mask[5] = {0xff, 0xfe, 0xee, 0xba, 0xaa}; 
+		static const Bit8u step_skip_mask[5] = {0xff, 0xfe, 0xee, 0xba, 0xaa}; 
 		op_pt->env_step_skip_a = step_skip_mask[step_num];
 
 #if defined(OPLTYPE_IS_OPL3)
@@ -476,14 +909,88 @@ void disable_operator(op_type* op_pt, Bit32u act_type) {
 	}
 }
 
-void OPLChipClass::adlib_init(Bit32u samplerate, Bit32u numchannels, Bit32u bytespersample) {
+static bool build_tables() {
 	Bits i, j, oct;
 
+	// create vibrato table
+	vib_table[0] = 8;
+	vib_table[1] = 4;
+	vib_table[2] = 0;
+	vib_table[3] = -4;
+	for (i=4; i<VIBTAB_SIZE; i++) vib_table[i] = vib_table[i-4]*-1;
+
+	for (i=0; i<BLOCKBUF_SIZE; i++) vibval_const[i] = 0;
+
+
+	// create tremolo table
+	Bit32s trem_table_int[TREMTAB_SIZE];
+	for (i=0; i<14; i++)	trem_table_int[i] = i-13;		// upwards (13 to 26 -> -0.5/6 to 0)
+	for (i=14; i<41; i++)	trem_table_int[i] = -i+14;		// downwards (26 to 0 -> 0 to -1/6)
+	for (i=41; i<53; i++)	trem_table_int[i] = i-40-26;	// upwards (1 to 12 -> -1/6 to -0.5/6)
+
+	for (i=0; i<TREMTAB_SIZE; i++) {
+		// 0.0 .. -26/26*4.8/6 == [0.0 .. -0.8], 4/53 steps == [1 .. 0.57]
+		fltype trem_val1=(fltype)(((fltype)trem_table_int[i])*4.8/26.0/6.0);				// 4.8db
+		fltype trem_val2=(fltype)((fltype)((Bit32s)(trem_table_int[i]/4))*1.2/6.0/6.0);		// 1.2db (larger stepping)
+
+		trem_table[i] = (Bit32s)(pow(FL2,trem_val1)*FIXEDPT);
+		trem_table[TREMTAB_SIZE+i] = (Bit32s)(pow(FL2,trem_val2)*FIXEDPT);
+	}
+
+	for (i=0; i<BLOCKBUF_SIZE; i++) tremval_const[i] = FIXEDPT;
+
+
+	// create waveform tables
+	for (i=0;i<(WAVEPREC>>1);i++) {
+		wavtable[(i<<1)  +WAVEPREC]	= (Bit16s)(16384*sin((fltype)((i<<1)  )*PI*2/WAVEPREC));
+		wavtable[(i<<1)+1+WAVEPREC]	= (Bit16s)(16384*sin((fltype)((i<<1)+1)*PI*2/WAVEPREC));
+		wavtable[i]					= wavtable[(i<<1)  +WAVEPREC];
+		// alternative: (zero-less)
+/*			wavtable[(i<<1)  +WAVEPREC]	= (Bit16s)(16384*sin((fltype)((i<<2)+1)*PI/WAVEPREC));
+		wavtable[(i<<1)+1+WAVEPREC]	= (Bit16s)(16384*sin((fltype)((i<<2)+3)*PI/WAVEPREC));
+		wavtable[i]					= wavtable[(i<<1)-1+WAVEPREC]; */
+	}
+	for (i=0;i<(WAVEPREC>>3);i++) {
+		wavtable[i+(WAVEPREC<<1)]		= wavtable[i+(WAVEPREC>>3)]-16384;
+		wavtable[i+((WAVEPREC*17)>>3)]	= wavtable[i+(WAVEPREC>>2)]+16384;
+	}
+
+	// key scale level table verified ([table in book]*8/3)
+	kslev[7][0] = 0;	kslev[7][1] = 24;	kslev[7][2] = 32;	kslev[7][3] = 37;
+	kslev[7][4] = 40;	kslev[7][5] = 43;	kslev[7][6] = 45;	kslev[7][7] = 47;
+	kslev[7][8] = 48;
+	for (i=9;i<16;i++) kslev[7][i] = (Bit8u)(i+41);
+	for (j=6;j>=0;j--) {
+		for (i=0;i<16;i++) {
+			oct = (Bits)kslev[j+1][i]-8;
+			if (oct < 0) oct = 0;
+			kslev[j][i] = (Bit8u)oct;
+		}
+	}
+
+	return true;
+}
+
+// build the shared tables exactly once, even if several threads create chips at the same time
+void OPLChipClass::init_tables() {
+	// initialization of a local static is serialized by the compiler
+	static const bool tables_built = build_tables();
+	(void)tables_built;
+}
+
+void OPLChipClass::adlib_init(Bit32u samplerate, Bit32u numchannels, Bit32u bytespersample) {
+	Bits i;
+
 	int_samplerate = samplerate;
 	int_numsamplechannels = numchannels;
 	int_bytespersample = bytespersample;
 
+	init_tables();
+	adlib_setsimd(SIMD_AVX2);
+
 	generator_add = (Bit32u)(INTFREQU*FIXEDPT/int_samplerate);
+	noise = 1;
+	mute = 0;
 
 
 	memset((void *)adlibreg,0,sizeof(adlibreg));
@@ -528,75 +1035,14 @@ void OPLChipClass::adlib_init(Bit32u samplerate, Bit32u numchannels, Bit32u byte
 	opl_index = 0;
 
 
-	// create vibrato table
-	vib_table[0] = 8;
-	vib_table[1] = 4;
-	vib_table[2] = 0;
-	vib_table[3] = -4;
-	for (i=4; i<VIBTAB_SIZE; i++) vib_table[i] = vib_table[i-4]*-1;
-
 	// vibrato at ~6.1 ?? (opl3 docs say 6.1, opl4 docs say 6.0, y8950 docs say 6.4)
 	vibtab_add = static_cast<Bit32u>(VIBTAB_SIZE*FIXEDPT_LFO/8192*INTFREQU/int_samplerate);
 	vibtab_pos = 0;
 
-	for (i=0; i<BLOCKBUF_SIZE; i++) vibval_const[i] = 0;
-
-
-	// create tremolo table
-	Bit32s trem_table_int[TREMTAB_SIZE];
-	for (i=0; i<14; i++)	trem_table_int[i] = i-13;		// upwards (13 to 26 -> -0.5/6 to 0)
-	for (i=14; i<41; i++)	trem_table_int[i] = -i+14;		// downwards (26 to 0 -> 0 to -1/6)
-	for (i=41; i<53; i++)	trem_table_int[i] = i-40-26;	// upwards (1 to 12 -> -1/6 to -0.5/6)
-
-	for (i=0; i<TREMTAB_SIZE; i++) {
-		// 0.0 .. -26/26*4.8/6 == [0.0 .. -0.8], 4/53 steps == [1 .. 0.57]
-		fltype trem_val1=(fltype)(((fltype)trem_table_int[i])*4.8/26.0/6.0);				// 4.8db
-		fltype trem_val2=(fltype)((fltype)((Bit32s)(trem_table_int[i]/4))*1.2/6.0/6.0);		// 1.2db (larger stepping)
-
-		trem_table[i] = (Bit32s)(pow(FL2,trem_val1)*FIXEDPT);
-		trem_table[TREMTAB_SIZE+i] = (Bit32s)(pow(FL2,trem_val2)*FIXEDPT);
-	}
-
 	// tremolo at 3.7hz
 	tremtab_add = (Bit32u)((fltype)TREMTAB_SIZE * TREM_FREQ * FIXEDPT_LFO / (fltype)int_samplerate);
 	tremtab_pos = 0;
 
-	for (i=0; i<BLOCKBUF_SIZE; i++) tremval_const[i] = FIXEDPT;
-
-
-	static Bitu initfirstime = 0;
-	if (!initfirstime) {
-		initfirstime = 1;
-
-		// create waveform tables
-		for (i=0;i<(WAVEPREC>>1);i++) {
-			wavtable[(i<<1)  +WAVEPREC]	= (Bit16s)(16384*sin((fltype)((i<<1)  )*PI*2/WAVEPREC));
-			wavtable[(i<<1)+1+WAVEPREC]	= (Bit16s)(16384*sin((fltype)((i<<1)+1)*PI*2/WAVEPREC));
-			wavtable[i]					= wavtable[(i<<1)  +WAVEPREC];
-			// alternative: (zero-less)
-/*			wavtable[(i<<1)  +WAVEPREC]	= (Bit16s)(16384*sin((fltype)((i<<2)+1)*PI/WAVEPREC));
-			wavtable[(i<<1)+1+WAVEPREC]	= (Bit16s)(16384*sin((fltype)((i<<2)+3)*PI/WAVEPREC));
-			wavtable[i]					= wavtable[(i<<1)-1+WAVEPREC]; */
-		}
-		for (i=0;i<(WAVEPREC>>3);i++) {
-			wavtable[i+(WAVEPREC<<1)]		= wavtable[i+(WAVEPREC>>3)]-16384;
-			wavtable[i+((WAVEPREC*17)>>3)]	= wavtable[i+(WAVEPREC>>2)]+16384;
-		}
-
-		// key scale level table verified ([table in book]*8/3)
-		kslev[7][0] = 0;	kslev[7][1] = 24;	kslev[7][2] = 32;	kslev[7][3] = 37;
-		kslev[7][4] = 40;	kslev[7][5] = 43;	kslev[7][6] = 45;	kslev[7][7] = 47;
-		kslev[7][8] = 48;
-		for (i=9;i<16;i++) kslev[7][i] = (Bit8u)(i+41);
-		for (j=6;j>=0;j--) {
-			for (i=0;i<16;i++) {
-				oct = (Bits)kslev[j+1][i]-8;
-				if (oct < 0) oct = 0;
-				kslev[j][i] = (Bit8u)oct;
-			}
-		}
-	}
-
 }
 
 
@@ -952,510 +1398,524 @@ static void OPL_INLINE clipit8(Bit32s ival, Bit8s* outval) {
 
 
 // be careful with this
-// uses cptr and chanval, outputs into outbufl(/outbufr)
+// uses cptr and chanval, outputs into chl(/chr)
 // for opl3 check if opl3-mode is enabled (which uses stereo panning)
 #undef CHANVAL_OUT
 #if defined(OPLTYPE_IS_OPL3)
 #define CHANVAL_OUT									\
 	if (adlibreg[0x105]&1) {						\
-		outbufl[i] += chanval*cptr[0].left_pan;		\
-		outbufr[i] += chanval*cptr[0].right_pan;	\
+		chl[i] += chanval*cptr[0].left_pan;			\
+		chr[i] += chanval*cptr[0].right_pan;		\
 	} else {										\
-		outbufl[i] += chanval;						\
+		chl[i] += chanval;							\
 	}
 #else
 #define CHANVAL_OUT									\
-	outbufl[i] += chanval;
+	chl[i] += chanval;
 #endif
 
-void OPLChipClass::adlib_getsample(Bit16s* sndptr, Bits numsamples) {
-	Bits i, endsamples;
-	op_type* cptr;
-	Bit8s* sndptr1 = (Bit8s *)sndptr;
+// following output goes to the stem of channel c, if stems are rendered
+#define CHANNEL_OUT(c)								\
+	if (stems) {									\
+		chl = stems[c];								\
+		chr = stems[c]+BLOCKBUF_SIZE;				\
+	}
 
-	Bit32s outbufl[BLOCKBUF_SIZE];
-#if defined(OPLTYPE_IS_OPL3)
-	// second output buffer (right channel for opl3 stereo)
-	Bit32s outbufr[BLOCKBUF_SIZE];
-#endif
+// output of a rendered feedback pair, uses cptr like CHANVAL_OUT
+#define FBPAIR_OUT(p)										\
+	cptr = (p)->op1;										\
+	CHANNEL_OUT((p)->channel)								\
+	for (i=0;i<endsamples;i++) {							\
+		Bit32s chanval = (p)->out2[i];						\
+		if (!(p)->modulated) chanval += (p)->out1[i];		\
+		CHANVAL_OUT											\
+	}
+
+// queue a 2op channel with feedback, render once there are two of them
+#define FBPAIR_ADD(op1,vib1,trem1,op2,vib2,trem2,modulated)							\
+	fbpair_prepare(&fbpair[fbpending],op1,vib1,trem1,op2,vib2,trem2,modulated,endsamples);	\
+	fbpair[fbpending].channel = cur_ch;												\
+	if (fbpending) {																\
+		fbpair_render(&fbpair[0],&fbpair[1],endsamples);							\
+		FBPAIR_OUT(&fbpair[0])														\
+		FBPAIR_OUT(&fbpair[1])														\
+		fbpending = 0;																\
+	} else fbpending = 1;
+
+// render 'endsamples' (at most BLOCKBUF_SIZE) samples of all channels into outbufl,
+// and into outbufr as well if the opl3 stereo mode is enabled. If 'stems' is given,
+// every channel goes to the left and right half of stems[channel] instead, and
+// channels without one are skipped like muted ones.
+void OPLChipClass::render_block(Bit32s* outbufl, Bit32s* outbufr, Bits endsamples, Bit32s** stems) {
+	Bits i;
+	op_type* cptr;
+	Bit32s *chl = outbufl, *chr = outbufr;	// output of the current channel
+	Bit32u skip = mute;
 
 	// vibrato/tremolo lookup tables (global, to possibly be used by all operators)
 	Bit32s vib_lut[BLOCKBUF_SIZE];
 	Bit32s trem_lut[BLOCKBUF_SIZE];
 
-	Bits samples_to_process = numsamples;
+	// operator output, passed on to the next operator
+	Bit32s opbuf1[BLOCKBUF_SIZE];
+	Bit32s opbuf2[BLOCKBUF_SIZE];
 
-	for (Bits cursmp=0; cursmp<samples_to_process; cursmp+=endsamples) {
-		endsamples = samples_to_process-cursmp;
-		if (endsamples>BLOCKBUF_SIZE) endsamples = BLOCKBUF_SIZE;
+	// vibrato/tremolo value table pointers (used per-operator)
+	Bit32s *vibval1, *vibval2, *vibval3, *vibval4;
+	Bit32s *tremval1, *tremval2, *tremval3, *tremval4;
 
-		memset((void*)&outbufl,0,endsamples*sizeof(Bit32s));
+	if (stems) {
+		for (i=0;i<NUM_CHANNELS;i++) {
+			if (!stems[i]) skip |= 1<<i;
+			else memset((void*)stems[i],0,2*BLOCKBUF_SIZE*sizeof(Bit32s));
+		}
+	} else {
+		memset((void*)outbufl,0,endsamples*sizeof(Bit32s));
 #if defined(OPLTYPE_IS_OPL3)
 		// clear second output buffer (opl3 stereo)
-		if (adlibreg[0x105]&1) memset((void*)&outbufr,0,endsamples*sizeof(Bit32s));
+		if (adlibreg[0x105]&1) memset((void*)outbufr,0,endsamples*sizeof(Bit32s));
 #endif
+	}
 
-		// calculate vibrato/tremolo lookup tables
-		Bit32s vib_tshift = ((adlibreg[ARC_PERC_MODE]&0x40)==0) ? 1 : 0;	// 14cents/7cents switching
-		for (i=0;i<endsamples;i++) {
-			// cycle through vibrato table
-			vibtab_pos += vibtab_add;
-			if (vibtab_pos/FIXEDPT_LFO>=VIBTAB_SIZE) vibtab_pos-=VIBTAB_SIZE*FIXEDPT_LFO;
-			vib_lut[i] = vib_table[vibtab_pos/FIXEDPT_LFO]>>vib_tshift;		// 14cents (14/100 of a semitone) or 7cents
-
-			// cycle through tremolo table
-			tremtab_pos += tremtab_add;
-			if (tremtab_pos/FIXEDPT_LFO>=TREMTAB_SIZE) tremtab_pos-=TREMTAB_SIZE*FIXEDPT_LFO;
-			if (adlibreg[ARC_PERC_MODE]&0x80) trem_lut[i] = trem_table[tremtab_pos/FIXEDPT_LFO];
-			else trem_lut[i] = trem_table[TREMTAB_SIZE+tremtab_pos/FIXEDPT_LFO];
-		}
-
-		if (adlibreg[ARC_PERC_MODE]&0x20) {
-			//BassDrum
-			cptr = &op[6];
-			if (adlibreg[ARC_FEEDBACK+6]&1) {
-				// additive synthesis
-				if (cptr[9].op_state != OF_TYPE_OFF) {
-					if (cptr[9].vibrato) {
-						vibval1 = vibval_var1;
-						for (i=0;i<endsamples;i++)
-							vibval1[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-					} else vibval1 = vibval_const;
-					if (cptr[9].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-					else tremval1 = tremval_const;
-
-					// calculate channel output
-					for (i=0;i<endsamples;i++) {
-						operator_advance(&cptr[9],vibval1[i]);
-						opfuncs[cptr[9].op_state](&cptr[9]);
-						operator_output(&cptr[9],0,tremval1[i]);
-						
-						Bit32s chanval = cptr[9].cval*2;
-						CHANVAL_OUT
-					}
-				}
-			} else {
-				// frequency modulation
-				if ((cptr[9].op_state != OF_TYPE_OFF) || (cptr[0].op_state != OF_TYPE_OFF)) {
-					if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
-						vibval1 = vibval_var1;
-						for (i=0;i<endsamples;i++)
-							vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
-					} else vibval1 = vibval_const;
-					if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
-						vibval2 = vibval_var2;
-						for (i=0;i<endsamples;i++)
-							vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-					} else vibval2 = vibval_const;
-					if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-					else tremval1 = tremval_const;
-					if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
-					else tremval2 = tremval_const;
-
-					// calculate channel output
-					for (i=0;i<endsamples;i++) {
-						operator_advance(&cptr[0],vibval1[i]);
-						opfuncs[cptr[0].op_state](&cptr[0]);
-						operator_output(&cptr[0],(cptr[0].lastcval+cptr[0].cval)*cptr[0].mfbi/2,tremval1[i]);
-
-						operator_advance(&cptr[9],vibval2[i]);
-						opfuncs[cptr[9].op_state](&cptr[9]);
-						operator_output(&cptr[9],cptr[0].cval*FIXEDPT,tremval2[i]);
-						
-						Bit32s chanval = cptr[9].cval*2;
-						CHANVAL_OUT
-					}
-				}
-			}
+	// calculate vibrato/tremolo lookup tables
+	Bit32s vib_tshift = ((adlibreg[ARC_PERC_MODE]&0x40)==0) ? 1 : 0;	// 14cents/7cents switching
+	for (i=0;i<endsamples;i++) {
+		// cycle through vibrato table
+		vibtab_pos += vibtab_add;
+		if (vibtab_pos/FIXEDPT_LFO>=VIBTAB_SIZE) vibtab_pos-=VIBTAB_SIZE*FIXEDPT_LFO;
+		vib_lut[i] = vib_table[vibtab_pos/FIXEDPT_LFO]>>vib_tshift;		// 14cents (14/100 of a semitone) or 7cents
+
+		// cycle through tremolo table
+		tremtab_pos += tremtab_add;
+		if (tremtab_pos/FIXEDPT_LFO>=TREMTAB_SIZE) tremtab_pos-=TREMTAB_SIZE*FIXEDPT_LFO;
+		if (adlibreg[ARC_PERC_MODE]&0x80) trem_lut[i] = trem_table[tremtab_pos/FIXEDPT_LFO];
+		else trem_lut[i] = trem_table[TREMTAB_SIZE+tremtab_pos/FIXEDPT_LFO];
+	}
 
-			//TomTom (j=8)
-			if (op[8].op_state != OF_TYPE_OFF) {
-				cptr = &op[8];
-				if (cptr[0].vibrato) {
-					vibval3 = vibval_var1;
+	if (adlibreg[ARC_PERC_MODE]&0x20) {
+		//BassDrum
+		cptr = &op[6];
+		CHANNEL_OUT(6)
+		if (adlibreg[ARC_FEEDBACK+6]&1) {
+			// additive synthesis
+			if ((cptr[9].op_state != OF_TYPE_OFF) && !((skip>>6)&1)) {
+				if (cptr[9].vibrato) {
+					vibval1 = vibval_var1;
 					for (i=0;i<endsamples;i++)
-						vibval3[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
-				} else vibval3 = vibval_const;
-
-				if (cptr[0].tremolo) tremval3 = trem_lut;	// tremolo enabled, use table
-				else tremval3 = tremval_const;
+						vibval1[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+				} else vibval1 = vibval_const;
+				if (cptr[9].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+				else tremval1 = tremval_const;
 
 				// calculate channel output
+				operator_block(&cptr[9],vibval1,tremval1,0,opbuf1,endsamples);
 				for (i=0;i<endsamples;i++) {
-					operator_advance(&cptr[0],vibval3[i]);
-					opfuncs[cptr[0].op_state](&cptr[0]);		//TomTom
-					operator_output(&cptr[0],0,tremval3[i]);
-					Bit32s chanval = cptr[0].cval*2;
+					Bit32s chanval = opbuf1[i]*2;
 					CHANVAL_OUT
 				}
 			}
-
-			//Snare/Hihat (j=7), Cymbal (j=8)
-			if ((op[7].op_state != OF_TYPE_OFF) || (op[16].op_state != OF_TYPE_OFF) ||
-				(op[17].op_state != OF_TYPE_OFF)) {
-				cptr = &op[7];
+		} else {
+			// frequency modulation
+			if (((cptr[9].op_state != OF_TYPE_OFF) || (cptr[0].op_state != OF_TYPE_OFF)) && !((skip>>6)&1)) {
 				if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
 					vibval1 = vibval_var1;
 					for (i=0;i<endsamples;i++)
 						vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
 				} else vibval1 = vibval_const;
-				if ((cptr[9].vibrato) && (cptr[9].op_state == OF_TYPE_OFF)) {
+				if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
 					vibval2 = vibval_var2;
 					for (i=0;i<endsamples;i++)
 						vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
 				} else vibval2 = vibval_const;
-
 				if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
 				else tremval1 = tremval_const;
 				if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
 				else tremval2 = tremval_const;
 
-				cptr = &op[8];
-				if ((cptr[9].vibrato) && (cptr[9].op_state == OF_TYPE_OFF)) {
-					vibval4 = vibval_var2;
-					for (i=0;i<endsamples;i++)
-						vibval4[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-				} else vibval4 = vibval_const;
-
-				if (cptr[9].tremolo) tremval4 = trem_lut;	// tremolo enabled, use table
-				else tremval4 = tremval_const;
-
 				// calculate channel output
+				operator_block_fb(&cptr[0],vibval1,tremval1,opbuf1,&cptr[9],vibval2,tremval2,true,opbuf2,endsamples);
 				for (i=0;i<endsamples;i++) {
-					operator_advance_drums(&op[7],vibval1[i],&op[7+9],vibval2[i],&op[8+9],vibval4[i]);
-
-					opfuncs[op[7].op_state](&op[7]);			//Hihat
-					operator_output(&op[7],0,tremval1[i]);
+					Bit32s chanval = opbuf2[i]*2;
+					CHANVAL_OUT
+				}
+			}
+		}
 
-					opfuncs[op[7+9].op_state](&op[7+9]);		//Snare
-					operator_output(&op[7+9],0,tremval2[i]);
+		//TomTom (j=8)
+		if ((op[8].op_state != OF_TYPE_OFF) && !((skip>>8)&1)) {
+			cptr = &op[8];
+			CHANNEL_OUT(8)
+			if (cptr[0].vibrato) {
+				vibval3 = vibval_var1;
+				for (i=0;i<endsamples;i++)
+					vibval3[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
+			} else vibval3 = vibval_const;
+
+			if (cptr[0].tremolo) tremval3 = trem_lut;	// tremolo enabled, use table
+			else tremval3 = tremval_const;
+
+			// calculate channel output
+			operator_block(&cptr[0],vibval3,tremval3,0,opbuf1,endsamples);	//TomTom
+			for (i=0;i<endsamples;i++) {
+				Bit32s chanval = opbuf1[i]*2;
+				CHANVAL_OUT
+			}
+		}
 
-					opfuncs[op[8+9].op_state](&op[8+9]);		//Cymbal
-					operator_output(&op[8+9],0,tremval4[i]);
+		//Snare/Hihat (j=7), Cymbal (j=8), calculated unless both parts are muted
+		if (((op[7].op_state != OF_TYPE_OFF) || (op[16].op_state != OF_TYPE_OFF) ||
+			(op[17].op_state != OF_TYPE_OFF)) && ((skip>>7)&(skip>>8)&1) == 0) {
+			cptr = &op[7];
+			if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
+				vibval1 = vibval_var1;
+				for (i=0;i<endsamples;i++)
+					vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
+			} else vibval1 = vibval_const;
+			if ((cptr[9].vibrato) && (cptr[9].op_state == OF_TYPE_OFF)) {
+				vibval2 = vibval_var2;
+				for (i=0;i<endsamples;i++)
+					vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+			} else vibval2 = vibval_const;
+
+			if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+			else tremval1 = tremval_const;
+			if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
+			else tremval2 = tremval_const;
+
+			cptr = &op[8];
+			if ((cptr[9].vibrato) && (cptr[9].op_state == OF_TYPE_OFF)) {
+				vibval4 = vibval_var2;
+				for (i=0;i<endsamples;i++)
+					vibval4[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+			} else vibval4 = vibval_const;
+
+			if (cptr[9].tremolo) tremval4 = trem_lut;	// tremolo enabled, use table
+			else tremval4 = tremval_const;
+
+			// calculate channel output
+			for (i=0;i<endsamples;i++) {
+				operator_advance_drums(&op[7],vibval1[i],&op[7+9],vibval2[i],&op[8+9],vibval4[i]);
+
+				opfuncs[op[7].op_state](&op[7]);			//Hihat
+				operator_output(&op[7],0,tremval1[i]);
+
+				opfuncs[op[7+9].op_state](&op[7+9]);		//Snare
+				operator_output(&op[7+9],0,tremval2[i]);
+
+				opfuncs[op[8+9].op_state](&op[8+9]);		//Cymbal
+				operator_output(&op[8+9],0,tremval4[i]);
+
+				opbuf1[i] = (op[7].cval + op[7+9].cval)*2;
+				opbuf2[i] = op[8+9].cval*2;
+			}
 
-					Bit32s chanval = (op[7].cval + op[7+9].cval + op[8+9].cval)*2;
+			// the parts of a muted channel are calculated, but not output. Both
+			// are panned like channel 8 (cptr).
+			if (stems || skip) {
+				CHANNEL_OUT(7)
+				if (!((skip>>7)&1)) for (i=0;i<endsamples;i++) {
+					Bit32s chanval = opbuf1[i];
 					CHANVAL_OUT
 				}
+				CHANNEL_OUT(8)
+				if (!((skip>>8)&1)) for (i=0;i<endsamples;i++) {
+					Bit32s chanval = opbuf2[i];
+					CHANVAL_OUT
+				}
+			} else for (i=0;i<endsamples;i++) {
+				Bit32s chanval = opbuf1[i] + opbuf2[i];
+				CHANVAL_OUT
 			}
 		}
+	}
 
-		Bitu max_channel = NUM_CHANNELS;
+	Bitu max_channel = NUM_CHANNELS;
 #if defined(OPLTYPE_IS_OPL3)
-		if ((adlibreg[0x105]&1)==0) max_channel = NUM_CHANNELS/2;
+	if ((adlibreg[0x105]&1)==0) max_channel = NUM_CHANNELS/2;
 #endif
-		for (Bits cur_ch=max_channel-1; cur_ch>=0; cur_ch--) {
-			// skip drum/percussion operators
-			if ((adlibreg[ARC_PERC_MODE]&0x20) && (cur_ch >= 6) && (cur_ch < 9)) continue;
+	Bits fbpending = 0;	// a channel with feedback is waiting in fbpair[0]
+	for (Bits cur_ch=max_channel-1; cur_ch>=0; cur_ch--) {
+		// skip drum/percussion operators
+		if ((adlibreg[ARC_PERC_MODE]&0x20) && (cur_ch >= 6) && (cur_ch < 9)) continue;
 
-			Bitu k = cur_ch;
+		Bitu k = cur_ch;
 #if defined(OPLTYPE_IS_OPL3)
-			if (cur_ch < 9) {
-				cptr = &op[cur_ch];
-			} else {
-				cptr = &op[cur_ch+9];	// second set is operator18-operator35
-				k += (-9+256);		// second set uses registers 0x100 onwards
-			}
-			// check if this operator is part of a 4-op
-			if ((adlibreg[0x105]&1) && cptr->is_4op_attached) continue;
-#else
+		if (cur_ch < 9) {
 			cptr = &op[cur_ch];
+		} else {
+			cptr = &op[cur_ch+9];	// second set is operator18-operator35
+			k += (-9+256);		// second set uses registers 0x100 onwards
+		}
+		// check if this operator is part of a 4-op
+		if ((adlibreg[0x105]&1) && cptr->is_4op_attached) continue;
+#else
+		cptr = &op[cur_ch];
 #endif
+		if ((skip>>cur_ch)&1) continue;
+		CHANNEL_OUT(cur_ch)
 
-			// check for FM/AM
-			if (adlibreg[ARC_FEEDBACK+k]&1) {
+		// check for FM/AM
+		if (adlibreg[ARC_FEEDBACK+k]&1) {
 #if defined(OPLTYPE_IS_OPL3)
-				if ((adlibreg[0x105]&1) && cptr->is_4op) {
-					if (adlibreg[ARC_FEEDBACK+k+3]&1) {
-						// AM-AM-style synthesis (op1[fb] + (op2 * op3) + op4)
-						if (cptr[0].op_state != OF_TYPE_OFF) {
-							if (cptr[0].vibrato) {
-								vibval1 = vibval_var1;
-								for (i=0;i<endsamples;i++)
-									vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
-							} else vibval1 = vibval_const;
-							if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-							else tremval1 = tremval_const;
-
-							// calculate channel output
-							for (i=0;i<endsamples;i++) {
-								operator_advance(&cptr[0],vibval1[i]);
-								opfuncs[cptr[0].op_state](&cptr[0]);
-								operator_output(&cptr[0],(cptr[0].lastcval+cptr[0].cval)*cptr[0].mfbi/2,tremval1[i]);
-
-								Bit32s chanval = cptr[0].cval;
-								CHANVAL_OUT
-							}
+			if ((adlibreg[0x105]&1) && cptr->is_4op) {
+				if (adlibreg[ARC_FEEDBACK+k+3]&1) {
+					// AM-AM-style synthesis (op1[fb] + (op2 * op3) + op4)
+					if (cptr[0].op_state != OF_TYPE_OFF) {
+						if (cptr[0].vibrato) {
+							vibval1 = vibval_var1;
+							for (i=0;i<endsamples;i++)
+								vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
+						} else vibval1 = vibval_const;
+						if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+						else tremval1 = tremval_const;
+
+						// calculate channel output
+						operator_block_fb(&cptr[0],vibval1,tremval1,opbuf1,0,0,0,false,0,endsamples);
+						for (i=0;i<endsamples;i++) {
+							Bit32s chanval = opbuf1[i];
+							CHANVAL_OUT
 						}
+					}
 
-						if ((cptr[3].op_state != OF_TYPE_OFF) || (cptr[9].op_state != OF_TYPE_OFF)) {
-							if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
-								vibval1 = vibval_var1;
-								for (i=0;i<endsamples;i++)
-									vibval1[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-							} else vibval1 = vibval_const;
-							if (cptr[9].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-							else tremval1 = tremval_const;
-							if (cptr[3].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
-							else tremval2 = tremval_const;
-
-							// calculate channel output
-							for (i=0;i<endsamples;i++) {
-								operator_advance(&cptr[9],vibval1[i]);
-								opfuncs[cptr[9].op_state](&cptr[9]);
-								operator_output(&cptr[9],0,tremval1[i]);
-
-								operator_advance(&cptr[3],0);
-								opfuncs[cptr[3].op_state](&cptr[3]);
-								operator_output(&cptr[3],cptr[9].cval*FIXEDPT,tremval2[i]);
-
-								Bit32s chanval = cptr[3].cval;
-								CHANVAL_OUT
-							}
+					if ((cptr[3].op_state != OF_TYPE_OFF) || (cptr[9].op_state != OF_TYPE_OFF)) {
+						if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
+							vibval1 = vibval_var1;
+							for (i=0;i<endsamples;i++)
+								vibval1[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+						} else vibval1 = vibval_const;
+						if (cptr[9].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+						else tremval1 = tremval_const;
+						if (cptr[3].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
+						else tremval2 = tremval_const;
+
+						// calculate channel output
+						operator_block(&cptr[9],vibval1,tremval1,0,opbuf1,endsamples);
+						operator_block(&cptr[3],vibval_const,tremval2,opbuf1,opbuf2,endsamples);
+						for (i=0;i<endsamples;i++) {
+							Bit32s chanval = opbuf2[i];
+							CHANVAL_OUT
 						}
+					}
 
-						if (cptr[3+9].op_state != OF_TYPE_OFF) {
-							if (cptr[3+9].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-							else tremval1 = tremval_const;
-
-							// calculate channel output
-							for (i=0;i<endsamples;i++) {
-								operator_advance(&cptr[3+9],0);
-								opfuncs[cptr[3+9].op_state](&cptr[3+9]);
-								operator_output(&cptr[3+9],0,tremval1[i]);
+					if (cptr[3+9].op_state != OF_TYPE_OFF) {
+						if (cptr[3+9].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+						else tremval1 = tremval_const;
 
-								Bit32s chanval = cptr[3+9].cval;
-								CHANVAL_OUT
-							}
+						// calculate channel output
+						operator_block(&cptr[3+9],vibval_const,tremval1,0,opbuf1,endsamples);
+						for (i=0;i<endsamples;i++) {
+							Bit32s chanval = opbuf1[i];
+							CHANVAL_OUT
 						}
-					} else {
-						// AM-FM-style synthesis (op1[fb] + (op2 * op3 * op4))
-						if (cptr[0].op_state != OF_TYPE_OFF) {
-							if (cptr[0].vibrato) {
-								vibval1 = vibval_var1;
-								for (i=0;i<endsamples;i++)
-									vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
-							} else vibval1 = vibval_const;
-							if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-							else tremval1 = tremval_const;
-
-							// calculate channel output
-							for (i=0;i<endsamples;i++) {
-								operator_advance(&cptr[0],vibval1[i]);
-								opfuncs[cptr[0].op_state](&cptr[0]);
-								operator_output(&cptr[0],(cptr[0].lastcval+cptr[0].cval)*cptr[0].mfbi/2,tremval1[i]);
-
-								Bit32s chanval = cptr[0].cval;
-								CHANVAL_OUT
-							}
+					}
+				} else {
+					// AM-FM-style synthesis (op1[fb] + (op2 * op3 * op4))
+					if (cptr[0].op_state != OF_TYPE_OFF) {
+						if (cptr[0].vibrato) {
+							vibval1 = vibval_var1;
+							for (i=0;i<endsamples;i++)
+								vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
+						} else vibval1 = vibval_const;
+						if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+						else tremval1 = tremval_const;
+
+						// calculate channel output
+						operator_block_fb(&cptr[0],vibval1,tremval1,opbuf1,0,0,0,false,0,endsamples);
+						for (i=0;i<endsamples;i++) {
+							Bit32s chanval = opbuf1[i];
+							CHANVAL_OUT
 						}
+					}
 
-						if ((cptr[9].op_state != OF_TYPE_OFF) || (cptr[3].op_state != OF_TYPE_OFF) || (cptr[3+9].op_state != OF_TYPE_OFF)) {
-							if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
-								vibval1 = vibval_var1;
-								for (i=0;i<endsamples;i++)
-									vibval1[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-							} else vibval1 = vibval_const;
-							if (cptr[9].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-							else tremval1 = tremval_const;
-							if (cptr[3].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
-							else tremval2 = tremval_const;
-							if (cptr[3+9].tremolo) tremval3 = trem_lut;	// tremolo enabled, use table
-							else tremval3 = tremval_const;
-
-							// calculate channel output
-							for (i=0;i<endsamples;i++) {
-								operator_advance(&cptr[9],vibval1[i]);
-								opfuncs[cptr[9].op_state](&cptr[9]);
-								operator_output(&cptr[9],0,tremval1[i]);
-
-								operator_advance(&cptr[3],0);
-								opfuncs[cptr[3].op_state](&cptr[3]);
-								operator_output(&cptr[3],cptr[9].cval*FIXEDPT,tremval2[i]);
-
-								operator_advance(&cptr[3+9],0);
-								opfuncs[cptr[3+9].op_state](&cptr[3+9]);
-								operator_output(&cptr[3+9],cptr[3].cval*FIXEDPT,tremval3[i]);
-
-								Bit32s chanval = cptr[3+9].cval;
-								CHANVAL_OUT
-							}
+					if ((cptr[9].op_state != OF_TYPE_OFF) || (cptr[3].op_state != OF_TYPE_OFF) || (cptr[3+9].op_state != OF_TYPE_OFF)) {
+						if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
+							vibval1 = vibval_var1;
+							for (i=0;i<endsamples;i++)
+								vibval1[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+						} else vibval1 = vibval_const;
+						if (cptr[9].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+						else tremval1 = tremval_const;
+						if (cptr[3].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
+						else tremval2 = tremval_const;
+						if (cptr[3+9].tremolo) tremval3 = trem_lut;	// tremolo enabled, use table
+						else tremval3 = tremval_const;
+
+						// calculate channel output
+						operator_block(&cptr[9],vibval1,tremval1,0,opbuf1,endsamples);
+						operator_block(&cptr[3],vibval_const,tremval2,opbuf1,opbuf2,endsamples);
+						operator_block(&cptr[3+9],vibval_const,tremval3,opbuf2,opbuf1,endsamples);
+						for (i=0;i<endsamples;i++) {
+							Bit32s chanval = opbuf1[i];
+							CHANVAL_OUT
 						}
 					}
-					continue;
 				}
+				continue;
+			}
 #endif
-				// 2op additive synthesis
-				if ((cptr[9].op_state == OF_TYPE_OFF) && (cptr[0].op_state == OF_TYPE_OFF)) continue;
-				if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
-					vibval1 = vibval_var1;
-					for (i=0;i<endsamples;i++)
-						vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
-				} else vibval1 = vibval_const;
-				if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
-					vibval2 = vibval_var2;
-					for (i=0;i<endsamples;i++)
-						vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-				} else vibval2 = vibval_const;
-				if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-				else tremval1 = tremval_const;
-				if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
-				else tremval2 = tremval_const;
-
-				// calculate channel output
-				for (i=0;i<endsamples;i++) {
-					// carrier1
-					operator_advance(&cptr[0],vibval1[i]);
-					opfuncs[cptr[0].op_state](&cptr[0]);
-					operator_output(&cptr[0],(cptr[0].lastcval+cptr[0].cval)*cptr[0].mfbi/2,tremval1[i]);
-
-					// carrier2
-					operator_advance(&cptr[9],vibval2[i]);
-					opfuncs[cptr[9].op_state](&cptr[9]);
-					operator_output(&cptr[9],0,tremval2[i]);
-
-					Bit32s chanval = cptr[9].cval + cptr[0].cval;
-					CHANVAL_OUT
-				}
-			} else {
+			// 2op additive synthesis
+			if ((cptr[9].op_state == OF_TYPE_OFF) && (cptr[0].op_state == OF_TYPE_OFF)) continue;
+			if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
+				vibval1 = vibval_var1;
+				for (i=0;i<endsamples;i++)
+					vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
+			} else vibval1 = vibval_const;
+			if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
+				vibval2 = vibval_var2;
+				for (i=0;i<endsamples;i++)
+					vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+			} else vibval2 = vibval_const;
+			if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+			else tremval1 = tremval_const;
+			if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
+			else tremval2 = tremval_const;
+
+			// calculate channel output
+			if (cptr[0].mfbi) {
+				FBPAIR_ADD(&cptr[0],vibval1,tremval1,&cptr[9],vibval2,tremval2,false)	// two carriers
+				continue;
+			}
+			operator_block_fb(&cptr[0],vibval1,tremval1,opbuf1,&cptr[9],vibval2,tremval2,false,opbuf2,endsamples);	// two carriers
+			for (i=0;i<endsamples;i++) {
+				Bit32s chanval = opbuf2[i] + opbuf1[i];
+				CHANVAL_OUT
+			}
+		} else {
 #if defined(OPLTYPE_IS_OPL3)
-				if ((adlibreg[0x105]&1) && cptr->is_4op) {
-					if (adlibreg[ARC_FEEDBACK+k+3]&1) {
-						// FM-AM-style synthesis ((op1[fb] * op2) + (op3 * op4))
-						if ((cptr[0].op_state != OF_TYPE_OFF) || (cptr[9].op_state != OF_TYPE_OFF)) {
-							if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
-								vibval1 = vibval_var1;
-								for (i=0;i<endsamples;i++)
-									vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
-							} else vibval1 = vibval_const;
-							if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
-								vibval2 = vibval_var2;
-								for (i=0;i<endsamples;i++)
-									vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-							} else vibval2 = vibval_const;
-							if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-							else tremval1 = tremval_const;
-							if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
-							else tremval2 = tremval_const;
-
-							// calculate channel output
-							for (i=0;i<endsamples;i++) {
-								operator_advance(&cptr[0],vibval1[i]);
-								opfuncs[cptr[0].op_state](&cptr[0]);
-								operator_output(&cptr[0],(cptr[0].lastcval+cptr[0].cval)*cptr[0].mfbi/2,tremval1[i]);
-
-								operator_advance(&cptr[9],vibval2[i]);
-								opfuncs[cptr[9].op_state](&cptr[9]);
-								operator_output(&cptr[9],cptr[0].cval*FIXEDPT,tremval2[i]);
-
-								Bit32s chanval = cptr[9].cval;
-								CHANVAL_OUT
-							}
+			if ((adlibreg[0x105]&1) && cptr->is_4op) {
+				if (adlibreg[ARC_FEEDBACK+k+3]&1) {
+					// FM-AM-style synthesis ((op1[fb] * op2) + (op3 * op4))
+					if ((cptr[0].op_state != OF_TYPE_OFF) || (cptr[9].op_state != OF_TYPE_OFF)) {
+						if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
+							vibval1 = vibval_var1;
+							for (i=0;i<endsamples;i++)
+								vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
+						} else vibval1 = vibval_const;
+						if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
+							vibval2 = vibval_var2;
+							for (i=0;i<endsamples;i++)
+								vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+						} else vibval2 = vibval_const;
+						if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+						else tremval1 = tremval_const;
+						if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
+						else tremval2 = tremval_const;
+
+						// calculate channel output
+						operator_block_fb(&cptr[0],vibval1,tremval1,opbuf1,&cptr[9],vibval2,tremval2,true,opbuf2,endsamples);
+						for (i=0;i<endsamples;i++) {
+							Bit32s chanval = opbuf2[i];
+							CHANVAL_OUT
 						}
+					}
 
-						if ((cptr[3].op_state != OF_TYPE_OFF) || (cptr[3+9].op_state != OF_TYPE_OFF)) {
-							if (cptr[3].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-							else tremval1 = tremval_const;
-							if (cptr[3+9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
-							else tremval2 = tremval_const;
-
-							// calculate channel output
-							for (i=0;i<endsamples;i++) {
-								operator_advance(&cptr[3],0);
-								opfuncs[cptr[3].op_state](&cptr[3]);
-								operator_output(&cptr[3],0,tremval1[i]);
-
-								operator_advance(&cptr[3+9],0);
-								opfuncs[cptr[3+9].op_state](&cptr[3+9]);
-								operator_output(&cptr[3+9],cptr[3].cval*FIXEDPT,tremval2[i]);
-
-								Bit32s chanval = cptr[3+9].cval;
-								CHANVAL_OUT
-							}
+					if ((cptr[3].op_state != OF_TYPE_OFF) || (cptr[3+9].op_state != OF_TYPE_OFF)) {
+						if (cptr[3].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+						else tremval1 = tremval_const;
+						if (cptr[3+9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
+						else tremval2 = tremval_const;
+
+						// calculate channel output
+						operator_block(&cptr[3],vibval_const,tremval1,0,opbuf1,endsamples);
+						operator_block(&cptr[3+9],vibval_const,tremval2,opbuf1,opbuf2,endsamples);
+						for (i=0;i<endsamples;i++) {
+							Bit32s chanval = opbuf2[i];
+							CHANVAL_OUT
 						}
+					}
 
-					} else {
-						// FM-FM-style synthesis (op1[fb] * op2 * op3 * op4)
-						if ((cptr[0].op_state != OF_TYPE_OFF) || (cptr[9].op_state != OF_TYPE_OFF) || 
-							(cptr[3].op_state != OF_TYPE_OFF) || (cptr[3+9].op_state != OF_TYPE_OFF)) {
-							if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
-								vibval1 = vibval_var1;
-								for (i=0;i<endsamples;i++)
-									vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
-							} else vibval1 = vibval_const;
-							if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
-								vibval2 = vibval_var2;
-								for (i=0;i<endsamples;i++)
-									vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-							} else vibval2 = vibval_const;
-							if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-							else tremval1 = tremval_const;
-							if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
-							else tremval2 = tremval_const;
-							if (cptr[3].tremolo) tremval3 = trem_lut;	// tremolo enabled, use table
-							else tremval3 = tremval_const;
-							if (cptr[3+9].tremolo) tremval4 = trem_lut;	// tremolo enabled, use table
-							else tremval4 = tremval_const;
-
-							// calculate channel output
-							for (i=0;i<endsamples;i++) {
-								operator_advance(&cptr[0],vibval1[i]);
-								opfuncs[cptr[0].op_state](&cptr[0]);
-								operator_output(&cptr[0],(cptr[0].lastcval+cptr[0].cval)*cptr[0].mfbi/2,tremval1[i]);
-
-								operator_advance(&cptr[9],vibval2[i]);
-								opfuncs[cptr[9].op_state](&cptr[9]);
-								operator_output(&cptr[9],cptr[0].cval*FIXEDPT,tremval2[i]);
-
-								operator_advance(&cptr[3],0);
-								opfuncs[cptr[3].op_state](&cptr[3]);
-								operator_output(&cptr[3],cptr[9].cval*FIXEDPT,tremval3[i]);
-
-								operator_advance(&cptr[3+9],0);
-								opfuncs[cptr[3+9].op_state](&cptr[3+9]);
-								operator_output(&cptr[3+9],cptr[3].cval*FIXEDPT,tremval4[i]);
-
-								Bit32s chanval = cptr[3+9].cval;
-								CHANVAL_OUT
-							}
+				} else {
+					// FM-FM-style synthesis (op1[fb] * op2 * op3 * op4)
+					if ((cptr[0].op_state != OF_TYPE_OFF) || (cptr[9].op_state != OF_TYPE_OFF) || 
+						(cptr[3].op_state != OF_TYPE_OFF) || (cptr[3+9].op_state != OF_TYPE_OFF)) {
+						if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
+							vibval1 = vibval_var1;
+							for (i=0;i<endsamples;i++)
+								vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
+						} else vibval1 = vibval_const;
+						if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
+							vibval2 = vibval_var2;
+							for (i=0;i<endsamples;i++)
+								vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+						} else vibval2 = vibval_const;
+						if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+						else tremval1 = tremval_const;
+						if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
+						else tremval2 = tremval_const;
+						if (cptr[3].tremolo) tremval3 = trem_lut;	// tremolo enabled, use table
+						else tremval3 = tremval_const;
+						if (cptr[3+9].tremolo) tremval4 = trem_lut;	// tremolo enabled, use table
+						else tremval4 = tremval_const;
+
+						// calculate channel output
+						operator_block_fb(&cptr[0],vibval1,tremval1,opbuf1,&cptr[9],vibval2,tremval2,true,opbuf2,endsamples);
+						operator_block(&cptr[3],vibval_const,tremval3,opbuf2,opbuf1,endsamples);
+						operator_block(&cptr[3+9],vibval_const,tremval4,opbuf1,opbuf2,endsamples);
+						for (i=0;i<endsamples;i++) {
+							Bit32s chanval = opbuf2[i];
+							CHANVAL_OUT
 						}
 					}
-					continue;
 				}
+				continue;
+			}
 #endif
-				// 2op frequency modulation
-				if ((cptr[9].op_state == OF_TYPE_OFF) && (cptr[0].op_state == OF_TYPE_OFF)) continue;
-				if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
-					vibval1 = vibval_var1;
-					for (i=0;i<endsamples;i++)
-						vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
-				} else vibval1 = vibval_const;
-				if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
-					vibval2 = vibval_var2;
-					for (i=0;i<endsamples;i++)
-						vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
-				} else vibval2 = vibval_const;
-				if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
-				else tremval1 = tremval_const;
-				if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
-				else tremval2 = tremval_const;
+			// 2op frequency modulation
+			if ((cptr[9].op_state == OF_TYPE_OFF) && (cptr[0].op_state == OF_TYPE_OFF)) continue;
+			if ((cptr[0].vibrato) && (cptr[0].op_state != OF_TYPE_OFF)) {
+				vibval1 = vibval_var1;
+				for (i=0;i<endsamples;i++)
+					vibval1[i] = (Bit32s)((vib_lut[i]*cptr[0].freq_high/8)*FIXEDPT*VIBFAC);
+			} else vibval1 = vibval_const;
+			if ((cptr[9].vibrato) && (cptr[9].op_state != OF_TYPE_OFF)) {
+				vibval2 = vibval_var2;
+				for (i=0;i<endsamples;i++)
+					vibval2[i] = (Bit32s)((vib_lut[i]*cptr[9].freq_high/8)*FIXEDPT*VIBFAC);
+			} else vibval2 = vibval_const;
+			if (cptr[0].tremolo) tremval1 = trem_lut;	// tremolo enabled, use table
+			else tremval1 = tremval_const;
+			if (cptr[9].tremolo) tremval2 = trem_lut;	// tremolo enabled, use table
+			else tremval2 = tremval_const;
+
+			// calculate channel output
+			if (cptr[0].mfbi) {
+				FBPAIR_ADD(&cptr[0],vibval1,tremval1,&cptr[9],vibval2,tremval2,true)	// modulator, carrier
+				continue;
+			}
+			operator_block_fb(&cptr[0],vibval1,tremval1,opbuf1,&cptr[9],vibval2,tremval2,true,opbuf2,endsamples);	// modulator, carrier
+			for (i=0;i<endsamples;i++) {
+				Bit32s chanval = opbuf2[i];
+				CHANVAL_OUT
+			}
+		}
+	}
+	if (fbpending) {
+		fbpair_render(&fbpair[0],0,endsamples);
+		FBPAIR_OUT(&fbpair[0])
+	}
+}
 
-				// calculate channel output
-				for (i=0;i<endsamples;i++) {
-					// modulator
-					operator_advance(&cptr[0],vibval1[i]);
-					opfuncs[cptr[0].op_state](&cptr[0]);
-					operator_output(&cptr[0],(cptr[0].lastcval+cptr[0].cval)*cptr[0].mfbi/2,tremval1[i]);
+void OPLChipClass::adlib_getsample(Bit16s* sndptr, Bits numsamples) {
+	Bits i, endsamples;
+	Bit8s* sndptr1 = (Bit8s *)sndptr;
 
-					// carrier
-					operator_advance(&cptr[9],vibval2[i]);
-					opfuncs[cptr[9].op_state](&cptr[9]);
-					operator_output(&cptr[9],cptr[0].cval*FIXEDPT,tremval2[i]);
+	Bit32s outbufl[BLOCKBUF_SIZE];
+#if defined(OPLTYPE_IS_OPL3)
+	// second output buffer (right channel for opl3 stereo)
+	Bit32s outbufr[BLOCKBUF_SIZE];
+#endif
 
-					Bit32s chanval = cptr[9].cval;
-					CHANVAL_OUT
-				}
-			}
-		}
+	Bits samples_to_process = numsamples;
+
+	for (Bits cursmp=0; cursmp<samples_to_process; cursmp+=endsamples) {
+		endsamples = samples_to_process-cursmp;
+		if (endsamples>BLOCKBUF_SIZE) endsamples = BLOCKBUF_SIZE;
+
+#if defined(OPLTYPE_IS_OPL3)
+		render_block(outbufl,outbufr,endsamples);
+#else
+		render_block(outbufl,0,endsamples);
+#endif
 
 #if defined(OPLTYPE_IS_OPL3)
 		if (adlibreg[0x105]&1) {
@@ -1510,3 +1970,98 @@ void OPLChipClass::adlib_getsample(Bit16s* sndptr, Bits numsamples) {
 
 	}
 }
+
+// like adlib_getsample(), but with 32-bit samples that are not clipped
+void OPLChipClass::adlib_getsample32(Bit32s* sndptr, Bits numsamples) {
+	Bits i, endsamples;
+
+	Bit32s outbufl[BLOCKBUF_SIZE];
+#if defined(OPLTYPE_IS_OPL3)
+	Bit32s outbufr[BLOCKBUF_SIZE];
+#endif
+
+	for (Bits cursmp=0; cursmp<numsamples; cursmp+=endsamples) {
+		endsamples = numsamples-cursmp;
+		if (endsamples>BLOCKBUF_SIZE) endsamples = BLOCKBUF_SIZE;
+
+#if defined(OPLTYPE_IS_OPL3)
+		render_block(outbufl,outbufr,endsamples);
+		if (adlibreg[0x105]&1) {
+			if (int_numsamplechannels == 1) {
+				for (i=0;i<endsamples;i++) *sndptr++ = (outbufl[i]+outbufr[i])/2;
+			} else {
+				for (i=0;i<endsamples;i++) {
+					*sndptr++ = outbufl[i];
+					*sndptr++ = outbufr[i];
+				}
+			}
+			continue;
+		}
+#else
+		render_block(outbufl,0,endsamples);
+#endif
+		if (int_numsamplechannels == 1) {
+			memcpy(sndptr,outbufl,endsamples*sizeof(Bit32s));
+			sndptr += endsamples;
+		} else {
+			for (i=0;i<endsamples;i++) {
+				*sndptr++ = outbufl[i];
+				*sndptr++ = outbufl[i];
+			}
+		}
+	}
+}
+
+// like adlib_getsample32(), but every channel goes to its own buffer bufs[channel].
+// Channels with a NULL buffer are skipped like muted ones.
+void OPLChipClass::adlib_getstems(Bit32s** bufs, Bits numsamples) {
+	Bits i, c, endsamples;
+
+	// left and right output of every channel
+	Bit32s stembuf[NUM_CHANNELS][2*BLOCKBUF_SIZE];
+	Bit32s* stems[NUM_CHANNELS];
+
+	for (c=0;c<NUM_CHANNELS;c++) stems[c] = bufs[c] ? stembuf[c] : 0;
+
+	for (Bits cursmp=0; cursmp<numsamples; cursmp+=endsamples) {
+		endsamples = numsamples-cursmp;
+		if (endsamples>BLOCKBUF_SIZE) endsamples = BLOCKBUF_SIZE;
+
+		render_block(0,0,endsamples,stems);
+
+		for (c=0;c<NUM_CHANNELS;c++) {
+			if (!bufs[c]) continue;
+			Bit32s* outl = stembuf[c];
+			Bit32s* sndptr = bufs[c]+cursmp*int_numsamplechannels;
+#if defined(OPLTYPE_IS_OPL3)
+			if (adlibreg[0x105]&1) {
+				Bit32s* outr = stembuf[c]+BLOCKBUF_SIZE;
+				if (int_numsamplechannels == 1) {
+					for (i=0;i<endsamples;i++) *sndptr++ = (outl[i]+outr[i])/2;
+				} else {
+					for (i=0;i<endsamples;i++) {
+						*sndptr++ = outl[i];
+						*sndptr++ = outr[i];
+					}
+				}
+				continue;
+			}
+#endif
+			if (int_numsamplechannels == 1) {
+				memcpy(sndptr,outl,endsamples*sizeof(Bit32s));
+			} else {
+				for (i=0;i<endsamples;i++) {
+					*sndptr++ = outl[i];
+					*sndptr++ = outl[i];
+				}
+			}
+		}
+	}
+}
+
+// leave the channels whose bit is set in 'mask' out of the output, without
+// calculating them. In rhythm mode, bits 6-8 stand for the bass drum, snare
+// drum + hihat and tom-tom + cymbal.
+void OPLChipClass::adlib_setmute(Bit32u mask) {
+	mute = mask & ((1<<NUM_CHANNELS)-1);
+}
@@ -106,6 +106,12 @@ typedef int8_t		Bit8s;
 #define BLOCKBUF_SIZE		512
 
 
+// SIMD levels of the block kernels
+#define SIMD_NONE			0		// plain C
+#define SIMD_SSE2			1
+#define SIMD_AVX2			2
+
+
 // vibrato constants
 #define VIBTAB_SIZE			8
 #define VIBFAC				70/50000		// no braces, integer mul/div
@@ -157,6 +163,19 @@ typedef struct operator_struct {
 #endif
 } op_type;
 
+// an operator with feedback and the next operator of its channel, prepared
+// for rendering (see OPLChipClass::fbpair_render)
+typedef struct fbpair_struct {
+	op_type *op1, *op2;				// operator with feedback and the next one
+	const Bit32s *trem1, *trem2;	// tremolo values
+	bool modulated;					// op2 is modulated by op1 (else both are carriers)
+	Bitu channel;					// channel whose output (or stem) this is
+	Bits active1, active2;			// samples before the operators got switched off
+	Bit32u wfpos1[BLOCKBUF_SIZE], wfpos2[BLOCKBUF_SIZE];
+	fltype amps1[BLOCKBUF_SIZE], amps2[BLOCKBUF_SIZE];
+	Bit32s out1[BLOCKBUF_SIZE], out2[BLOCKBUF_SIZE];
+} fbpair_type;
+
 class OPLChipClass {
 public:
 
@@ -185,6 +204,46 @@ public:
 	Bit32u tremtab_pos;
 	Bit32u tremtab_add;
 
+	Bit32u generator_add;	// envelope generator increment per sample
+	fltype recipsamp;		// inverse of sampling rate
+	fltype frqmul[16];		// frequency multiplication values (depend on sampling rate)
+	Bit32u noise;			// state of the noise generator (percussion)
+
+	// vibrato value tables (used per-operator)
+	Bit32s vibval_var1[BLOCKBUF_SIZE];
+	Bit32s vibval_var2[BLOCKBUF_SIZE];
+
+	// block kernels for the waveform positions without vibrato and for the
+	// operator output, chosen by adlib_setsimd()
+	Bitu simd;
+	void (*phase_block)(Bit32u tcount, Bit32u tinc, Bit32u* wfpos, Bits n);
+	void (*output_block)(const fltype* amps, fltype vol, const Bit16s* wform, Bit32u wmask,
+						 const Bit32u* wfpos, const Bit32s* mod, const Bit32s* trem, Bit32s* out, Bits n);
+
+	// operators with feedback, rendered two channels at a time
+	fbpair_type fbpair[2];
+
+	// channels left out of the output and not calculated (see adlib_setmute)
+	Bit32u mute;
+
+	// advance the waveform position of operators
+	void operator_advance(op_type* op_pt, Bit32s vib);
+	void operator_advance_drums(op_type* op_pt1, Bit32s vib1, op_type* op_pt2, Bit32s vib2, op_type* op_pt3, Bit32s vib3);
+
+	// render a block of samples of one operator, or of one with feedback and the next
+	Bits operator_envelope(op_type* op_pt, const Bit32s* vib, Bit32u* wfpos, fltype* amps, Bits n);
+	void operator_block(op_type* op_pt, const Bit32s* vib, const Bit32s* trem, const Bit32s* mod, Bit32s* out, Bits n);
+	void operator_block_fb(op_type* op1, const Bit32s* vib1, const Bit32s* trem1, Bit32s* out1,
+						   op_type* op2, const Bit32s* vib2, const Bit32s* trem2, bool modulated, Bit32s* out2, Bits n);
+	void envelope_sustain(op_type* op_pt, Bits n);
+	void fbpair_prepare(fbpair_type* p, op_type* op1, const Bit32s* vib1, const Bit32s* trem1,
+						op_type* op2, const Bit32s* vib2, const Bit32s* trem2, bool modulated, Bits n);
+	void fbpair_render(fbpair_type* p1, fbpair_type* p2, Bits n);
+
+	// render a block of samples of all channels, mixed or, if 'stems' is
+	// given, every channel into its own left and right BLOCKBUF_SIZE samples
+	void render_block(Bit32s* outbufl, Bit32s* outbufr, Bits endsamples, Bit32s** stems = 0);
+
 
 	// enable an operator
 	void enable_operator(Bitu regbase, op_type* op_pt, Bit32u act_type);
@@ -205,11 +264,17 @@ public:
 	void adlib_init(Bit32u samplerate, Bit32u numchannels, Bit32u bytespersample);
 	void adlib_write(Bitu idx, Bit8u val);
 	void adlib_getsample(Bit16s* sndptr, Bits numsamples);
+	void adlib_getsample32(Bit32s* sndptr, Bits numsamples);	// 16-bit scale, not clipped
+	void adlib_getstems(Bit32s** bufs, Bits numsamples);	// every channel to its own buffer
+	void adlib_setmute(Bit32u mask);	// channels in 'mask' are not calculated
+	Bitu adlib_setsimd(Bitu level);	// returns the level actually in use
 
 	Bitu adlib_reg_read(Bitu port);
 	void adlib_write_index(Bitu port, Bit8u val);
-};
 
-static Bit32u generator_add;	// should be a chip parameter
+private:
+	// set up the tables shared by all chips
+	static void init_tables();
+};
 
 #endif
@@ -37,6 +37,7 @@ CxadPlayer::~CxadPlayer()
 
 bool CxadPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   bool ret = false;
 
@@ -130,6 +131,16 @@ unsigned int CxadPlayer::getinstruments()
 
 /* -------- Protected Methods ------------------------------- */
 
+int CxadPlayer::probe_fmt(const unsigned char *header, unsigned long size,
+			  unsigned short fmt)
+{
+  // 'XAD!', title and author, then the format
+  if(!probe_id(header, size, 0, "XAD!", 4) || size < 78)
+    return PROBE_NO;
+
+  return (header[76] | (header[77] << 8)) == fmt ? PROBE_YES : PROBE_NO;
+}
+
 void CxadPlayer::opl_write(int reg, int val)
 {
   adlib[reg] = val;
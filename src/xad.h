@@ -44,6 +44,10 @@ public:
         unsigned int    getinstruments();
 
 protected:
+	// probe() of the subplayers: an XAD header with format 'fmt'
+	static int probe_fmt(const unsigned char *header, unsigned long size,
+			     unsigned short fmt);
+
 	virtual void xadplayer_rewind(int subsong) = 0;
 	virtual bool xadplayer_load() = 0;
 	virtual void xadplayer_update() = 0;
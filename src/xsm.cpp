@@ -35,6 +35,7 @@ CxsmPlayer::~CxsmPlayer()
 
 bool CxsmPlayer::load(const std::string &filename, const CFileProvider &fp)
 {
+  clear_caches();
   binistream *f = fp.open(filename); if(!f) return false;
   char			id[6];
   int			i, j;
@@ -25,6 +25,8 @@ class CxsmPlayer: public CPlayer
 {
 public:
   static CPlayer *factory(Copl *newopl) { return new CxsmPlayer(newopl); }
+  static int probe(const unsigned char *header, unsigned long size)
+  { return probe_id(header, size, 0, "ofTAZ!", 6) ? PROBE_YES : PROBE_NO; }
 
   CxsmPlayer(Copl *newopl);
   ~CxsmPlayer();
@@ -0,0 +1,396 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * dbtest.cpp - Test the database and its file formats
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <binfile.h>
+#include <string>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../src/database.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define RECORDS		1000	// Records in the test database
+#define MANY		200000	// Records in the large test database
+#define NUM_THREADS	8	// Threads sharing one database
+#define DBFILE		"dbtest.db.test"
+#define IDXFILE		"dbtest.idx.test"
+
+/***** Local variables *****/
+
+// Files to make keys of, with the keys that databases hold for them
+static const struct {
+  const char		*filename;
+  unsigned short	crc16;
+  unsigned long		crc32;
+} keylist[] = {
+  { "MARIO.A2M", 0x421a, 0x15642ce4 },
+  { "WONDERIN.WLF", 0x36d3, 0xe53ea09c },
+  { "inc.raw", 0x8431, 0x5ade43ed },
+  { "SONG1.ins", 0xbb51, 0xaf9d21aa },
+  { NULL }
+};
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Local functions *****/
+
+static CAdPlugDatabase::CKey make_key(unsigned long i)
+/* Returns the made up key of record 'i' */
+{
+  CAdPlugDatabase::CKey key;
+
+  key.crc32 = (i * 2654435761UL) & 0xffffffff;
+  key.crc16 = (i * 40503) & 0xffff;
+  return key;
+}
+
+static void fill(CAdPlugDatabase &db, unsigned long first = 0, unsigned long step = 1)
+/* Inserts every 'step'th of RECORDS records of every type */
+{
+  for(unsigned long i = first; i < RECORDS; i += step) {
+    CAdPlugDatabase::CRecord *rec =
+      CAdPlugDatabase::CRecord::factory((CAdPlugDatabase::CRecord::RecordType)(i % 3));
+    char name[32];
+
+    sprintf(name, "record %lu", i);
+    rec->key = make_key(i);
+    rec->filetype = "Test";
+    rec->comment = name;
+    if(rec->type == CAdPlugDatabase::CRecord::SongInfo) {
+      ((CInfoRecord *)rec)->title = name;
+      ((CInfoRecord *)rec)->author = "dbtest";
+    } else if(rec->type == CAdPlugDatabase::CRecord::ClockSpeed)
+      ((CClockRecord *)rec)->clock = 100.0f + i;
+    db.insert(rec);
+  }
+}
+
+static bool check(const CAdPlugDatabase &db, const char *what)
+/* Searches every record and a missing key and checks what is found */
+{
+  for(unsigned long i = 0; i < RECORDS; i++) {
+    CAdPlugDatabase::CRecord *rec = db.search(make_key(i));
+    char name[32];
+    bool ok;
+
+    sprintf(name, "record %lu", i);
+    ok = rec && rec->type == (CAdPlugDatabase::CRecord::RecordType)(i % 3) &&
+      rec->filetype == "Test" && rec->comment == name;
+    if(ok && rec->type == CAdPlugDatabase::CRecord::SongInfo)
+      ok = ((CInfoRecord *)rec)->title == name &&
+	((CInfoRecord *)rec)->author == "dbtest";
+    if(ok && rec->type == CAdPlugDatabase::CRecord::ClockSpeed)
+      ok = ((CClockRecord *)rec)->clock == 100.0f + i;
+
+    if(!ok) {
+      std::cout << what << ": record " << i << (rec ? " differs" : " missing")
+		<< std::endl;
+      return false;
+    }
+  }
+
+  if(db.search(make_key(RECORDS))) {
+    std::cout << what << ": found a missing key" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static bool check_many()
+  /*
+   * Fills a database past the size of the old fixed table, wipes every
+   * third record and checks lookups, iteration and inserting again.
+   */
+{
+  CAdPlugDatabase	db;
+  unsigned long		i, n = 0;
+
+  for(i = 0; i < MANY; i++) {
+    CAdPlugDatabase::CRecord *rec =
+      CAdPlugDatabase::CRecord::factory(CAdPlugDatabase::CRecord::Plain);
+
+    rec->key = make_key(i);
+    if(!db.insert(rec)) {
+      std::cout << "many: record " << i << " not inserted" << std::endl;
+      delete rec;
+      return false;
+    }
+  }
+
+  for(i = 0; i < MANY; i += 3)
+    db.wipe(db.search(make_key(i)));
+
+  for(i = 0; i < MANY; i++)
+    if(db.lookup(make_key(i)) != (i % 3 != 0)) {
+      std::cout << "many: record " << i << (i % 3 ? " missing" : " not wiped")
+		<< std::endl;
+      return false;
+    }
+
+  db.goto_begin();
+  do
+    if(db.get_record()) n++;
+  while(db.go_forward());
+  if(n != MANY - (MANY + 2) / 3) {
+    std::cout << "many: iterated over " << n << " records" << std::endl;
+    return false;
+  }
+
+  for(i = 0; i < MANY; i += 3) {
+    CAdPlugDatabase::CRecord *rec =
+      CAdPlugDatabase::CRecord::factory(CAdPlugDatabase::CRecord::Plain);
+
+    rec->key = make_key(i);
+    if(!db.insert(rec)) {
+      std::cout << "many: wiped record " << i << " not inserted again" << std::endl;
+      delete rec;
+      return false;
+    }
+  }
+
+  for(i = 0; i < MANY; i++)
+    if(!db.lookup(make_key(i))) {
+      std::cout << "many: record " << i << " missing at last" << std::endl;
+      return false;
+    }
+
+  return true;
+}
+
+static void search_all(const CAdPlugDatabase *db, bool *ok)
+/* Thread searching and walking a shared database */
+{
+  CAdPlugDatabase::CIterator	it(*db);
+  unsigned long			n = 0;
+
+  *ok = check(*db, "shared");
+
+  do
+    if(it.get_record()) n++;
+  while(it.go_forward());
+  if(n != RECORDS / 2) {
+    std::cout << "shared: iterated over " << n << " records" << std::endl;
+    *ok = false;
+  }
+}
+
+static bool check_shared()
+  /*
+   * Searches one database from several threads at once. Half of the
+   * records are in the database, the other half in a mapped index, so the
+   * threads race to make the same records from it.
+   */
+{
+  CAdPlugDatabase	even, db;
+  std::vector<std::thread> threads;
+  bool			ok[NUM_THREADS], retval = true;
+  int			i;
+
+  fill(even, 0, 2);
+  if(!even.save_index(IDXFILE) || !db.map(IDXFILE)) {
+    std::cout << "shared: error writing the index" << std::endl;
+    return false;
+  }
+  fill(db, 1, 2);
+
+  for(i = 0; i < NUM_THREADS; i++)
+    threads.push_back(std::thread(search_all, &db, &ok[i]));
+  for(i = 0; i < NUM_THREADS; i++) {
+    threads[i].join();
+    if(!ok[i]) retval = false;
+  }
+
+  remove(IDXFILE);
+  return retval;
+}
+
+static void bitwise_key(const unsigned char *data, unsigned long size,
+			unsigned short &crc16, unsigned long &crc32)
+  /*
+   * The key calculated bit by bit in 32 bits, including the byte that file
+   * streams return at their end.
+   */
+{
+  unsigned short	c16 = 0;
+  uint32_t		c32 = 0xffffffff;
+
+  for(unsigned long i = 0; i <= size; i++) {
+    unsigned char byte = i < size ? data[i] : 0xff;
+
+    for(int j = 0; j < 8; j++, byte >>= 1) {
+      c16 = (c16 ^ byte) & 1 ? (c16 >> 1) ^ 0xa001 : c16 >> 1;
+      c32 = (c32 ^ byte) & 1 ? (c32 >> 1) ^ 0xedb88320 : c32 >> 1;
+    }
+  }
+
+  crc16 = c16; crc32 = ~c32;
+}
+
+static bool check_keys()
+  /*
+   * Keys of files and of buffers of every length up to some blocks of
+   * eight bytes have to match those calculated bit by bit.
+   */
+{
+  unsigned char		buf[256];
+  unsigned short	crc16;
+  unsigned long		crc32, i;
+  bool			ok = true;
+
+  for(i = 0; i < sizeof(buf); i++)
+    buf[i] = (unsigned char)(i * 181 + 7);
+
+  for(i = 0; i <= 40; i++) {
+    CAdPlugDatabase::CKey key(buf + 3, i);
+
+    bitwise_key(buf + 3, i, crc16, crc32);
+    if(key.crc16 != crc16 || key.crc32 != crc32) {
+      std::cout << "keys: wrong key of " << i << " bytes" << std::endl;
+      ok = false;
+    }
+  }
+
+  for(i = 0; keylist[i].filename; i++) {
+    std::string	fn = std::string(srcdir) + DIR_DELIM + keylist[i].filename;
+    FILE	*f = fopen(fn.c_str(), "rb");
+    std::string	data;
+    int		c;
+
+    if(!f) {
+      std::cout << "keys: error opening " << fn << std::endl;
+      ok = false;
+      continue;
+    }
+    while((c = fgetc(f)) != EOF) data += (char)c;
+    fclose(f);
+
+    binifstream		in(fn);
+    CAdPlugDatabase::CKey	streamkey(in);
+    CAdPlugDatabase::CKey	memkey(data.data(), data.size());
+
+    bitwise_key((const unsigned char *)data.data(), data.size(), crc16, crc32);
+    if(crc16 != keylist[i].crc16 || crc32 != keylist[i].crc32 ||
+       streamkey.crc16 != crc16 || streamkey.crc32 != crc32 ||
+       memkey.crc16 != crc16 || memkey.crc32 != crc32) {
+      std::cout << "keys: wrong key of " << keylist[i].filename << std::endl;
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  CAdPlugDatabase	db;
+  bool			retval = true;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  fill(db);
+  if(!check(db, "inserted") || !db.save(DBFILE) || !db.save_index(IDXFILE)) {
+    std::cout << "Error saving the database" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The index is searched in place
+  CAdPlugDatabase mapped;
+  if(!mapped.map(IDXFILE) || !check(mapped, "mapped"))
+    retval = false;
+
+  // Both formats can be loaded and mapping the 1.0 format loads it
+  CAdPlugDatabase loaded, loadedidx, mappeddb;
+  if(!loaded.load(DBFILE) || !check(loaded, "loaded") ||
+     !loadedidx.load(IDXFILE) || !check(loadedidx, "loaded index") ||
+     !mappeddb.map(DBFILE) || !check(mappeddb, "mapped 1.0"))
+    retval = false;
+
+  // Records of the index are found by insert() as well
+  CAdPlugDatabase::CRecord *rec = CAdPlugDatabase::CRecord::factory(CAdPlugDatabase::CRecord::Plain);
+  CAdPlugDatabase remapped;
+  rec->key = make_key(RECORDS / 2);
+  if(!remapped.map(IDXFILE) || remapped.insert(rec)) {
+    std::cout << "Inserted a record that is in the index" << std::endl;
+    retval = false;
+  } else
+    delete rec;
+
+  // Records of the index are made once and stay wiped
+  CAdPlugDatabase wiped;
+  CAdPlugDatabase::CKey key = make_key(RECORDS / 3);
+  if(!wiped.map(IDXFILE)) retval = false;
+  else {
+    CAdPlugDatabase::CRecord *found = wiped.search(key);
+
+    if(!found || !wiped.lookup(key) || wiped.get_record() != found ||
+       wiped.search(key) != found) {
+      std::cout << "Index record made twice" << std::endl;
+      retval = false;
+    }
+    wiped.wipe(found);
+    if(wiped.search(key) || wiped.lookup(key)) {
+      std::cout << "Wiped index record found again" << std::endl;
+      retval = false;
+    }
+    rec = CAdPlugDatabase::CRecord::factory(CAdPlugDatabase::CRecord::Plain);
+    rec->key = key;
+    if(!wiped.insert(rec) || wiped.search(key) != rec) {
+      std::cout << "Wiped index record not inserted again" << std::endl;
+      retval = false;
+    }
+  }
+
+  // A truncated index is refused
+  FILE *f = fopen(IDXFILE, "r+b");
+  if(f) {
+    fseek(f, 40, SEEK_SET);
+    fputc(0xff, f); fputc(0xff, f); fputc(0xff, f);
+    fclose(f);
+  }
+  CAdPlugDatabase broken;
+  if(broken.map(IDXFILE)) {
+    std::cout << "Mapped a broken index" << std::endl;
+    retval = false;
+  }
+
+  remove(DBFILE);
+  remove(IDXFILE);
+
+  if(!check_many() || !check_shared() || !check_keys())
+    retval = false;
+
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,276 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * emubench.cpp - Benchmark every OPL emulator with recorded register writes
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "../src/adplug.h"
+#include "../src/emuopl.h"
+#include "../src/temuopl.h"
+#include "../src/kemuopl.h"
+#include "../src/wemuopl.h"
+#include "../src/surroundopl.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define DEFAULT_SECONDS	5	// Recorded from every song
+#define BUFSIZE		4096	// Largest update() call
+
+/***** Local types *****/
+
+struct Event {
+  enum { WRITE, INIT, TICK } type;
+  int	chip, reg, val;
+  float	refresh;	// ticks per second from this tick on
+};
+
+class CRecordopl: public Copl
+  /*
+   * Records the register writes of a player, with the tick boundaries
+   * between them, so they can be replayed without the player.
+   */
+{
+public:
+  CRecordopl(std::vector<Event> &newevents) : events(newevents) {}
+
+  void write(int reg, int val)
+    {
+      Event e = { Event::WRITE, currChip, reg, val, 0.0f };
+      events.push_back(e);
+    }
+
+  void init()
+    {
+      Event e = { Event::INIT, 0, 0, 0, 0.0f };
+      events.push_back(e);
+    }
+
+  void tick(float refresh)
+    {
+      Event e = { Event::TICK, 0, 0, 0, refresh };
+      events.push_back(e);
+    }
+
+private:
+  std::vector<Event>	&events;
+};
+
+enum Backend {
+  BE_EMU, BE_EMU_OPL3, BE_TEMU, BE_KEMU, BE_WEMU, BE_SURROUND, BE_COUNT
+};
+
+enum Depth { DEPTH_8, DEPTH_16, DEPTH_32, DEPTH_FLOAT, DEPTH_COUNT };
+
+/***** Local variables *****/
+
+// Songs to record
+static const char *filelist[] = {
+  "ALLOYRUN.RAD", "MARIO.A2M", "michaeld.cmf", "samurai.dro", "VIB_VOL3.D00",
+  "DEMO4.JBM", "HIP_D.ROL", "SMKEREM.HSC",
+  NULL
+};
+
+static const char *backend_names[BE_COUNT] = {
+  "CEmuopl", "CEmuopl-OPL3", "CTemuopl", "CKemuopl", "CWemuopl", "CSurroundopl"
+};
+
+static const char *depth_names[DEPTH_COUNT] = { "8", "16", "32", "float" };
+
+static const int rates[] = { 22050, 44100, 49716, 0 };
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Local functions *****/
+
+static unsigned long record(std::vector<Event> &events, unsigned int seconds)
+/* Records the first seconds of every song and returns the number of songs */
+{
+  CRecordopl	rec(events);
+  unsigned long	songs = 0;
+
+  for(int i = 0; filelist[i] != NULL; i++) {
+    std::string fn = std::string(srcdir) + DIR_DELIM + filelist[i];
+    CPlayer *p = CAdPlug::factory(fn, &rec);
+    double time = 0.0;
+
+    if(!p) {
+      fprintf(stderr, "emubench: error loading %s\n", fn.c_str());
+      continue;
+    }
+
+    // Songs that end early are repeated to the same length
+    while(time < seconds) {
+      p->update();
+      rec.tick(p->getrefresh());
+      time += 1.0 / p->getrefresh();
+    }
+
+    delete p;
+    songs++;
+  }
+
+  return songs;
+}
+
+static Copl *create(int backend, int rate, bool bit16, bool stereo)
+{
+  CEmuopl *emu;
+
+  switch(backend) {
+  case BE_EMU_OPL3:
+    emu = new CEmuopl(rate, bit16, stereo);
+    emu->settype(Copl::TYPE_OPL3);
+    return emu;
+  case BE_TEMU: return new CTemuopl(rate, bit16, stereo);
+  case BE_KEMU: return new CKemuopl(rate, bit16, stereo);
+  case BE_WEMU: return new CWemuopl(rate, bit16, stereo);
+  case BE_SURROUND:
+    // Two mono emulators, one for each side
+    return new CSurroundopl(new CTemuopl(rate, bit16, false),
+			    new CTemuopl(rate, bit16, false), bit16);
+  default: return new CEmuopl(rate, bit16, stereo);
+  }
+}
+
+static double replay(const std::vector<Event> &events, int backend, int rate,
+		     bool stereo, int depth, unsigned long &frames)
+/*
+ * Replays the recorded writes to a new emulator, rendering every tick's
+ * frames right after its writes. Returns the seconds this took.
+ */
+{
+  Copl		*opl = create(backend, rate, depth != DEPTH_8, stereo);
+  int32_t	*buf = new int32_t[BUFSIZE * 2];
+  double	fraction = 0.0;
+  unsigned long	n, i;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  frames = 0;
+  opl->init();
+  for(i = 0; i < events.size(); i++) {
+    const Event &e = events[i];
+
+    switch(e.type) {
+    case Event::WRITE: opl->setchip(e.chip); opl->write(e.reg, e.val); break;
+    case Event::INIT: opl->init(); break;
+    case Event::TICK:
+      fraction += rate / e.refresh;
+      for(n = (unsigned long)fraction, fraction -= n; n; ) {
+	int chunk = n < BUFSIZE ? (int)n : BUFSIZE;
+
+	switch(depth) {
+	case DEPTH_32: opl->update32(buf, chunk); break;
+	case DEPTH_FLOAT: opl->updatefloat((float *)buf, chunk); break;
+	default: opl->update((short *)buf, chunk); break;
+	}
+	n -= chunk;
+	frames += chunk;
+      }
+      break;
+    }
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  delete [] buf;
+  delete opl;
+  return elapsed;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  std::vector<Event>	events;
+  unsigned int		seconds = DEFAULT_SECONDS, runs = 1, i;
+  bool			csv = false;
+  unsigned long		frames, songs;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  for(int a = 1; a < argc; a++)
+    if(!strcmp(argv[a], "-c"))		// machine readable output
+      csv = true;
+    else if(!strcmp(argv[a], "-t") && a + 1 < argc)	// seconds per song
+      seconds = atoi(argv[++a]);
+    else if(!strcmp(argv[a], "-r") && a + 1 < argc)	// runs, the best counts
+      runs = atoi(argv[++a]);
+    else {
+      fprintf(stderr, "Usage: %s [-c] [-t <seconds per song>] [-r <runs>]\n",
+	      argv[0]);
+      return EXIT_FAILURE;
+    }
+  if(!seconds) seconds = 1;
+  if(!runs) runs = 1;
+
+  songs = record(events, seconds);
+
+  if(csv)
+    printf("backend,rate,channels,bits,frames,seconds,ns_per_sample,"
+	   "samples_per_second,realtime\n");
+  else {
+    printf("%lu songs, %u s each, best of %u runs\n", songs, seconds, runs);
+    printf("%-12s %6s %3s %5s %10s %12s %10s\n", "backend", "rate", "ch",
+	   "bits", "ns/sample", "samples/s", "realtime");
+  }
+
+  for(int backend = 0; backend < BE_COUNT; backend++)
+    for(int r = 0; rates[r]; r++)
+      for(int stereo = 0; stereo < 2; stereo++)
+	for(int depth = 0; depth < DEPTH_COUNT; depth++) {
+	  // The surround OPL always outputs 8 or 16-bit stereo
+	  if(backend == BE_SURROUND && (!stereo || depth > DEPTH_16))
+	    continue;
+
+	  double best = 0.0;
+	  for(i = 0; i < runs; i++) {
+	    double t = replay(events, backend, rates[r], stereo != 0, depth, frames);
+	    if(!i || t < best) best = t;
+	  }
+
+	  // Samples are counted per frame, whatever the number of channels
+	  double ns = best * 1e9 / frames;
+	  double persec = frames / best;
+	  double realtime = (double)frames / rates[r] / best;
+
+	  if(csv)
+	    printf("%s,%d,%d,%s,%lu,%.6f,%.2f,%.0f,%.2f\n", backend_names[backend],
+		   rates[r], stereo ? 2 : 1, depth_names[depth], frames, best,
+		   ns, persec, realtime);
+	  else
+	    printf("%-12s %6d %3d %5s %10.1f %12.0f %9.1fx\n",
+		   backend_names[backend], rates[r], stereo ? 2 : 1,
+		   depth_names[depth], ns, persec, realtime);
+	  fflush(stdout);
+	}
+
+  return EXIT_SUCCESS;
+}
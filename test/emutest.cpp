@@ -21,8 +21,23 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
+#include <iostream>
 
 #include "../src/emuopl.h"
+#include "../src/temuopl.h"
+#include "../src/kemuopl.h"
+#include "../src/wemuopl.h"
+
+// Emulators to check the output formats of
+enum {
+  EMU_OPL2, EMU_DUAL_OPL2, EMU_OPL3, EMU_TEMU, EMU_KEMU, EMU_WEMU, EMU_COUNT
+};
+
+static const char *emu_names[EMU_COUNT] = {
+  "CEmuopl OPL2", "CEmuopl dual OPL2", "CEmuopl OPL3", "CTemuopl", "CKemuopl",
+  "CWemuopl"
+};
 
 /***** Local variables *****/
 
@@ -70,6 +85,263 @@ static bool check_emu_output(CEmuopl *emu)
   return (nonull && no10k && nom10k);
 }
 
+static void set_instrument(Copl *opl, int op)
+  /*
+   * Sets the test instrument on the two operators at offset 'op'.
+   */
+{
+  opl->write(0x20 + op, 1);
+  opl->write(0x40 + op, 0x10);
+  opl->write(0x60 + op, 0xf0);
+  opl->write(0x80 + op, 0x77);
+  opl->write(0x23 + op, 1);
+  opl->write(0x43 + op, 0);
+  opl->write(0x63 + op, 0xf0);
+  opl->write(0x83 + op, 0x77);
+}
+
+static void get_levels(CEmuopl *emu, int &left, int &right)
+  /*
+   * Renders stereo and returns the peak level of both sides.
+   */
+{
+  short	*buf = (short *)calloc(BUF_SIZE * 2, sizeof(short));
+
+  emu->update(buf, BUF_SIZE);
+  left = right = 0;
+  for(int i = 0; i < BUF_SIZE; i++) {
+    if(abs(buf[i * 2]) > left) left = abs(buf[i * 2]);
+    if(abs(buf[i * 2 + 1]) > right) right = abs(buf[i * 2 + 1]);
+  }
+
+  free(buf);
+}
+
+static bool check_emu_opl3(CEmuopl *emu)
+  /*
+   * Test the OPL3 register banks, 4-op channels and stereo panning.
+   */
+{
+  int	left, right;
+  bool	ok = true;
+
+  emu->settype(Copl::TYPE_OPL3);
+  emu->init();
+  emu->setchip(1);
+  emu->write(5, 1);		// OPL3 mode
+  emu->write(4, 1);		// channels 0 and 3 make a 4-op channel
+
+  // 4-op channel 0 on the left
+  emu->setchip(0);
+  set_instrument(emu, 0);
+  set_instrument(emu, 8);
+  emu->write(0xc0, 0x10);
+  emu->write(0xc3, 0x01);
+  emu->write(0xa0, 0x98);
+  emu->write(0xb0, 0x31);
+  get_levels(emu, left, right);
+  if(!left || right) {
+    std::cout << "OPL3: 4-op channel not on the left only" << std::endl;
+    ok = false;
+  }
+
+  // channel 9 (the first one of bank 1) on the right
+  emu->write(0xb0, 0x11);
+  emu->setchip(1);
+  set_instrument(emu, 0);
+  emu->write(0xc0, 0x20);
+  emu->write(0xa0, 0x98);
+  emu->write(0xb0, 0x31);
+  get_levels(emu, left, right);
+  if(!right) {
+    std::cout << "OPL3: bank 1 channel not on the right" << std::endl;
+    ok = false;
+  }
+
+  // without OPL3 mode, bank 0 plays on both sides and ignores panning
+  emu->init();
+  set_instrument(emu, 0);
+  emu->write(0xc0, 0x10);
+  emu->write(0xa0, 0x98);
+  emu->write(0xb0, 0x31);
+  get_levels(emu, left, right);
+  if(!left || left != right) {
+    std::cout << "OPL3: OPL2 mode not on both sides" << std::endl;
+    ok = false;
+  }
+
+  return ok;
+}
+
+static Copl *create_emu(int type, bool stereo)
+{
+  CEmuopl *emu;
+
+  switch(type) {
+  case EMU_TEMU: return new CTemuopl(8000, true, stereo);
+  case EMU_KEMU: return new CKemuopl(8000, true, stereo);
+  case EMU_WEMU: return new CWemuopl(8000, true, stereo);
+  }
+
+  emu = new CEmuopl(8000, true, stereo);
+  if(type == EMU_OPL2) emu->settype(Copl::TYPE_OPL2);
+  if(type == EMU_OPL3) emu->settype(Copl::TYPE_OPL3);
+  return emu;
+}
+
+static void play_chord(Copl *opl, int channels)
+  /*
+   * Keys on the test instrument on the first 'channels' channels of both
+   * chips, at different pitches.
+   */
+{
+  static const int op[9] = { 0, 1, 2, 8, 9, 10, 16, 17, 18 };
+
+  opl->init();
+  for(int chip = 0; chip < 2; chip++) {
+    opl->setchip(chip);
+    for(int i = 0; i < channels; i++) {
+      set_instrument(opl, op[i]);
+      opl->write(0xc0 + i, 0x30);
+      opl->write(0xa0 + i, 0x98 + i * 13 + chip * 5);
+      opl->write(0xb0 + i, 0x31);
+    }
+  }
+  opl->setchip(0);
+}
+
+static bool check_formats(int type, bool stereo, int channels)
+  /*
+   * update32() and updatefloat() have to give the same samples as update()
+   * where these aren't clipped, apart from the fraction in the floats. Returns false on a mismatch and with many
+   * 'channels', if the 32-bit output doesn't exceed the 16-bit range.
+   */
+{
+  int		n = stereo ? BUF_SIZE * 2 : BUF_SIZE, i;
+  short		*buf16 = (short *)calloc(n, sizeof(short));
+  int32_t	*buf32 = (int32_t *)calloc(n, sizeof(int32_t));
+  float		*buff = (float *)calloc(n, sizeof(float));
+  Copl		*opl[3];
+  bool		ok = true, beyond = false;
+
+  for(i = 0; i < 3; i++) {
+    opl[i] = create_emu(type, stereo);
+    play_chord(opl[i], channels);
+  }
+  opl[0]->update(buf16, BUF_SIZE);
+  opl[1]->update32(buf32, BUF_SIZE);
+  opl[2]->updatefloat(buff, BUF_SIZE);
+
+  for(i = 0; i < n && ok; i++) {
+    if(buf32[i] > 32767 || buf32[i] < -32768)
+      beyond = true;
+    else if(buf32[i] != buf16[i])
+      ok = false;
+    if(fabs(buff[i] * 32768.0f - buf32[i]) >= 1.0f)	// Ken's is not truncated
+      ok = false;
+  }
+  if(!ok)
+    std::cout << emu_names[type] << (stereo ? " stereo" : " mono")
+	      << ": sample " << i - 1 << " differs between formats" << std::endl;
+  else if(channels == 9 && !beyond) {
+    std::cout << emu_names[type] << ": 32-bit output is clipped" << std::endl;
+    ok = false;
+  }
+
+  for(i = 0; i < 3; i++) delete opl[i];
+  free(buf16); free(buf32); free(buff);
+  return ok;
+}
+
+static void play_song(Copl *opl, int type, bool rhythm)
+  /*
+   * Plays a full chord, on both register banks in OPL3 mode, or a chord
+   * on the melodic channels and all drums.
+   */
+{
+  play_chord(opl, rhythm ? 6 : 9);
+  if(type == EMU_OPL3) {
+    opl->setchip(1);
+    opl->write(5, 1);
+    opl->setchip(0);
+  }
+  if(rhythm) {
+    for(int i = 0; i < 3; i++) {
+      set_instrument(opl, 16 + i);
+      opl->write(0xc6 + i, 0x30);
+      opl->write(0xa6 + i, 0x98 + i * 13);
+      opl->write(0xb6 + i, 0x11);
+    }
+    opl->write(0xbd, 0x3f);
+  }
+}
+
+static bool check_stems(int type, bool stereo, bool rhythm, uint32_t mute)
+  /*
+   * Renders a song mixed and as stems, with the channels in 'mute' muted.
+   * The other stems have to add up to the mix, within the rounding of every
+   * channel. Stems of silent and muted channels have to be silent, and a
+   * stem that is rendered alone has to be the same as with all others.
+   */
+{
+  int		n = stereo ? BUF_SIZE * 2 : BUF_SIZE, i, c;
+  int32_t	*mix = (int32_t *)calloc(n, sizeof(int32_t));
+  int32_t	*stems[Copl::MAX_CHANNELS], *solo[Copl::MAX_CHANNELS];
+  bool		twochips = type == EMU_DUAL_OPL2 || type == EMU_OPL3;
+  uint32_t	played = twochips ? (rhythm ? 0x7fff : 0x3ffff) : 0x1ff;
+  int		alone = rhythm ? 7 : (twochips ? 17 : 8);
+  Copl		*opl[3];
+  bool		ok = true;
+
+  for(i = 0; i < 3; i++) {
+    opl[i] = create_emu(type, stereo);
+    play_song(opl[i], type, rhythm);
+  }
+  for(c = 0; c < Copl::MAX_CHANNELS; c++) {
+    stems[c] = (int32_t *)calloc(n, sizeof(int32_t));
+    solo[c] = c == alone ? (int32_t *)calloc(n, sizeof(int32_t)) : NULL;
+  }
+
+  if(!opl[0]->setmute(mute) || !opl[1]->setmute(mute) ||
+     !opl[2]->setmute(mute) || !opl[1]->updatestems(stems, BUF_SIZE) ||
+     !opl[2]->updatestems(solo, BUF_SIZE)) {
+    std::cout << emu_names[type] << ": no stems or muting" << std::endl;
+    ok = false;
+  } else {
+    opl[0]->update32(mix, BUF_SIZE);
+
+    for(i = 0; i < n && ok; i++) {
+      int32_t sum = 0;
+
+      for(c = 0; c < Copl::MAX_CHANNELS; c++)
+	if(!((mute >> c) & 1)) sum += stems[c][i];
+      if(abs(sum - mix[i]) > Copl::MAX_CHANNELS * 2 ||
+	 solo[alone][i] != stems[alone][i])
+	ok = false;
+    }
+    if(!ok)
+      std::cout << emu_names[type] << (stereo ? " stereo" : " mono")
+		<< ": stems differ from the mix at sample " << i - 1 << std::endl;
+
+    for(c = 0; c < Copl::MAX_CHANNELS; c++) {
+      bool silent = true;
+
+      for(i = 0; i < n; i++)
+	if(stems[c][i]) silent = false;
+      if(silent != !((played & ~mute) >> c & 1)) {
+	std::cout << emu_names[type] << ": channel " << c
+		  << (silent ? " is silent" : " is not silent") << std::endl;
+	ok = false;
+      }
+    }
+  }
+
+  for(i = 0; i < 3; i++) delete opl[i];
+  for(c = 0; c < Copl::MAX_CHANNELS; c++) { free(stems[c]); free(solo[c]); }
+  free(mix);
+  return ok;
+}
+
 /***** Main program *****/
 
 int main(int argc, char *argv[])
@@ -85,5 +357,28 @@ int main(int argc, char *argv[])
     retval = check_emu_output(&emu);
   }
 
+  {
+    CEmuopl emu(8000, true, true);
+    if(!check_emu_opl3(&emu))
+      retval = false;
+  }
+
+  for(int type = 0; type < EMU_COUNT; type++)
+    for(int stereo = 0; stereo < 2; stereo++)
+      if(!check_formats(type, stereo != 0, 2))
+	retval = false;
+
+  // Full chords exceed the 16-bit range, which the 32-bit output keeps
+  if(!check_formats(EMU_OPL2, false, 9) || !check_formats(EMU_WEMU, true, 9))
+    retval = false;
+
+  // All emulators but Ken's render stems and mute channels
+  for(int type = EMU_OPL2; type < EMU_COUNT; type++)
+    for(int stereo = 0; type != EMU_KEMU && stereo < 2; stereo++)
+      if(!check_stems(type, stereo != 0, false, 0) ||
+	 !check_stems(type, stereo != 0, false, 0x20411) ||
+	 !check_stems(type, stereo != 0, true, 0x80))
+	retval = false;
+
   return retval ? EXIT_SUCCESS : EXIT_FAILURE;
 }
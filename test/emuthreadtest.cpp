@@ -0,0 +1,238 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * emuthreadtest.cpp - Test AdPlug emulators for concurrent rendering
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "../src/adplug.h"
+#include "../src/emuopl.h"
+#include "../src/temuopl.h"
+#include "../src/kemuopl.h"
+#include "../src/wemuopl.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define RATE		22050	// Output sample rate
+#define MAX_TICKS	1500	// Maximum number of player ticks recorded per file
+#define NUM_THREADS	8	// Concurrently rendering threads
+#define ROUNDS		3	// Times each thread renders every job
+
+/***** Local variables *****/
+
+// Files to take register streams from. Some of them use rhythm mode.
+static const char *filelist[] = {
+  "DEMO4.JBM",
+  "MARIO.A2M",
+  "SMKEREM.HSC",
+  "ALLOYRUN.RAD",
+  "HIP_D.ROL",
+  "samurai.dro",
+  NULL
+};
+
+// Emulators under test
+static const char *emuname[] = { "CEmuopl", "CTemuopl", "CKemuopl", "CWemuopl",
+				  NULL };
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Recorded register streams *****/
+
+struct Write { int chip, reg, val; };
+
+struct Tick {
+  std::vector<Write>	writes;		// register writes before rendering
+  int			samples;	// samples to render afterwards
+};
+
+typedef std::vector<Tick> Stream;
+
+class Recordopl: public Copl
+{
+public:
+  Recordopl(Stream &s)
+    : stream(s)
+  {
+    currType = TYPE_DUAL_OPL2;
+    stream.push_back(Tick());
+  }
+
+  void write(int reg, int val)
+  {
+    Write w = { currChip, reg, val };
+    stream.back().writes.push_back(w);
+  }
+
+  void init() {}
+
+private:
+  Stream	&stream;
+};
+
+struct Job {
+  const char		*name;
+  int			emu;		// index into emuname[]
+  const Stream		*stream;
+  std::vector<short>	ref;		// single-threaded output
+};
+
+/***** Local functions *****/
+
+static bool record(const char *filename, Stream &stream)
+  /*
+   * Plays 'filename' through a recording OPL and stores its register writes,
+   * split up by player ticks, in 'stream'.
+   */
+{
+  std::string	fn = std::string(srcdir) + DIR_DELIM + filename;
+  Recordopl	opl(stream);
+  CPlayer	*p = CAdPlug::factory(fn, &opl);
+  double	left = 0.0;
+
+  if(!p) {
+    std::cout << "Error loading: " << fn << std::endl;
+    return false;
+  }
+
+  for(int i = 0; i < MAX_TICKS && p->update(); i++) {
+    left += RATE / p->getrefresh();
+    stream.back().samples = (int)left;
+    left -= stream.back().samples;
+    stream.push_back(Tick());
+  }
+
+  stream.back().samples = 0;
+  delete p;
+  return true;
+}
+
+static void render(const Job &job, std::vector<short> &out)
+  /*
+   * Replays the register stream of 'job' through a fresh emulator instance.
+   */
+{
+  Copl			*opl;
+  int			channels;
+  std::vector<short>	buf;
+
+  switch(job.emu) {
+  case 0: opl = new CEmuopl(RATE, true, true); channels = 2; break;
+  case 1: opl = new CTemuopl(RATE, true, false); channels = 1; break;
+  case 2: opl = new CKemuopl(RATE, true, true); channels = 2; break;
+  default: opl = new CWemuopl(RATE, true, true); channels = 2; break;
+  }
+
+  out.clear();
+  for(Stream::const_iterator t = job.stream->begin(); t != job.stream->end(); t++) {
+    for(std::vector<Write>::const_iterator w = t->writes.begin();
+	w != t->writes.end(); w++) {
+      opl->setchip(w->chip);
+      opl->write(w->reg, w->val);
+    }
+
+    if(!t->samples) continue;
+    buf.resize(t->samples * channels);
+    opl->update(&buf[0], t->samples);
+    out.insert(out.end(), buf.begin(), buf.end());
+  }
+
+  delete opl;
+}
+
+static void worker(std::vector<Job> *jobs, int id, bool *ok)
+  /*
+   * Renders all jobs ROUNDS times, starting at a different job in every
+   * thread, and compares against the single-threaded output.
+   */
+{
+  std::vector<short>	out;
+  size_t		n = jobs->size();
+
+  *ok = true;
+  for(size_t i = 0; i < n * ROUNDS; i++) {
+    const Job &job = (*jobs)[(i + id) % n];
+
+    render(job, out);
+    if(out != job.ref) {
+      std::cout << "Thread " << id << ": output of " << job.name << " on "
+		<< emuname[job.emu] << " differs\n";
+      *ok = false;
+    }
+  }
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  std::vector<Stream>	streams;
+  std::vector<Job>	jobs;
+  std::thread		*threads[NUM_THREADS];
+  bool			ok[NUM_THREADS];
+  bool			retval = true;
+  int			i;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  // Record register streams. Players are only run from this thread.
+  for(i = 0; filelist[i] != NULL; i++) ;
+  streams.resize(i);
+  for(i = 0; filelist[i] != NULL; i++)
+    if(!record(filelist[i], streams[i]))
+      return EXIT_FAILURE;
+
+  // Render reference output single-threaded
+  for(i = 0; filelist[i] != NULL; i++)
+    for(int emu = 0; emuname[emu] != NULL; emu++) {
+      Job job;
+
+      job.name = filelist[i];
+      job.emu = emu;
+      job.stream = &streams[i];
+      render(job, job.ref);
+      jobs.push_back(job);
+    }
+
+  // Render everything again on all threads at once
+  for(i = 0; i < NUM_THREADS; i++)
+    threads[i] = new std::thread(worker, &jobs, i, &ok[i]);
+
+  for(i = 0; i < NUM_THREADS; i++) {
+    threads[i]->join();
+    delete threads[i];
+    if(!ok[i]) retval = false;
+  }
+
+  std::cout << "Rendered " << jobs.size() << " jobs on " << NUM_THREADS
+	    << " threads: " << (retval ? "OK" : "FAIL") << std::endl;
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
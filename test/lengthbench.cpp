@@ -0,0 +1,107 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * lengthbench.cpp - Benchmark songlength() against a plain replay
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+#include "../src/adplug.h"
+#include "../src/silentopl.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define RUNS	20	// Measurements per file, on a fresh player each
+
+/***** Local variables *****/
+
+// Files to measure, one per player
+static const char *filelist[] = {
+  "SONG1.sng", "2001.MKJ", "ADAGIO.DFM", "adlibsp.s3m", "ALLOYRUN.RAD",
+  "ARAB.BAM", "BEGIN.KSM", "BOOTUP.M", "CHILD1.XSM", "DTM-TRK1.DTM",
+  "fdance03.dmo", "ice_thnk.sci", "inc.raw", "loudness.lds", "MARIO.A2M",
+  "mi2.laa", "michaeld.cmf", "PLAYMUS1.SNG", "rat.xad", "REVELAT.SNG",
+  "SAILOR.CFF", "samurai.dro", "SCALES.SA2", "SMKEREM.HSC", "TOCCATA.MAD",
+  "TUBES.SAT", "TU_BLESS.AMD", "VIB_VOL3.D00", "WONDERIN.WLF",
+  "bmf1_2.xad", "flash.xad", "HIP_D.ROL", "hybrid.xad", "hyp.xad",
+  "psi1.xad", "SATNIGHT.HSP", "blaster2.msc", "RI051.RIX", "EOBSOUND.ADL",
+  "DUNE19.ADL", "LOREINTR.ADL", "DEMO4.JBM", "dro_v2.dro",
+  NULL
+};
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  CSilentopl	opl;
+  CPlayer	*p;
+  clock_t	start, replay, length, total_replay = 0, total_length = 0;
+  unsigned long	ms = 0;
+  bool		ok;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  printf("%-16s %10s %12s %12s\n", "file", "length/ms", "replay/us",
+	 "songlength/us");
+  for(int i = 0; filelist[i] != NULL; i++) {
+    std::string fn = std::string(srcdir) + DIR_DELIM + filelist[i];
+
+    // Replay with all OPL output, which is what songlength() used to do
+    replay = length = 0; ok = true;
+    for(int run = 0; run < RUNS; run++) {
+      if(!(p = CAdPlug::factory(fn, &opl))) { ok = false; break; }
+      start = clock();
+      while(p->update()) ;
+      replay += clock() - start;
+      delete p;
+
+      if(!(p = CAdPlug::factory(fn, &opl))) { ok = false; break; }
+      start = clock();
+      ms = p->songlength();
+      length += clock() - start;
+      delete p;
+    }
+
+    if(!ok) {
+      printf("%-16s %10s\n", filelist[i], "error");
+      continue;
+    }
+
+    printf("%-16s %10lu %12.0f %12.0f\n", filelist[i], ms,
+	   replay * 1000000.0 / CLOCKS_PER_SEC / RUNS,
+	   length * 1000000.0 / CLOCKS_PER_SEC / RUNS);
+    total_replay += replay; total_length += length;
+  }
+
+  printf("%-16s %10s %12.0f %12.0f\n", "total", "",
+	 total_replay * 1000000.0 / CLOCKS_PER_SEC / RUNS,
+	 total_length * 1000000.0 / CLOCKS_PER_SEC / RUNS);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,312 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * pcmtest.cpp - Test the emulators' audio output against golden hashes
+ *
+ * Without options, every song is rendered through every emulator and the
+ * hash of the 16-bit output compared with the one in pcmtest.sum. To find
+ * where the output of a change starts to differ, write dumps with a good
+ * build using -w <dir> and compare the new build's output with them using
+ * -d <dir>. This reports the first sample frame, channel and player tick
+ * that differs by more than the budget given with -e (default 0, in 16-bit
+ * units). -f selects the 16, 32 or float output for the dumps. -g prints
+ * a new pcmtest.sum after output changes that are intended.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <map>
+#include <iostream>
+
+#include "../src/adplug.h"
+#include "../src/emuopl.h"
+#include "../src/temuopl.h"
+#include "../src/kemuopl.h"
+#include "../src/wemuopl.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define RATE		44100	// Output sample rate
+#define SECONDS		3	// Rendered from every song
+#define MAXTICK		16384	// Most sample frames of one tick
+#define SUMFILE		"pcmtest.sum"
+
+/***** Local types *****/
+
+enum Emulator {
+  EMU_OPL2, EMU_OPL3, EMU_TEMU, EMU_KEMU, EMU_WEMU, EMU_COUNT
+};
+
+enum Format { FORMAT_16, FORMAT_32, FORMAT_FLOAT };
+
+/***** Local variables *****/
+
+// Songs to render, those of playertest
+static const char *filelist[] = {
+  "SONG1.sng", "2001.MKJ", "ADAGIO.DFM", "adlibsp.s3m", "ALLOYRUN.RAD",
+  "ARAB.BAM", "BEGIN.KSM", "BOOTUP.M", "CHILD1.XSM", "DTM-TRK1.DTM",
+  "ice_thnk.sci", "inc.raw", "loudness.lds", "MARIO.A2M", "mi2.laa",
+  "michaeld.cmf", "PLAYMUS1.SNG", "rat.xad", "REVELAT.SNG", "SAILOR.CFF",
+  "samurai.dro", "SCALES.SA2", "SMKEREM.HSC", "TOCCATA.MAD", "TUBES.SAT",
+  "TU_BLESS.AMD", "VIB_VOL3.D00", "WONDERIN.WLF", "bmf1_2.xad", "flash.xad",
+  "HIP_D.ROL", "hybrid.xad", "hyp.xad", "psi1.xad", "SATNIGHT.HSP",
+  "blaster2.msc", "RI051.RIX", "EOBSOUND.ADL", "DUNE19.ADL", "DEMO4.JBM",
+  "dro_v2.dro",
+  NULL
+};
+
+static const char *emu_names[EMU_COUNT] = {
+  "CEmuopl", "CEmuopl-OPL3", "CTemuopl", "CKemuopl", "CWemuopl"
+};
+
+// Ken's emulator calculates in floating point, so its output depends on
+// the compiler and a different hash is only a warning.
+static const bool emu_strict[EMU_COUNT] = { true, true, true, false, true };
+
+static const size_t format_size[] = { sizeof(short), sizeof(int32_t), sizeof(float) };
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Local functions *****/
+
+static Copl *create(int emu)
+{
+  CEmuopl *opl;
+
+  switch(emu) {
+  case EMU_OPL3:
+    opl = new CEmuopl(RATE, true, true);
+    opl->settype(Copl::TYPE_OPL3);
+    return opl;
+  case EMU_TEMU: return new CTemuopl(RATE, true, true);
+  case EMU_KEMU: return new CKemuopl(RATE, true, true);
+  case EMU_WEMU: return new CWemuopl(RATE, true, true);
+  default: return new CEmuopl(RATE, true, true);
+  }
+}
+
+static uint64_t hash(uint64_t h, const short *buf, unsigned long n)
+/* FNV-1a over the little endian bytes of 'n' samples */
+{
+  for(unsigned long i = 0; i < n; i++) {
+    h = (h ^ (buf[i] & 0xff)) * 0x100000001b3ULL;
+    h = (h ^ ((buf[i] >> 8) & 0xff)) * 0x100000001b3ULL;
+  }
+
+  return h;
+}
+
+static double sample(const void *buf, int format, unsigned long i)
+/* Returns sample 'i' of 'buf' in 16-bit units */
+{
+  switch(format) {
+  case FORMAT_32: return ((const int32_t *)buf)[i];
+  case FORMAT_FLOAT: return ((const float *)buf)[i] * 32768.0;
+  default: return ((const short *)buf)[i];
+  }
+}
+
+static bool render(const char *file, int emu, int format, uint64_t &h,
+		   FILE *dump, bool compare, double budget)
+  /*
+   * Renders the first SECONDS of 'file' tick by tick and hashes the
+   * 16-bit output into 'h'. Other formats are only rendered for 'dump',
+   * which is written, or compared with if 'compare' is set. Returns false
+   * on the first difference over 'budget' or if the song doesn't load.
+   */
+{
+  std::string	fn = std::string(srcdir) + DIR_DELIM + file;
+  Copl		*opl = create(emu);
+  CPlayer	*p = CAdPlug::factory(fn, opl);
+  char		*buf = new char[MAXTICK * 2 * sizeof(int32_t)];
+  char		*ref = new char[MAXTICK * 2 * sizeof(int32_t)];
+  size_t	framesize = 2 * format_size[format];
+  unsigned long	frames = 0, tick, n, i;
+  double	fraction = 0.0;
+  bool		ok = true;
+
+  h = 0xcbf29ce484222325ULL;
+  if(!p) {
+    std::cout << file << ": error loading" << std::endl;
+    delete [] buf; delete [] ref; delete opl;
+    return false;
+  }
+
+  for(tick = 0; ok && frames < RATE * SECONDS; tick++) {
+    // Songs that end early keep on playing from their loop point
+    p->update();
+    fraction += RATE / p->getrefresh();
+    n = (unsigned long)fraction;
+    fraction -= n;
+    if(n > MAXTICK) n = MAXTICK;
+    if(n > RATE * SECONDS - frames) n = RATE * SECONDS - frames;
+
+    switch(format) {
+    case FORMAT_32: opl->update32((int32_t *)buf, n); break;
+    case FORMAT_FLOAT: opl->updatefloat((float *)buf, n); break;
+    default:
+      opl->update((short *)buf, n);
+      h = hash(h, (short *)buf, n * 2);
+      break;
+    }
+
+    if(dump && !compare)
+      fwrite(buf, framesize, n, dump);
+    else if(dump) {
+      if(fread(ref, framesize, n, dump) != n) {
+	std::cout << file << " " << emu_names[emu] << ": dump ends at frame "
+		  << frames << std::endl;
+	ok = false;
+	break;
+      }
+
+      for(i = 0; i < n * 2; i++) {
+	double a = sample(buf, format, i), b = sample(ref, format, i);
+
+	if(fabs(a - b) > budget) {
+	  std::cout << file << " " << emu_names[emu] << ": frame "
+		    << frames + i / 2 << " (tick " << tick << "), channel "
+		    << i % 2 << " is " << a << " instead of " << b << std::endl;
+	  ok = false;
+	  break;
+	}
+      }
+    }
+
+    frames += n;
+  }
+
+  delete p;
+  delete opl;
+  delete [] buf; delete [] ref;
+  return ok;
+}
+
+static bool read_sums(std::map<std::string, uint64_t> &sums)
+/* Reads the golden hashes, keyed by "<file> <emulator>" */
+{
+  std::string	fn = std::string(srcdir) + DIR_DELIM + SUMFILE;
+  FILE		*f = fopen(fn.c_str(), "r");
+  char		line[256], file[128], emu[64];
+  unsigned long long h;
+
+  if(!f) {
+    std::cout << "Error opening: " << fn << std::endl;
+    return false;
+  }
+
+  while(fgets(line, sizeof(line), f))
+    if(line[0] != '#' && sscanf(line, "%127s %63s %llx", file, emu, &h) == 3)
+      sums[std::string(file) + " " + emu] = h;
+
+  fclose(f);
+  return true;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  std::map<std::string, uint64_t> sums;
+  const char	*dumpdir = NULL;
+  bool		generate = false, compare = false, retval = true;
+  int		format = FORMAT_16, a;
+  double	budget = 0.0;
+  uint64_t	h;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  for(a = 1; a < argc && argv[a][0] == '-'; a++)
+    if(!strcmp(argv[a], "-g"))		// print new golden hashes
+      generate = true;
+    else if(!strcmp(argv[a], "-w") && a + 1 < argc)	// write dumps
+      dumpdir = argv[++a];
+    else if(!strcmp(argv[a], "-d") && a + 1 < argc) {	// compare with dumps
+      dumpdir = argv[++a];
+      compare = true;
+    } else if(!strcmp(argv[a], "-e") && a + 1 < argc)	// error budget
+      budget = atof(argv[++a]);
+    else if(!strcmp(argv[a], "-f") && a + 1 < argc) {	// dump format
+      a++;
+      if(!strcmp(argv[a], "32")) format = FORMAT_32;
+      else if(!strcmp(argv[a], "float")) format = FORMAT_FLOAT;
+      else format = FORMAT_16;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [-g] [-w <dir> | -d <dir>] "
+	"[-e <budget>] [-f 16|32|float] [files...]" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  // Files given after the options replace the list
+  const char **files = a < argc ? (const char **)argv + a : filelist;
+
+  if(generate)
+    printf("# Hashes of pcmtest's 16-bit stereo output at %d Hz, %d s per song\n",
+	   RATE, SECONDS);
+  else if(!dumpdir && !read_sums(sums))
+    return EXIT_FAILURE;
+
+  for(int i = 0; files[i] != NULL; i++)
+    for(int emu = 0; emu < EMU_COUNT; emu++) {
+      FILE *dump = NULL;
+
+      if(dumpdir) {
+	std::string fn = std::string(dumpdir) + DIR_DELIM + files[i] + "." +
+	  emu_names[emu] + ".pcm";
+
+	if(!(dump = fopen(fn.c_str(), compare ? "rb" : "wb"))) {
+	  std::cout << "Error opening: " << fn << std::endl;
+	  retval = false;
+	  continue;
+	}
+      }
+
+      if(!render(files[i], emu, dumpdir ? format : FORMAT_16, h, dump,
+		 compare, budget))
+	retval = false;
+      if(dump) fclose(dump);
+
+      if(generate)
+	printf("%s %s %016llx\n", files[i], emu_names[emu], (unsigned long long)h);
+      if(dumpdir || generate) continue;
+
+      std::map<std::string, uint64_t>::iterator s =
+	sums.find(std::string(files[i]) + " " + emu_names[emu]);
+      if(s == sums.end())
+	std::cout << files[i] << " " << emu_names[emu] << ": no hash in "
+		  << SUMFILE << std::endl;
+      else if(s->second != h)
+	std::cout << files[i] << " " << emu_names[emu] << ": output differs"
+		  << (emu_strict[emu] ? "" : " (warning only)") << std::endl;
+      else
+	continue;
+      if(s == sums.end() || emu_strict[emu]) retval = false;
+    }
+
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
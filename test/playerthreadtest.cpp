@@ -0,0 +1,206 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * playerthreadtest.cpp - Test many players replaying on threads at once
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include "../src/adplug.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define NUM_THREADS	8	// Concurrently replaying threads
+#define ROUNDS		2	// Times each thread replays every file
+
+/***** Local variables *****/
+
+// Files to replay, the same as in playertest
+static const char *filelist[] = {
+  "SONG1.sng", "2001.MKJ", "ADAGIO.DFM", "adlibsp.s3m", "ALLOYRUN.RAD",
+  "ARAB.BAM", "BEGIN.KSM", "BOOTUP.M", "CHILD1.XSM", "DTM-TRK1.DTM",
+  "ice_thnk.sci", "inc.raw", "loudness.lds", "MARIO.A2M", "mi2.laa",
+  "michaeld.cmf", "PLAYMUS1.SNG", "rat.xad", "REVELAT.SNG", "SAILOR.CFF",
+  "samurai.dro", "doofus.dro", "SCALES.SA2", "SMKEREM.HSC", "TOCCATA.MAD",
+  "TUBES.SAT", "TU_BLESS.AMD", "VIB_VOL3.D00", "WONDERIN.WLF", "bmf1_2.xad",
+  "flash.xad", "HIP_D.ROL", "hybrid.xad", "hyp.xad", "psi1.xad",
+  "SATNIGHT.HSP", "blaster2.msc", "RI051.RIX", "EOBSOUND.ADL", "DUNE19.ADL",
+  "LOREINTR.ADL", "DEMO4.JBM", "dro_v2.dro",
+  NULL
+};
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Textopl *****/
+
+// Writes the same text as playertest's Testopl, but into a string
+class Textopl: public Copl
+{
+public:
+  Textopl(std::string &s)
+    : text(s)
+  {
+    currType = TYPE_OPL3;
+  }
+
+  void update(CPlayer *p)
+  {
+    print("r%.2f\n", p->getrefresh());
+  }
+
+  void write(int reg, int val)
+  {
+    print("%x <- %x\n", reg, val);
+  }
+
+  void setchip(int n)
+  {
+    Copl::setchip(n);
+    print("setchip(%d)\n", n);
+  }
+
+  void init()
+  {
+    text += "init\n";
+  }
+
+private:
+  std::string	&text;
+
+  void print(const char *fmt, double v)
+  {
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), fmt, v);
+    text += buf;
+  }
+
+  void print(const char *fmt, int a, int b = 0)
+  {
+    char buf[32];
+
+    snprintf(buf, sizeof(buf), fmt, a, b);
+    text += buf;
+  }
+};
+
+/***** Local functions *****/
+
+static bool read_file(const std::string &fn, std::string &data)
+{
+  FILE	*f = fopen(fn.c_str(), "rb");
+  char	buf[4096];
+  size_t	n;
+
+  if(!f) return false;
+  data.erase();
+  while((n = fread(buf, 1, sizeof(buf), f)))
+    data.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static bool play(const char *filename, std::string &out)
+  /*
+   * Replays 'filename' and records its output like playertest does.
+   */
+{
+  std::string	fn = std::string(srcdir) + DIR_DELIM + filename;
+  Textopl	opl(out);
+  CPlayer	*p;
+
+  out.erase();
+  if(!(p = CAdPlug::factory(fn, &opl))) return false;
+
+  while(p->update())
+    opl.update(p);
+
+  delete p;
+  return true;
+}
+
+static void worker(const std::vector<std::string> *refs, int id, bool *ok)
+  /*
+   * Replays all files ROUNDS times, starting at a different file in every
+   * thread, and compares against the .ref files.
+   */
+{
+  std::string	out;
+  size_t	n = refs->size();
+
+  *ok = true;
+  for(size_t i = 0; i < n * ROUNDS; i++) {
+    size_t j = (i + id * n / NUM_THREADS) % n;
+
+    if(!play(filelist[j], out) || out != (*refs)[j]) {
+      std::cout << "Thread " << id << ": output of " << filelist[j]
+		<< " differs\n";
+      *ok = false;
+    }
+  }
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  std::vector<std::string>	refs;
+  std::thread			*threads[NUM_THREADS];
+  bool				ok[NUM_THREADS];
+  bool				retval = true;
+  int				i;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  // Read the reference output of every file
+  for(i = 0; filelist[i] != NULL; i++) {
+    std::string fn = std::string(srcdir) + DIR_DELIM + filelist[i];
+
+    refs.push_back(std::string());
+    fn = fn.substr(0, fn.find_last_of(".")) + ".ref";
+    if(!read_file(fn, refs.back())) {
+      std::cout << "Error reading: " << fn << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Replay everything on all threads at once
+  for(i = 0; i < NUM_THREADS; i++)
+    threads[i] = new std::thread(worker, &refs, i, &ok[i]);
+
+  for(i = 0; i < NUM_THREADS; i++) {
+    threads[i]->join();
+    delete threads[i];
+    if(!ok[i]) retval = false;
+  }
+
+  std::cout << "Replayed " << refs.size() << " files on " << NUM_THREADS
+	    << " threads: " << (retval ? "OK" : "FAIL") << std::endl;
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,152 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * probetest.cpp - Test file format detection by the players' probes
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+
+#include "../src/adplug.h"
+#include "../src/silentopl.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define MISNAMED	"misnamed.bin"	// Name the files are opened under
+
+/***** Local variables *****/
+
+// Files that have to be recognized by their contents alone
+static const char *filelist[] = {
+  "2001.MKJ", "ADAGIO.DFM", "adlibsp.s3m", "ALLOYRUN.RAD",
+  "ARAB.BAM", "DTM-TRK1.DTM", "inc.raw", "MARIO.A2M", "michaeld.cmf",
+  "rat.xad", "REVELAT.SNG", "SAILOR.CFF", "samurai.dro", "doofus.dro",
+  "SCALES.SA2", "TOCCATA.MAD", "TUBES.SAT", "CHILD1.XSM", "bmf1_2.xad",
+  "flash.xad", "hybrid.xad", "hyp.xad", "psi1.xad", "blaster2.msc",
+  "dro_v2.dro",
+  NULL
+};
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Misnaming file provider *****/
+
+// Opens 'real' whenever MISNAMED is asked for
+class CProvider_Misnamed: public CProvider_Filesystem
+{
+public:
+  CProvider_Misnamed(const std::string &realname)
+    : real(realname)
+    {
+    }
+
+  binistream *open(std::string filename) const
+    {
+      return CProvider_Filesystem::open(filename == MISNAMED ? real : filename);
+    }
+
+private:
+  std::string	real;
+};
+
+/***** Local functions *****/
+
+static bool check_probes(const std::string &fn)
+  /*
+   * A probe may only reject a file that its player can't load.
+   */
+{
+  CProvider_Filesystem		fp;
+  CSilentopl			opl;
+  unsigned char			header[CPlayer::PROBE_SIZE];
+  unsigned long			size;
+  CPlayers::const_iterator	i;
+  bool				ok = true;
+  binistream			*f = fp.open(fn);
+
+  if(!f) {
+    std::cout << "Error opening: " << fn << std::endl;
+    return false;
+  }
+
+  size = fp.filesize(f);
+  if(size > sizeof(header)) size = sizeof(header);
+  f->readString((char *)header, size);
+  fp.close(f);
+
+  for(i = CAdPlug::players.begin(); i != CAdPlug::players.end(); i++) {
+    if((*i)->rank(header, size) != CPlayer::PROBE_NO)
+      continue;
+
+    CPlayer *p = (*i)->factory(&opl);
+    if(p && p->load(fn, fp)) {
+      std::cout << fn << ": wrongly rejected by " << (*i)->filetype
+		<< std::endl;
+      ok = false;
+    }
+    delete p;
+  }
+
+  return ok;
+}
+
+static bool check_file(const char *filename)
+  /*
+   * Loads a file under its own name and under a name with an unknown
+   * extension. Both times, the same player has to take it.
+   */
+{
+  std::string	fn = std::string(srcdir) + DIR_DELIM + filename;
+  CSilentopl	opl;
+  CPlayer	*p1 = CAdPlug::factory(fn, &opl);
+  CPlayer	*p2 = CAdPlug::factory(MISNAMED, &opl, CAdPlug::players,
+				       CProvider_Misnamed(fn));
+  bool		ok = true;
+
+  if(!p1 || !p2 || p1->gettype() != p2->gettype()) {
+    std::cout << filename << ": not recognized when misnamed" << std::endl;
+    ok = false;
+  } else
+    ok = check_probes(fn);
+
+  delete p1; delete p2;
+  return ok;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  bool	retval = true;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  for(int i = 0; filelist[i] != NULL; i++)
+    if(!check_file(filelist[i]))
+      retval = false;
+
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
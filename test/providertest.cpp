@@ -0,0 +1,161 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * providertest.cpp - Test loading through the different file providers
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../src/adplug.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+/***** Local variables *****/
+
+// Files to load, each followed by its companion files and NULL
+static const char *filelist[] = {
+  "SONG1.sng", "SONG1.ins", NULL,
+  "HIP_D.ROL", "standard.bnk", NULL,
+  "BEGIN.KSM", "insts.dat", NULL,
+  "ice_thnk.sci", "icepatch.003", NULL,
+  "ALLOYRUN.RAD", NULL,
+  "MARIO.A2M", NULL,
+  "flash.xad", NULL,
+  NULL
+};
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Recording OPL *****/
+
+class Recordopl: public Copl
+{
+public:
+  void write(int reg, int val)
+    {
+      writes.push_back((currChip << 16) | (reg << 8) | val);
+    }
+
+  void init()
+    {
+      writes.push_back(-1);
+    }
+
+  std::vector<int>	writes;
+};
+
+/***** Local functions *****/
+
+static bool read_file(const std::string &fn, std::string &data)
+{
+  FILE	*f = fopen(fn.c_str(), "rb");
+  char	buf[4096];
+  size_t	n;
+
+  if(!f) return false;
+  data.erase();
+  while((n = fread(buf, 1, sizeof(buf), f)))
+    data.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+static bool play(const std::string &fn, const CFileProvider &fp,
+		 std::vector<int> &out)
+  /*
+   * Records everything the player writes while loading and playing 'fn'.
+   */
+{
+  Recordopl	opl;
+  CPlayer	*p = CAdPlug::factory(fn, &opl, CAdPlug::players, fp);
+
+  if(!p) return false;
+  while(p->update()) ;
+  delete p;
+
+  out.swap(opl.writes);
+  return true;
+}
+
+static bool check_file(const char **files)
+  /*
+   * Plays files[0] from the filesystem, preloaded from the filesystem and
+   * from memory. The player must do exactly the same each time.
+   */
+{
+  CProvider_Memory	mem;
+  std::vector<int>	out1, out2, out3;
+  std::string		fn, data;
+
+  for(int i = 0; files[i]; i++) {
+    fn = std::string(srcdir) + DIR_DELIM + files[i];
+    if(!read_file(fn, data)) {
+      std::cout << "Error reading: " << fn << std::endl;
+      return false;
+    }
+    mem.add(fn, data.data(), data.size());
+  }
+
+  fn = std::string(srcdir) + DIR_DELIM + files[0];
+  if(!play(fn, CProvider_Filesystem(), out1) ||
+     !play(fn, CProvider_Filesystem(true), out2) || !play(fn, mem, out3)) {
+    std::cout << files[0] << ": error loading" << std::endl;
+    return false;
+  }
+
+  if(out1 != out2 || out1 != out3) {
+    std::cout << files[0] << ": output depends on file provider" << std::endl;
+    return false;
+  }
+
+  // Once removed, it must be gone
+  mem.remove(fn);
+  if(play(fn, mem, out3)) {
+    std::cout << files[0] << ": still loads after removal" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  bool	retval = true;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  for(int i = 0; filelist[i] != NULL; i++) {
+    if(!check_file(filelist + i))
+      retval = false;
+    while(filelist[i]) i++;	// skip companion files
+  }
+
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,226 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * renderertest.cpp - Test the offline renderer
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../src/adplug.h"
+#include "../src/silentopl.h"
+#include "../src/temuopl.h"
+#include "../src/renderer.h"
+#include "../src/queueopl.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define RATE		11025	// Output sample rate
+#define MAX_SAMPLES	(RATE * 20)	// Rendered when comparing chunk sizes
+#define SMALL_CHUNK	37	// Odd chunk size, not aligned to any tick
+
+/***** Local variables *****/
+
+// Files to render, with different and changing refresh rates
+static const char *filelist[] = {
+  "SMKEREM.HSC",
+  "ALLOYRUN.RAD",
+  "DEMO4.JBM",
+  "HIP_D.ROL",
+  "michaeld.cmf",
+  NULL
+};
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Local functions *****/
+
+static bool check_length(const std::string &fn)
+  /*
+   * Renders the whole song silently and compares the number of sample
+   * frames with the exact sum of all tick lengths, including the one on
+   * which update() ends the song.
+   */
+{
+  CSilentopl	opl;
+  CPlayer	*p = CAdPlug::factory(fn, &opl);
+  double	exact = 0.0;
+  unsigned long	total = 0, n;
+  bool		playing;
+  static short	buf[4096];
+
+  if(!p) {
+    std::cout << "Error loading: " << fn << std::endl;
+    return false;
+  }
+
+  do {
+    playing = p->update();
+    exact += RATE / p->getrefresh();
+  } while(playing);
+
+  CRenderer r(p, &opl, RATE, true, false);
+  r.rewind();
+  while((n = r.render(buf, sizeof(buf) / sizeof(short))))
+    total += n;
+  delete p;
+
+  if(!r.songend() || total != r.getsamples() ||
+     total > exact + 1.0 || total + 1.0 < exact) {
+    std::cout << fn << ": rendered " << total << " frames, expected "
+	      << (unsigned long)exact << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static void render(const std::string &fn, unsigned long chunk,
+		   std::vector<short> &out, bool queued = false)
+  /*
+   * Renders the beginning of 'fn' in pieces of 'chunk' frames, with
+   * timestamped writes if 'queued' is true.
+   */
+{
+  CTemuopl	emu(RATE, true, false);
+  CQueueopl	queue(&emu, true, false);
+  Copl		*opl = queued ? (Copl *)&queue : (Copl *)&emu;
+  CPlayer	*p = CAdPlug::factory(fn, opl);
+  CRenderer	r(p, opl, RATE, true, false);
+  unsigned long	n;
+
+  out.resize(MAX_SAMPLES);
+  for(n = 0; n < MAX_SAMPLES; ) {
+    unsigned long got = r.render(&out[n], chunk < MAX_SAMPLES - n ?
+				 chunk : MAX_SAMPLES - n);
+    if(!got) break;
+    n += got;
+  }
+
+  out.resize(n);
+  delete p;
+}
+
+static bool check_chunks(const std::string &fn)
+  /*
+   * The output must not depend on the size of the caller's buffer.
+   */
+{
+  std::vector<short>	a, b;
+
+  render(fn, MAX_SAMPLES, a);
+  render(fn, SMALL_CHUNK, b);
+
+  if(a.empty() || a != b) {
+    std::cout << fn << ": output depends on buffer size" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static bool check_queue(const std::string &fn)
+  /*
+   * Queued writes have to take effect at the same frames as direct ones.
+   */
+{
+  std::vector<short>	a, b, c;
+
+  render(fn, MAX_SAMPLES, a);
+  render(fn, MAX_SAMPLES, b, true);
+  render(fn, SMALL_CHUNK, c, true);
+
+  if(a.empty() || a != b || a != c) {
+    std::cout << fn << ": queued writes change the output" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static bool check_stems(const std::string &fn)
+  /*
+   * Stems rendered through the queue in odd pieces have to add up to the
+   * mixed output, within the rounding of every channel.
+   */
+{
+  std::vector<short>	a;
+  std::vector<int32_t>	stems[9];
+  int32_t		*bufs[Copl::MAX_CHANNELS] = { 0 };
+  CTemuopl		emu(RATE, true, false);
+  CQueueopl		queue(&emu, true, false);
+  CPlayer		*p = CAdPlug::factory(fn, &queue);
+  CRenderer		r(p, &queue, RATE, true, false);
+  unsigned long		n, i;
+  int			c;
+
+  render(fn, MAX_SAMPLES, a, true);
+
+  for(c = 0; c < 9; c++) stems[c].resize(MAX_SAMPLES);
+  for(n = 0; n < MAX_SAMPLES; ) {
+    for(c = 0; c < 9; c++) bufs[c] = &stems[c][n];
+    unsigned long got = r.renderstems(bufs, SMALL_CHUNK < MAX_SAMPLES - n ?
+				      SMALL_CHUNK : MAX_SAMPLES - n);
+    if(!got) break;
+    n += got;
+  }
+  delete p;
+
+  for(i = 0; i < n && i < a.size(); i++) {
+    int32_t sum = 0;
+
+    for(c = 0; c < 9; c++) sum += stems[c][i];
+    sum = sum > 32767 ? 32767 : (sum < -32768 ? -32768 : sum);
+    if(abs(sum - a[i]) > 18) break;
+  }
+
+  if(a.empty() || n != a.size() || i < n) {
+    std::cout << fn << ": stems differ from the mix" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  bool	retval = true;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  for(int i = 0; filelist[i] != NULL; i++) {
+    std::string fn = std::string(srcdir) + DIR_DELIM + filelist[i];
+
+    if(!check_length(fn) || !check_chunks(fn) || !check_queue(fn) ||
+       !check_stems(fn))
+      retval = false;
+  }
+
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,49 @@
+#!/bin/sh
+#
+# Adplug - Replayer for many OPL2/OPL3 audio file formats.
+# Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+#
+# rendertest.sh - Test that adplugrender renders a song the same, whether
+#                 it comes alone or after another song
+#
+
+render=../adplugdb/adplugrender
+songs="ALLOYRUN.RAD SCALES.SA2"
+out=rendertest.out
+result=0
+
+test -z "$srcdir" && srcdir=.
+
+for emu in satoh ken woody; do
+  rm -rf $out
+  mkdir -p $out/alone $out/together
+
+  # One thread renders both songs in a row
+  $render -q -j 1 -t 3 -e $emu -o $out/together \
+    `for song in $songs; do echo $srcdir/$song; done` || result=1
+
+  for song in $songs; do
+    $render -q -j 1 -t 3 -e $emu -o $out/alone $srcdir/$song || result=1
+    if ! cmp -s $out/alone/$song.wav $out/together/$song.wav; then
+      echo "$song: output with $emu depends on the song rendered before"
+      result=1
+    fi
+  done
+done
+
+rm -rf $out
+exit $result
@@ -0,0 +1,139 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * resamplebench.cpp - Benchmark the resampling presets against emulators
+ *                     running at the output rate
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+#include "../src/adplug.h"
+#include "../src/emuopl.h"
+#include "../src/kemuopl.h"
+#include "../src/wemuopl.h"
+#include "../src/renderer.h"
+#include "../src/queueopl.h"
+#include "../src/resampleopl.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define RATE		44100	// Output sample rate
+#define FRAMES		(RATE * 60)	// Sample frames rendered per song
+#define BUFSIZE		16384	// Sample frames rendered at once
+
+/***** Local variables *****/
+
+// Songs to render
+static const char *filelist[] = {
+  "ALLOYRUN.RAD", "MARIO.A2M", "michaeld.cmf", "samurai.dro", "VIB_VOL3.D00",
+  NULL
+};
+
+static const char *emu_names[] = { "satoh", "ken", "woody" };
+
+static const char *quality_names[] = { "fast", "medium", "high", "best" };
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Local functions *****/
+
+static Copl *create_emu(int emu, int rate)
+{
+  switch(emu) {
+  case 1: return new CKemuopl(rate, true, true);
+  case 2: return new CWemuopl(rate, true, true);
+  default: return new CEmuopl(rate, true, true);
+  }
+}
+
+static clock_t render(Copl *opl, const std::string &fn, short *buf)
+/* Renders the start of a song and returns the time it took */
+{
+  CQueueopl	queue(opl, true, true);
+  CPlayer	*p = CAdPlug::factory(fn, &queue);
+  clock_t	start;
+  unsigned long	done = 0, n;
+
+  if(!p) return 0;
+
+  start = clock();
+  CRenderer r(p, &queue, RATE, true, true);
+  r.setloop(true);
+  while(done < FRAMES && (n = r.render(buf, BUFSIZE)))
+    done += n;
+  start = clock() - start;
+
+  delete p;
+  return start;
+}
+
+static void measure(int emu, int quality, short *buf)
+/*
+ * Renders all songs with one emulator, at the output rate if 'quality' is
+ * negative, and prints the time per song.
+ */
+{
+  clock_t	total = 0;
+
+  printf("%-6s %-8s", emu_names[emu], quality < 0 ? "direct" : quality_names[quality]);
+  for(int i = 0; filelist[i] != NULL; i++) {
+    std::string fn = std::string(srcdir) + DIR_DELIM + filelist[i];
+    Copl *opl = create_emu(emu, quality < 0 ? RATE : CResampleopl::NATIVE_RATE);
+    Copl *r = quality < 0 ? opl :
+      new CResampleopl(opl, RATE, true, true, (CResampleopl::Quality)quality);
+    clock_t t = render(r, fn, buf);
+
+    printf(" %13.0f", t * 1000.0 / CLOCKS_PER_SEC);
+    total += t;
+    if(r != opl) delete r;
+    delete opl;
+  }
+  printf(" %8.0f\n", total * 1000.0 / CLOCKS_PER_SEC);
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  short	*buf = new short[BUFSIZE * 2];
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  printf("Milliseconds for %d s of each song at %d Hz\n", FRAMES / RATE, RATE);
+  printf("%-6s %-8s", "emu", "quality");
+  for(int i = 0; filelist[i] != NULL; i++)
+    printf(" %13s", filelist[i]);
+  printf(" %8s\n", "total");
+
+  for(int emu = 0; emu < 3; emu++)
+    for(int quality = -1; quality < 4; quality++)
+      measure(emu, quality, buf);
+
+  delete [] buf;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * resampletest.cpp - Test the resampling OPL
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <iostream>
+
+#include "../src/emuopl.h"
+#include "../src/resampleopl.h"
+
+#define PI		3.14159265358979323846
+#define OUT_RATE	44100
+#define BUF_SIZE	4096
+
+static const char *quality_names[] = { "fast", "medium", "high", "best" };
+
+class CSineopl: public Copl
+  /*
+   * Stands in for an emulator at the native rate, with a sine of a given
+   * frequency on the left and its negation on the right.
+   */
+{
+public:
+  CSineopl(double newfreq, bool newstereo)
+    : freq(newfreq), stereo(newstereo), frames(0) {}
+
+  void write(int reg, int val) {}
+  void init() { frames = 0; }
+
+  void updatefloat(float *buf, int samples)
+    {
+      for(int i = 0; i < samples; i++, frames++) {
+	float s = (float)(0.5 * sin(2 * PI * freq * frames / CResampleopl::NATIVE_RATE));
+	*buf++ = s;
+	if(stereo) *buf++ = -s;
+      }
+    }
+
+  unsigned long getframes() { return frames; }
+
+private:
+  double	freq;
+  bool		stereo;
+  unsigned long	frames;
+};
+
+static void set_chord(Copl *opl)
+{
+  opl->init();
+  for(int i = 0; i < 3; i++) {
+    opl->write(0x20 + i, 1); opl->write(0x40 + i, 0x10);
+    opl->write(0x60 + i, 0xf0); opl->write(0x80 + i, 0x77);
+    opl->write(0x23 + i, 1); opl->write(0x43 + i, 0);
+    opl->write(0x63 + i, 0xf0); opl->write(0x83 + i, 0x77);
+    opl->write(0xc0 + i, 0x30);
+    opl->write(0xa0 + i, 0x98 + i * 13);
+    opl->write(0xb0 + i, 0x31);
+  }
+}
+
+static bool check_sine(int quality, double freq, double maxerror, double maxlevel)
+  /*
+   * Resamples a sine. Below the output's Nyquist frequency, it has to come
+   * out at the same position and level, within 'maxerror'. Above, it has to
+   * be suppressed below 'maxlevel'.
+   */
+{
+  CSineopl	sine(freq, true);
+  CResampleopl	r(&sine, OUT_RATE, true, true, (CResampleopl::Quality)quality);
+  float		*buf = new float[BUF_SIZE * 2];
+  double	error = 0.0, level = 0.0;
+  bool		ok = true;
+
+  r.updatefloat(buf, BUF_SIZE);
+
+  // The filter starts on silence, so the first samples are skipped
+  for(int i = 256; i < BUF_SIZE; i++) {
+    double s = 0.5 * sin(2 * PI * freq * i / OUT_RATE);
+
+    if(buf[i * 2] != -buf[i * 2 + 1]) ok = false;
+    error = fmax(error, fabs(buf[i * 2] - s));
+    level = fmax(level, fabs(buf[i * 2]));
+  }
+
+  if(!ok)
+    std::cout << quality_names[quality] << ": channels differ" << std::endl;
+  if(freq < OUT_RATE / 2 && error > maxerror) {
+    std::cout << quality_names[quality] << ": " << freq << " Hz sine off by "
+	      << error << std::endl;
+    ok = false;
+  }
+  if(freq >= OUT_RATE / 2 && level > maxlevel) {
+    std::cout << quality_names[quality] << ": " << freq << " Hz sine aliased at "
+	      << level << std::endl;
+    ok = false;
+  }
+
+  delete [] buf;
+  return ok;
+}
+
+static bool check_chunks(int quality)
+  /*
+   * Output in many odd sized calls has to be the same as in one call, and
+   * the emulator must have rendered just the input that covers it.
+   */
+{
+  CSineopl	sine1(440, false), sine2(440, false);
+  CResampleopl	r1(&sine1, OUT_RATE, true, false, (CResampleopl::Quality)quality);
+  CResampleopl	r2(&sine2, OUT_RATE, true, false, (CResampleopl::Quality)quality);
+  int32_t	*buf1 = new int32_t[BUF_SIZE * 4], *buf2 = new int32_t[BUF_SIZE * 4];
+  int		done = 0, n;
+  bool		ok = true;
+
+  r1.update32(buf1, BUF_SIZE * 4);
+  for(n = 1; done < BUF_SIZE * 4; n = n * 7 % 1013 + 1) {
+    n = n < BUF_SIZE * 4 - done ? n : BUF_SIZE * 4 - done;
+    r2.update32(buf2 + done, n);
+    done += n;
+  }
+
+  if(memcmp(buf1, buf2, BUF_SIZE * 4 * sizeof(int32_t))) {
+    std::cout << quality_names[quality] << ": chunked output differs" << std::endl;
+    ok = false;
+  }
+
+  double expected = (double)BUF_SIZE * 4 * CResampleopl::NATIVE_RATE / OUT_RATE;
+  if(fabs(sine2.getframes() - expected) > 64) {
+    std::cout << quality_names[quality] << ": rendered " << sine2.getframes()
+	      << " input frames instead of " << expected << std::endl;
+    ok = false;
+  }
+
+  delete [] buf1; delete [] buf2;
+  return ok;
+}
+
+static bool check_formats()
+  /*
+   * update() has to give the rounded and clipped floats, and the native rate
+   * the emulator's output unchanged.
+   */
+{
+  CEmuopl	emu1(CResampleopl::NATIVE_RATE, true, false);
+  CEmuopl	emu2(CResampleopl::NATIVE_RATE, true, false);
+  CResampleopl	r1(&emu1, OUT_RATE, true, false), r2(&emu2, OUT_RATE, true, false);
+  short		buf16[BUF_SIZE];
+  float		buff[BUF_SIZE];
+  bool		ok = true;
+  int		i;
+
+  set_chord(&r1); set_chord(&r2);
+  r1.update(buf16, BUF_SIZE);
+  r2.updatefloat(buff, BUF_SIZE);
+  for(i = 0; i < BUF_SIZE; i++) {
+    float s = buff[i] * 32768.0f;
+    if(buf16[i] != (s > 32767 ? 32767 : (s < -32768 ? -32768 : lrintf(s))))
+      break;
+  }
+  if(i < BUF_SIZE) {
+    std::cout << "16-bit sample " << i << " differs" << std::endl;
+    ok = false;
+  }
+
+  CEmuopl	emu3(CResampleopl::NATIVE_RATE, true, false);
+  CEmuopl	emu4(CResampleopl::NATIVE_RATE, true, false);
+  CResampleopl	r3(&emu3, CResampleopl::NATIVE_RATE, true, false);
+  short		ref[BUF_SIZE];
+
+  set_chord(&r3); set_chord(&emu4);
+  r3.update(buf16, BUF_SIZE);
+  emu4.update(ref, BUF_SIZE);
+  if(memcmp(buf16, ref, sizeof(ref))) {
+    std::cout << "output at the native rate differs" << std::endl;
+    ok = false;
+  }
+
+  return ok;
+}
+
+static bool check_init()
+  /*
+   * After init(), the output has to start over like that of a new
+   * resampler, without the previous filter tail and phase.
+   */
+{
+  CSineopl	sine1(440, true), sine2(440, true);
+  CResampleopl	r1(&sine1, OUT_RATE, true, true), r2(&sine2, OUT_RATE, true, true);
+  int32_t	buf1[BUF_SIZE * 2], buf2[BUF_SIZE * 2];
+
+  r1.update32(buf1, 1001);
+  r1.init();
+  r1.update32(buf1, BUF_SIZE);
+  r2.update32(buf2, BUF_SIZE);
+  if(memcmp(buf1, buf2, sizeof(buf1))) {
+    std::cout << "output differs after init()" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  // Largest error in the passband and level in the stopband per quality
+  static const double maxerror[] = { 0.005, 0.002, 0.0001, 0.00002 };
+  static const double maxlevel[] = { 0.08, 0.04, 0.002, 0.00005 };
+  bool retval = true;
+
+  for(int q = 0; q < 4; q++)
+    if(!check_sine(q, 1000, maxerror[q], 0) ||
+       !check_sine(q, 24000, 0, maxlevel[q]) ||
+       !check_chunks(q))
+      retval = false;
+
+  if(!check_formats() || !check_init())
+    retval = false;
+
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,324 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * seektest.cpp - Test seeking from player snapshots
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "../src/adplug.h"
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define TICKS	200	// Player ticks compared after seeking
+#define RELOAD	"ALLOYRUN.RAD"	// Loaded twice, at two different speeds
+#define FOUROP	600	// Tick on which the 4-op test player enables 4-op mode
+
+/***** Local variables *****/
+
+// Files to seek in. The last one's player doesn't support snapshots.
+static const char *filelist[] = {
+  "MARIO.A2M",
+  "ALLOYRUN.RAD",
+  "adlibsp.s3m",
+  "fdance03.dmo",
+  "SCALES.SA2",
+  "TU_BLESS.AMD",
+  "DTM-TRK1.DTM",
+  "SAILOR.CFF",
+  "TOCCATA.MAD",
+  "SMKEREM.HSC",
+  NULL
+};
+
+// Positions to seek to, in ms. Also seeks backwards.
+static const unsigned long seeklist[] = { 47000, 25000, 3000, 61000, 0 };
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Recording OPL *****/
+
+class Recordopl: public Copl
+{
+public:
+  Recordopl()
+    {
+      currType = TYPE_DUAL_OPL2;
+      init();
+    }
+
+  void write(int reg, int val)
+    {
+      regs[currChip][reg] = val;
+      writes.push_back((currChip << 16) | (reg << 8) | val);
+    }
+
+  void init()
+    {
+      memset(regs, 0, sizeof(regs));
+    }
+
+  // Register file, without the timer registers that aren't restored
+  std::vector<int> getregs()
+    {
+      std::vector<int> r(regs[0], regs[0] + 512);
+      r[2] = r[3] = r[4] = 0;
+      r.push_back(currChip);
+      return r;
+    }
+
+  std::vector<int>	writes;
+
+private:
+  unsigned char		regs[2][256];
+};
+
+/***** 4-op test player *****/
+
+// Plays notes on the first chip. Tick FOUROP turns on OPL3 4-op mode,
+// which rewind() leaves off, so seeking has to restore it.
+class CFourOpPlayer: public CPlayer
+{
+public:
+  class CTickState: public CState
+  {
+  public:
+    unsigned long	ticks;
+  };
+
+  CFourOpPlayer(Copl *newopl)
+    : CPlayer(newopl)
+    { load("", CProvider_Filesystem()); }
+
+  bool load(const std::string &filename, const CFileProvider &fp)
+    { clear_caches(); rewind(); return true; }
+
+  bool update()
+    {
+      if(ticks == FOUROP) {
+	opl->setchip(1);
+	opl->write(5, 1);
+	opl->write(4, 0x3f);
+	opl->setchip(0);
+      }
+      opl->write(0xa0 + ticks % 9, ticks & 0xff);
+      opl->write(0xb0 + ticks % 9, 0x20 | (ticks >> 8 & 3));
+      return ++ticks < 5 * FOUROP;
+    }
+
+  void rewind(int subsong = -1)
+    { ticks = 0; opl->init(); }
+
+  float getrefresh() { return 50.0f; }
+  std::string gettype() { return std::string("4-op test player"); }
+
+  CState *getstate()
+    {
+      CTickState *state = new CTickState;
+      state->ticks = ticks;
+      return state;
+    }
+
+  void setstate(const CState *s)
+    { ticks = ((const CTickState *)s)->ticks; }
+
+private:
+  unsigned long	ticks;
+};
+
+/***** Local functions *****/
+
+static void play(CPlayer *p, Recordopl &opl, std::vector<int> &out)
+  /*
+   * Records the register file after seeking and the following ticks.
+   */
+{
+  out = opl.getregs();
+  opl.writes.clear();
+  for(int i = 0; i < TICKS && p->update(); i++) {
+    out.insert(out.end(), opl.writes.begin(), opl.writes.end());
+    out.push_back((int)(p->getrefresh() * 1000));
+    opl.writes.clear();
+  }
+}
+
+static bool check_seek(const char *filename)
+  /*
+   * Seeks in a fresh player and in one that has taken snapshots during
+   * songlength(), and compares the output after each seek.
+   */
+{
+  std::string		fn = std::string(srcdir) + DIR_DELIM + filename;
+  Recordopl		opl1, opl2;
+  CPlayer		*p1 = CAdPlug::factory(fn, &opl1);
+  CPlayer		*p2 = CAdPlug::factory(fn, &opl2);
+  std::vector<int>	out1, out2;
+  bool			ok = true;
+
+  if(!p1 || !p2) {
+    std::cout << "Error loading: " << fn << std::endl;
+    delete p1; delete p2;
+    return false;
+  }
+
+  p2->songlength();
+  for(int i = 0; seeklist[i]; i++) {
+    // A fresh player each time, so it has to seek from the beginning
+    delete p1;
+    p1 = CAdPlug::factory(fn, &opl1);
+
+    p1->seek(seeklist[i]);
+    play(p1, opl1, out1);
+    p2->seek(seeklist[i]);
+    play(p2, opl2, out2);
+
+    if(out1 != out2) {
+      std::cout << filename << ": output differs after seeking to "
+		<< seeklist[i] << " ms" << std::endl;
+      ok = false;
+    }
+  }
+
+  delete p1; delete p2;
+  return ok;
+}
+
+static bool check_reload()
+  /*
+   * Loads a song and, into the same player, the song at a lower speed.
+   * The second file's length and seeking must not use the snapshots and
+   * length of the first.
+   */
+{
+  std::string		fn = std::string(srcdir) + DIR_DELIM + RELOAD;
+  FILE			*f = fopen(fn.c_str(), "rb");
+  std::string		data;
+  CProvider_Memory	fp;
+  Recordopl		opl1, opl2;
+  std::vector<int>	out1, out2;
+  int			c;
+  bool			ok = true;
+
+  if(!f) {
+    std::cout << "Error opening: " << fn << std::endl;
+    return false;
+  }
+  while((c = fgetc(f)) != EOF) data += (char)c;
+  fclose(f);
+
+  fp.add("fast.rad", data.data(), data.size());
+  data[17] = (data[17] & ~31) | 6;	// initial speed
+  fp.add("slow.rad", data.data(), data.size());
+
+  CPlayer *p1 = CAdPlug::factory("fast.rad", &opl1, CAdPlug::players, fp);
+  CPlayer *p2 = CAdPlug::factory("slow.rad", &opl2, CAdPlug::players, fp);
+  if(!p1 || !p2) {
+    std::cout << "reload: error loading " << RELOAD << std::endl;
+    delete p1; delete p2;
+    return false;
+  }
+
+  p1->songlength();
+  p1->seek(seeklist[0]);
+  if(!p1->load("slow.rad", fp)) {
+    std::cout << "reload: error loading again" << std::endl;
+    ok = false;
+  } else if(p1->songlength() != p2->songlength()) {
+    std::cout << "reload: length of the previous song" << std::endl;
+    ok = false;
+  } else {
+    p1->seek(seeklist[0]);
+    play(p1, opl1, out1);
+    p2->seek(seeklist[0]);
+    play(p2, opl2, out2);
+    if(out1 != out2) {
+      std::cout << "reload: output differs after seeking" << std::endl;
+      ok = false;
+    }
+  }
+
+  delete p1; delete p2;
+  return ok;
+}
+
+static bool check_fourop()
+  /*
+   * Seeks behind the tick that enables 4-op mode, from a snapshot. The
+   * 4-op connections have to be restored before any note is keyed on.
+   */
+{
+  Recordopl		opl1, opl2;
+  CFourOpPlayer		p1(&opl1), p2(&opl2);
+  std::vector<int>	out1, out2;
+  unsigned int		i, connect = 0, keyon = 0;
+
+  p2.songlength();
+  p1.seek(seeklist[0]);
+  p2.seek(seeklist[0]);
+
+  for(i = 0; i < opl2.writes.size(); i++) {
+    int w = opl2.writes[i], reg = w >> 8 & 0x1ff;
+    if(reg == 0x104 && !connect) connect = i + 1;
+    if(reg >= 0xb0 && reg <= 0xb8 && (w & 0x20) && !keyon) keyon = i + 1;
+  }
+  if(!connect || connect > keyon) {
+    std::cout << "4-op: connections not restored before the notes" << std::endl;
+    return false;
+  }
+
+  play(&p1, opl1, out1);
+  play(&p2, opl2, out2);
+  if(out1 != out2) {
+    std::cout << "4-op: output differs after seeking" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  bool	retval = true;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  for(int i = 0; filelist[i] != NULL; i++)
+    if(!check_seek(filelist[i]))
+      retval = false;
+
+  if(!check_reload())
+    retval = false;
+
+  if(!check_fourop())
+    retval = false;
+
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
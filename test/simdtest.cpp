@@ -0,0 +1,227 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * simdtest.cpp - Test that the SIMD kernels of the WoodyOPL emulator
+ * produce exactly the same output as the plain C code
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../src/adplug.h"
+extern "C" {
+#include "../src/woodyopl.h"
+}
+
+#ifdef MSDOS
+#	define DIR_DELIM	"\\"
+#else
+#	define DIR_DELIM	"/"
+#endif
+
+#define MAX_UPDATES	2000	// Replayed updates per file
+#define RANDOM_BLOCKS	400	// Blocks of random register writes
+
+/***** Local variables *****/
+
+// Files to replay, OPL2 and OPL3 ones
+static const char *filelist[] = {
+  "MARIO.A2M", "ALLOYRUN.RAD", "HIP_D.ROL", "michaeld.cmf", "dro_v2.dro",
+  "DEMO4.JBM", "VIB_VOL3.D00",
+  NULL
+};
+
+// Sample rates to render at
+static const int ratelist[] = { 8000, 44100, 49716, 0 };
+
+// String holding the relative path to the source directory
+static const char *srcdir;
+
+/***** Recording OPL *****/
+
+// A register write and the samples to render after it
+struct Event {
+  int	reg, val, samples;
+};
+
+class Recordopl: public Copl
+{
+public:
+  Recordopl()
+    {
+      currType = TYPE_OPL3;
+    }
+
+  void write(int reg, int val)
+    {
+      Event e = { (currChip << 8) | reg, val, 0 };
+      events.push_back(e);
+    }
+
+  void init() {}
+
+  std::vector<Event>	events;
+};
+
+/***** Local functions *****/
+
+static bool record_file(const char *filename, int rate,
+			std::vector<Event> &events)
+  /*
+   * Records the writes of the first MAX_UPDATES updates of 'filename'.
+   */
+{
+  std::string	fn = std::string(srcdir) + DIR_DELIM + filename;
+  Recordopl	opl;
+  CPlayer	*p = CAdPlug::factory(fn, &opl);
+  double	left = 0;
+
+  if(!p) return false;
+  for(int i = 0; i < MAX_UPDATES && p->update(); i++) {
+    Event e = { -1, 0, 0 };
+
+    left += rate / p->getrefresh();
+    e.samples = (int)left;
+    left -= e.samples;
+    opl.events.push_back(e);
+  }
+
+  delete p;
+  events.swap(opl.events);
+  return true;
+}
+
+static void random_events(unsigned int seed, std::vector<Event> &events)
+  /*
+   * Random register writes, with a bias towards the OPL3 mode, 4op and
+   * percussion registers.
+   */
+{
+  events.clear();
+  for(int blk = 0; blk < RANDOM_BLOCKS; blk++) {
+    int n;
+
+    seed = seed * 1103515245 + 12345;
+    n = (seed >> 16) & 0x1f;
+
+    for(int i = 0; i < n; i++) {
+      Event e = { 0, 0, 0 };
+
+      seed = seed * 1103515245 + 12345;
+      switch((seed >> 16) % 8) {
+      case 0: e.reg = 0x104; break;
+      case 1: e.reg = 0x105; break;
+      case 2: e.reg = 0xbd; break;
+      default: e.reg = (seed >> 20) & 0x1ff; break;
+      }
+      seed = seed * 1103515245 + 12345;
+      e.val = (seed >> 16) & 0xff;
+      if(e.reg == 0x105) e.val &= 1;
+      events.push_back(e);
+    }
+
+    Event e = { -1, 0, 1 + (int)((seed >> 8) % 1500) };
+    events.push_back(e);
+  }
+}
+
+static void render(const std::vector<Event> &events, int rate, Bitu level,
+		   std::vector<short> &out)
+{
+  OPLChipClass	*opl = new OPLChipClass;
+
+  opl->adlib_init(rate, 2, 2);
+  opl->adlib_setsimd(level);
+  out.clear();
+
+  for(size_t i = 0; i < events.size(); i++)
+    if(events[i].reg >= 0)
+      opl->adlib_write(events[i].reg, events[i].val);
+    else if(events[i].samples) {
+      size_t pos = out.size();
+
+      out.resize(pos + events[i].samples * 2);
+      opl->adlib_getsample(&out[pos], events[i].samples);
+    }
+
+  delete opl;
+}
+
+static bool check_events(const std::vector<Event> &events, int rate,
+			 const std::string &name)
+  /*
+   * Renders 'events' at every SIMD level the CPU supports. All have to
+   * give the same output as the plain C code.
+   */
+{
+  std::vector<short>	ref, out;
+  OPLChipClass		*opl = new OPLChipClass;
+  Bitu			maxlevel, level;
+  bool			ok = true;
+
+  opl->adlib_init(rate, 2, 2);
+  maxlevel = opl->adlib_setsimd(SIMD_AVX2);
+  delete opl;
+
+  render(events, rate, SIMD_NONE, ref);
+  for(level = SIMD_NONE + 1; level <= maxlevel; level++) {
+    render(events, rate, level, out);
+    if(out != ref) {
+      std::cout << name << " at " << rate << " Hz: SIMD level " << level
+		<< " differs" << std::endl;
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  std::vector<Event>	events;
+  bool			retval = true;
+  int			i, j;
+
+  // Set path to source directory
+  srcdir = getenv("srcdir");
+  if(!srcdir) srcdir = ".";
+
+  for(j = 0; ratelist[j]; j++) {
+    for(i = 0; filelist[i] != NULL; i++) {
+      if(!record_file(filelist[i], ratelist[j], events)) {
+	std::cout << "Error loading: " << filelist[i] << std::endl;
+	retval = false;
+	continue;
+      }
+      if(!check_events(events, ratelist[j], filelist[i]))
+	retval = false;
+    }
+
+    for(i = 1; i <= 4; i++) {
+      random_events(i, events);
+      if(!check_events(events, ratelist[j], "random writes"))
+	retval = false;
+    }
+  }
+
+  return retval ? EXIT_SUCCESS : EXIT_FAILURE;
+}
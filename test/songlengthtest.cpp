@@ -0,0 +1,179 @@
+/*
+ * Adplug - Replayer for many OPL2/OPL3 audio file formats.
+ * Copyright (C) 1999 - 2008 Simon Peter, <dn.tlp@gmx.net>, et al.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * songlengthtest.cpp - Test loop detection and caching in songlength()
+ */
+
+#include <stdlib.h>
+#include <iostream>
+
+#include "../src/player.h"
+#include "../src/silentopl.h"
+
+#define ROWS	16	// Rows per pattern
+#define ORDERS	4	// Orders in the song
+#define LOOPORD	1	// Order the song jumps back to
+#define REFRESH	50.0f	// Ticks per second
+
+/***** Looping player *****/
+
+// Plays one row per tick and jumps back to LOOPORD after the last order,
+// without ever reporting the end of the song, like many trackers do.
+class CLoopPlayer: public CPlayer
+{
+public:
+  CLoopPlayer(Copl *newopl)
+    : CPlayer(newopl), updates(0)
+    { load("", CProvider_Filesystem()); }
+
+  bool load(const std::string &filename, const CFileProvider &fp)
+    { clear_caches(); rewind(); return true; }
+
+  bool update()
+    {
+      opl->write(0xa0, row);
+      opl->write(0xb0, ord);
+      if(++row == ROWS) {
+	row = 0;
+	if(++ord == ORDERS) ord = LOOPORD;
+      }
+      updates++;
+      return true;
+    }
+
+  void rewind(int subsong = -1)
+    { ord = row = 0; opl->init(); }
+
+  float getrefresh() { return REFRESH; }
+  std::string gettype() { return std::string("Looping test player"); }
+  unsigned int getorders() { return ORDERS; }
+  unsigned int getorder() { return ord; }
+  unsigned int getpattern() { return ord; }
+  unsigned int getrow() { return row; }
+  unsigned int getspeed() { return 1; }
+
+  unsigned long	updates;
+
+private:
+  unsigned int	ord, row;
+};
+
+/***** Pattern looping player *****/
+
+// Plays pattern LOOPORD twice by a pattern loop, with the same output
+// both times, and then the rest of the song once.
+class CPatternLoopPlayer: public CPlayer
+{
+public:
+  class CLoopState: public CState
+  {
+  public:
+    unsigned int	ord, row, loopcnt;
+
+    bool hash(unsigned long long &h) const
+      {
+	hash_bytes(h, &ord, sizeof(ord));
+	hash_bytes(h, &row, sizeof(row));
+	hash_bytes(h, &loopcnt, sizeof(loopcnt));
+	return true;
+      }
+  };
+
+  CPatternLoopPlayer(Copl *newopl)
+    : CPlayer(newopl)
+    { load("", CProvider_Filesystem()); }
+
+  bool load(const std::string &filename, const CFileProvider &fp)
+    { clear_caches(); rewind(); return true; }
+
+  bool update()
+    {
+      opl->write(0xa0, row);
+      if(++row == ROWS) {
+	row = 0;
+	if(ord == LOOPORD && !loopcnt) loopcnt = 1;	// play it again
+	else if(++ord == ORDERS) { ord = 0; loopcnt = 0; return false; }
+      }
+      return true;
+    }
+
+  void rewind(int subsong = -1)
+    { ord = row = loopcnt = 0; opl->init(); }
+
+  float getrefresh() { return REFRESH; }
+  std::string gettype() { return std::string("Pattern looping test player"); }
+  unsigned int getorders() { return ORDERS; }
+  unsigned int getorder() { return ord; }
+  unsigned int getpattern() { return ord; }
+  unsigned int getrow() { return row; }
+  unsigned int getspeed() { return 1; }
+
+  CState *getstate()
+    {
+      CLoopState *state = new CLoopState;
+      state->ord = ord; state->row = row; state->loopcnt = loopcnt;
+      return state;
+    }
+
+  void setstate(const CState *s)
+    {
+      const CLoopState *state = (const CLoopState *)s;
+      ord = state->ord; row = state->row; loopcnt = state->loopcnt;
+    }
+
+private:
+  unsigned int	ord, row, loopcnt;
+};
+
+/***** Main program *****/
+
+int main(int argc, char *argv[])
+{
+  CSilentopl	opl;
+  CLoopPlayer	p(&opl);
+  unsigned long	len, updates;
+  // One pass through the song is the shortest length that is still right
+  const unsigned long onepass = (unsigned long)(ORDERS * ROWS * 1000 / REFRESH);
+
+  len = p.songlength();
+  if(len < onepass || len >= 600000) {
+    std::cout << "Loop not detected, song length " << len << " ms" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // The second time, the length has to come from the cache
+  updates = p.updates;
+  if(p.songlength() != len || p.updates != updates) {
+    std::cout << "Song length not cached" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // A pattern loop through the same output is no loop of the song. The
+  // update that ends the song isn't counted.
+  CPatternLoopPlayer	pl(&opl);
+  const unsigned long	looplen =
+    (unsigned long)(((ORDERS + 1) * ROWS - 1) * 1000 / REFRESH);
+  len = pl.songlength();
+  if(len != looplen) {
+    std::cout << "Pattern loop taken for a song loop, song length " << len
+	      << " ms instead of " << looplen << " ms" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}